@@ -2367,6 +2367,27 @@ LPXLOPER EXCEL_EXPORT xlShmCCSwapNPV(XlfOper xlStartDate, XlfOper xlMaturity, Xl
 
 #include "ciDates.h"
 #include "VectorManipulations.h"
+#include "ciDayCount.h"
+
+namespace {
+   std::vector< long > toSerials( const std::vector< double > &dates )
+   {
+      std::vector< long > res( dates.size() );
+      for( unsigned i = 0; i < dates.size(); ++i ) res[i] = (long)dates[i];
+      return res;
+   }
+
+   //out[i] = year fraction from (*start)[i], or from startDate when start is null, to end[i]
+   void yearFractions( const std::vector< long > *start, long startDate, const std::vector< long > &end, long dayCount,
+                       std::vector< double > &out )
+   {
+      if( ( start && start->size() != end.size() ) || out.size() != end.size() )
+         throw pdg::Error(2, "#Error in xlSwapSensitivity2, start and end dates of different sizes");
+      if( end.empty() ) return;
+      pdgerr_t res = pdg_yrfDayCountBulk( (long)end.size(), start ? &(*start)[0] : 0, startDate, &end[0], dayCount, &out[0] );
+      if( res.code ) throw pdg::Error( res );
+   }
+}
 
 LPXLOPER EXCEL_EXPORT xlSwapSensitivity2(XlfOper xlRefDay, XlfOper xlStartFixDate, XlfOper xlEndFixDate, XlfOper xlFixDayCount, XlfOper xlStartFloatDate, XlfOper xlEndFloatDate, XlfOper xlFloatDayCount, XlfOper xlStartLiborDate, XlfOper xlEndLiborDate, XlfOper xlLiborDayCount, XlfOper xlZeroRateDayCount, XlfOper xlFixPayZCB, XlfOper xlFloatPayZCB, XlfOper xlLiborStartZCB, XlfOper xlLiborEndZCB/**/)
 {
@@ -2420,71 +2441,27 @@ LPXLOPER EXCEL_EXPORT xlSwapSensitivity2(XlfOper xlRefDay, XlfOper xlStartFixDat
     std::vector< double > libor_end_zcbond;
     xloper_cast< std::vector< double > >( xlLiborEndZCB, libor_end_zcbond );
 
-    std::vector< double> fix_yfrac( vecStartFixDate.size() );
-    std::vector< double> fix_pay_ttm( vecStartFixDate.size() );
-    for( unsigned i = 0; i < fix_yfrac.size(); ++i ){
-        
-        double local_ret = -1.0;
-        pdgerr_t res     = pdg_yrfDayCount((long)vecStartFixDate.at( i ),
-                                           (long)vecEndFixDate.at( i ),
-                                           FixDayCount,
-                                           &local_ret);
-        if(res.code) return XlfOper(res.des);
-        fix_yfrac.at( i ) = local_ret;
-
-        res               = pdg_yrfDayCount((long)refDay,
-                                           (long)vecEndFixDate.at( i ),
-                                           zeroRateDayCount,
-                                           &local_ret);
-        if(res.code) return XlfOper(res.des);
-        fix_pay_ttm.at( i ) = local_ret;
-        
-    }
-
-    std::vector< double> float_yfrac( vecStartFloatDate.size() );
-    std::vector< double> float_pay_ttm( vecStartFloatDate.size() );
-    for( unsigned i = 0; i < float_yfrac.size(); ++i ){
-        
-        double local_ret = -1.0;
-        pdgerr_t res     = pdg_yrfDayCount((long)vecStartFloatDate.at( i ),
-                                           (long)vecEndFloatDate.at( i ),
-                                           FloatDayCount,
-                                           &local_ret);
-        if(res.code) return XlfOper(res.des);
-        float_yfrac.at( i ) = local_ret;
-        res                 = pdg_yrfDayCount((long)refDay,
-                                           (long)vecEndFloatDate.at( i ),
-                                           zeroRateDayCount,
-                                           &local_ret);
-        if(res.code) return XlfOper(res.des);
-        float_pay_ttm.at( i ) = local_ret;
-    }
-
-    std::vector< double> libor_yfrac( vecStartLiborDate.size() );
-    std::vector< double> libor_start_ttm( vecStartLiborDate.size() );
-    std::vector< double> libor_end_ttm( vecStartLiborDate.size() );
-    for( unsigned i = 0; i < libor_yfrac.size(); ++i ){
-        
-        double local_ret = -1.0;
-        pdgerr_t res     = pdg_yrfDayCount((long)vecStartLiborDate.at( i ),
-                                           (long)vecEndLiborDate.at( i ),
-                                           LiborDayCount,
-                                           &local_ret);
-        if(res.code) return XlfOper(res.des);
-        libor_yfrac.at( i ) = local_ret;
-        res                 = pdg_yrfDayCount((long)refDay,
-                                           (long)vecStartLiborDate.at( i ),
-                                           zeroRateDayCount,
-                                           &local_ret);
-        if(res.code) return XlfOper(res.des);
-        libor_start_ttm.at( i ) = local_ret;
-        res                 = pdg_yrfDayCount((long)refDay,
-                                           (long)vecEndLiborDate.at( i ),
-                                           zeroRateDayCount,
-                                           &local_ret);
-        if(res.code) return XlfOper(res.des);
-        libor_end_ttm.at( i ) = local_ret;
-    }
+    //the year fractions of each leg in one bulk call
+    std::vector< long > startFix = toSerials( vecStartFixDate ), endFix = toSerials( vecEndFixDate );
+    std::vector< long > startFloat = toSerials( vecStartFloatDate ), endFloat = toSerials( vecEndFloatDate );
+    std::vector< long > startLibor = toSerials( vecStartLiborDate ), endLibor = toSerials( vecEndLiborDate );
+
+    std::vector< double> fix_yfrac( startFix.size() );
+    std::vector< double> fix_pay_ttm( startFix.size() );
+    yearFractions( &startFix, (long)refDay, endFix, FixDayCount, fix_yfrac );
+    yearFractions( 0, (long)refDay, endFix, zeroRateDayCount, fix_pay_ttm );
+
+    std::vector< double> float_yfrac( startFloat.size() );
+    std::vector< double> float_pay_ttm( startFloat.size() );
+    yearFractions( &startFloat, (long)refDay, endFloat, FloatDayCount, float_yfrac );
+    yearFractions( 0, (long)refDay, endFloat, zeroRateDayCount, float_pay_ttm );
+
+    std::vector< double> libor_yfrac( startLibor.size() );
+    std::vector< double> libor_start_ttm( startLibor.size() );
+    std::vector< double> libor_end_ttm( startLibor.size() );
+    yearFractions( &startLibor, (long)refDay, endLibor, LiborDayCount, libor_yfrac );
+    yearFractions( 0, (long)refDay, startLibor, zeroRateDayCount, libor_start_ttm );
+    yearFractions( 0, (long)refDay, endLibor, zeroRateDayCount, libor_end_ttm );
 
     /// out: pillar belonging to the discount curve : a vector of dates obtained by merging fix_pay_ttm and float_pay_ttm vectors
     std::vector<double> discount_pillar;
@@ -0,0 +1,85 @@
+//cCashflowGrid.cpp
+#include <algorithm>
+#include "cCashflowGrid.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace libor {
+
+CashflowGrid::CashflowGrid()
+: compiled_(false)
+{}
+
+long CashflowGrid::curveIndex(long curve)
+{
+   std::vector<long>::iterator it = std::find(curves_.begin(), curves_.end(), curve);
+   if(it != curves_.end()) return static_cast<long>(it - curves_.begin());
+   curves_.push_back(curve);
+   dates_.push_back(std::vector<long>());
+   return static_cast<long>(curves_.size()) - 1;
+}
+
+long CashflowGrid::add(long curve, long date)
+{
+   if(compiled_) throw pdg::Error(2, "#Error in CashflowGrid, request added after the grid was compiled");
+   //consecutive requests are mostly on the same curve
+   const long k = !requestCurve_.empty() && curves_[requestCurve_.back()] == curve ? requestCurve_.back() : curveIndex(curve);
+   requestCurve_.push_back(k);
+   slots_.push_back(date);
+   return static_cast<long>(slots_.size()) - 1;
+}
+
+void CashflowGrid::compile()
+{
+   if(compiled_) return;
+   compiled_ = true;
+   const long nCurves = static_cast<long>(curves_.size()), n = requests();
+
+   //range of the dates of each curve
+   std::vector<long> first(nCurves, 0), last(nCurves, -1);
+   for(long r = 0; r < n; ++r) {
+      const long k = requestCurve_[r], d = slots_[r];
+      if(last[k] < first[k]) first[k] = last[k] = d;
+      else first[k] = std::min(first[k], d), last[k] = std::max(last[k], d);
+   }
+
+   //requested dates marked on the range of each curve, numbered in ascending order
+   std::vector<std::vector<long> > index(nCurves);
+   for(long k = 0; k < nCurves; ++k) index[k].assign(last[k] - first[k] + 1, -1);
+   for(long r = 0; r < n; ++r) index[requestCurve_[r]][slots_[r] - first[requestCurve_[r]]] = 0;
+   offsets_.assign(nCurves + 1, 0);
+   for(long k = 0; k < nCurves; ++k) {
+      std::vector<long> &marks = index[k];
+      for(long j = 0; j < static_cast<long>(marks.size()); ++j) {
+         if(marks[j] < 0) continue;
+         marks[j] = offsets_[k] + static_cast<long>(dates_[k].size());
+         dates_[k].push_back(first[k] + j);
+      }
+      offsets_[k + 1] = offsets_[k] + static_cast<long>(dates_[k].size());
+   }
+   for(long r = 0; r < n; ++r) slots_[r] = index[requestCurve_[r]][slots_[r] - first[requestCurve_[r]]];
+}
+
+long CashflowGrid::find(long k, long date) const
+{
+   const std::vector<long> &d = dates_[k];
+   std::vector<long>::const_iterator it = std::lower_bound(d.begin(), d.end(), date);
+   return it == d.end() || *it != date ? -1 : offsets_[k] + static_cast<long>(it - d.begin());
+}
+
+void CashflowGrid::evaluate(const discount_function &discounts, std::vector<double> &values) const
+{
+   if(!compiled_) throw pdg::Error(2, "#Error in CashflowGrid, evaluated before it was compiled");
+   values.resize(points());
+   for(size_t k = 0; k < curves_.size(); ++k)
+      if(!dates_[k].empty())
+         discounts(curves_[k], &dates_[k][0], static_cast<long>(dates_[k].size()), &values[offsets_[k]]);
+}
+
+void CashflowGrid::scatter(const std::vector<double> &values, double *out) const
+{
+   const long n = requests();
+   for(long r = 0; r < n; ++r) out[r] = values[slots_[r]];
+}
+
+} // namespace libor
@@ -0,0 +1,69 @@
+//cCashflowGrid.h
+#ifndef _CCASHFLOWGRID_H__
+#define _CCASHFLOWGRID_H__
+
+#include <vector>
+#include <boost/function.hpp>
+
+namespace libor {
+
+/**
+* @defgroup cashflowgrid Distinct dates of a batch of curve requests.
+*
+* Instruments valued together need the discounts of a few curves on dates
+* that overlap heavily (roll dates, IMM dates). The grid collects every
+* (curve, date) request of the batch, then sorts and deduplicates the dates
+* of each curve with one counting pass over their range. Each curve is then
+* evaluated once, on its distinct dates in ascending order (the merge walk
+* of the curve blocks), into one flat array, and each request reads its
+* discount at its slot in the array.
+*/
+
+//@{
+//discounts of a curve id on n dates
+typedef boost::function<void (long curve, const long *dates, long n, double *out)> discount_function;
+
+class CashflowGrid
+{
+public:
+   CashflowGrid();
+
+   //request of the discount of curve on date, returns its index
+   long add(long curve, long date);
+   //sorts and deduplicates the dates of each curve, the requests then have their slots
+   void compile();
+
+   long requests() const { return static_cast<long>(requestCurve_.size()); }
+   //distinct curve ids, in the order of their first request
+   const std::vector<long> &curves() const { return curves_; }
+   //distinct ascending dates of curves()[k], at [offset(k), offset(k) + dates(k).size()) of the values
+   const std::vector<long> &dates(long k) const { return dates_[k]; }
+   long offset(long k) const { return offsets_[k]; }
+   //size of the values
+   long points() const { return offsets_.empty() ? 0 : offsets_.back(); }
+
+   //position of request r in the values
+   long slot(long r) const { return slots_[r]; }
+   //position of a date of curves()[k] in the values, -1 if it was not requested
+   long find(long k, long date) const;
+
+   //values = discounts of each curve on its dates, each curve evaluated once
+   void evaluate(const discount_function &discounts, std::vector<double> &values) const;
+   //out[r] = discount of request r
+   void scatter(const std::vector<double> &values, double *out) const;
+
+private:
+   long curveIndex(long curve);
+
+   std::vector<long> curves_;
+   std::vector<std::vector<long> > dates_;
+   std::vector<long> offsets_;              // offset of each curve, the number of values last
+   std::vector<long> requestCurve_;         // index in curves_ of each request
+   std::vector<long> slots_;                // date of each request until compiled, then its slot
+   bool compiled_;
+};
+//@}
+
+} // namespace libor
+
+#endif // _CCASHFLOWGRID_H__
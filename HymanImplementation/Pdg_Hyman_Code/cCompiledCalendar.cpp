@@ -0,0 +1,173 @@
+//cCompiledCalendar.cpp
+#include <algorithm>
+#include "cCompiledCalendar.h"
+#include "eDayCountBulk.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace libor {
+
+namespace {
+   const long WORD_BITS = 64;
+
+   long popCount(boost::uint64_t x)
+   {
+      x = x - ((x >> 1) & 0x5555555555555555ULL);
+      x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+      x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+      return static_cast<long>((x * 0x0101010101010101ULL) >> 56);
+   }
+
+   //Excel serial 1 is a Sunday
+   long weekDay(long date)
+   {
+      return ((date - 1) % 7 + 7) % 7;
+   }
+
+   //year * 12 + month of an Excel serial date
+   long monthIndex(long date)
+   {
+      long y, m, d;
+      daycount::civilDates(1, &date, &y, &m, &d);
+      return y * 12 + m;
+   }
+}
+
+CompiledCalendar::CompiledCalendar(long first, long last, const std::vector<long> &holidays, long weekendMask)
+: first_(first), last_(last)
+{
+   if(first <= 0 || last < first)
+      throw pdg::Error(2, "#Error in CompiledCalendar, invalid range " + xtos(first) + " to " + xtos(last));
+
+   base_ = first - first % WORD_BITS;
+   words_.assign((last - base_) / WORD_BITS + 1, 0);
+   for(long d = first; d <= last; ++d)
+      if(!(weekendMask & (1L << weekDay(d)))) words_[(d - base_) / WORD_BITS] |= boost::uint64_t(1) << ((d - base_) % WORD_BITS);
+   for(size_t i = 0; i < holidays.size(); ++i) {
+      const long d = holidays[i];
+      if(d < first || d > last) continue;
+      words_[(d - base_) / WORD_BITS] &= ~(boost::uint64_t(1) << ((d - base_) % WORD_BITS));
+   }
+   index();
+}
+
+CompiledCalendar CompiledCalendar::joint(const CompiledCalendar &a, const CompiledCalendar &b)
+{
+   CompiledCalendar res;
+   res.first_ = std::max(a.first_, b.first_);
+   res.last_ = std::min(a.last_, b.last_);
+   if(res.last_ < res.first_) throw pdg::Error(2, "#Error in CompiledCalendar::joint, the calendars have no common date");
+
+   res.base_ = res.first_ - res.first_ % WORD_BITS;
+   const long nWords = (res.last_ - res.base_) / WORD_BITS + 1;
+   const long offA = (res.base_ - a.base_) / WORD_BITS, offB = (res.base_ - b.base_) / WORD_BITS;
+   res.words_.resize(nWords);
+   for(long w = 0; w < nWords; ++w) res.words_[w] = a.words_[offA + w] & b.words_[offB + w];
+   //the days of the first and last words outside of the common range
+   const long head = res.first_ - res.base_, tail = (res.last_ - res.base_) % WORD_BITS;
+   res.words_[0] &= ~((boost::uint64_t(1) << head) - 1);
+   if(tail < WORD_BITS - 1) res.words_[nWords - 1] &= (boost::uint64_t(1) << (tail + 1)) - 1;
+   res.index();
+   return res;
+}
+
+void CompiledCalendar::index()
+{
+   rank_.resize(words_.size());
+   business_.clear();
+   long count = 0;
+   for(size_t w = 0; w < words_.size(); ++w) {
+      rank_[w] = count;
+      for(boost::uint64_t bits = words_[w]; bits; bits &= bits - 1) {
+         business_.push_back(base_ + static_cast<long>(w) * WORD_BITS + popCount((bits & (~bits + 1)) - 1));
+         ++count;
+      }
+   }
+}
+
+void CompiledCalendar::check(long date) const
+{
+   if(date < first_ || date > last_)
+      throw pdg::Error(2, "#Error in CompiledCalendar, date " + xtos(date) + " outside of the compiled range " +
+                          xtos(first_) + " to " + xtos(last_));
+}
+
+bool CompiledCalendar::isBusinessDay(long date) const
+{
+   check(date);
+   return (words_[(date - base_) / WORD_BITS] >> ((date - base_) % WORD_BITS)) & 1;
+}
+
+long CompiledCalendar::rank(long date) const
+{
+   check(date);
+   const long w = (date - base_) / WORD_BITS, b = (date - base_) % WORD_BITS;
+   const boost::uint64_t mask = b == WORD_BITS - 1 ? ~boost::uint64_t(0) : (boost::uint64_t(1) << (b + 1)) - 1;
+   return rank_[w] + popCount(words_[w] & mask);
+}
+
+long CompiledCalendar::select(long k) const
+{
+   if(k < 0 || k >= static_cast<long>(business_.size()))
+      throw pdg::Error(2, "#Error in CompiledCalendar, business day " + xtos(k) + " outside of the compiled range " +
+                          xtos(first_) + " to " + xtos(last_));
+   return business_[k];
+}
+
+long CompiledCalendar::addBusinessDays(long date, long n) const
+{
+   //business days up to date, and strictly before it
+   const long upTo = rank(date);
+   if(n > 0) return select(upTo + n - 1);
+   if(n < 0) return select(upTo - isBusinessDay(date) + n);
+   return adjust(date, bdFollowing);
+}
+
+long CompiledCalendar::adjust(long date, long rule) const
+{
+   if(rule == bdNone || isBusinessDay(date)) return date;
+   const long following = rank(date);
+   switch(rule) {
+      case bdFollowing:
+         return select(following);
+      case bdPreceding:
+         return select(following - 1);
+      case bdModFollowing: {
+         const long res = select(following);
+         return monthIndex(res) == monthIndex(date) ? res : select(following - 1);
+      }
+      case bdModPreceding: {
+         const long res = select(following - 1);
+         return monthIndex(res) == monthIndex(date) ? res : select(following);
+      }
+      default:
+         throw pdg::Error(2, "#Error in CompiledCalendar, unknown adjustment rule " + xtos(rule));
+   }
+}
+
+long CompiledCalendar::countBusinessDays(long from, long to) const
+{
+   return rank(to) - rank(from);
+}
+
+CompiledCalendars &CompiledCalendars::Instance()
+{
+   static CompiledCalendars calendars;
+   return calendars;
+}
+
+boost::shared_ptr<const CompiledCalendar> CompiledCalendars::find(long id) const
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   std::map<long, boost::shared_ptr<const CompiledCalendar> >::const_iterator it = calendars_.find(id);
+   if(it == calendars_.end()) throw pdg::Error(2, "#Error in CompiledCalendars, no calendar compiled with id " + xtos(id));
+   return it->second;
+}
+
+void CompiledCalendars::store(long id, const boost::shared_ptr<const CompiledCalendar> &calendar)
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   calendars_[id] = calendar;
+}
+
+} // namespace libor
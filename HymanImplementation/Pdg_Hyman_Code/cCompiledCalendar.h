@@ -0,0 +1,90 @@
+//cCompiledCalendar.h
+#ifndef _CCOMPILEDCALENDAR_H__
+#define _CCOMPILEDCALENDAR_H__
+
+#include <map>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace libor {
+
+/**
+* @defgroup compiledcalendar Compiled business day calendars.
+*
+* A calendar is compiled once over a range of Excel serial dates into a
+* bitset of its business days, one bit per day, with the number of business
+* days before each 64 bit word (rank) and the list of the business days
+* (select). Whether a date is a business day, the number of business days
+* between two dates, moving by n business days and the adjustment rules are
+* then a few table lookups, whatever the distance. The words are aligned on
+* absolute multiples of 64 days, so the joint calendar of two currencies
+* (business day in both) is the AND of their words.
+*/
+
+//@{
+enum business_day_rule { bdNone = 0, bdFollowing = 1, bdModFollowing = 2, bdPreceding = 3, bdModPreceding = 4 };
+
+//bit d of a weekend mask is day d of the week, Sunday first
+const long WEEKEND_SAT_SUN = (1 << 0) | (1 << 6);
+
+class CompiledCalendar
+{
+public:
+   //business days of [first, last]: neither a holiday nor a weekend day
+   CompiledCalendar(long first, long last, const std::vector<long> &holidays, long weekendMask = WEEKEND_SAT_SUN);
+
+   //business days of both calendars, over the common range
+   static CompiledCalendar joint(const CompiledCalendar &a, const CompiledCalendar &b);
+
+   long first() const { return first_; }
+   long last() const { return last_; }
+   bool isBusinessDay(long date) const;
+   //business days in [first(), date]
+   long rank(long date) const;
+   //business day of index k, the first one is 0
+   long select(long k) const;
+
+   //n-th business day after date (before it when n < 0), the following business day when n = 0
+   long addBusinessDays(long date, long n) const;
+   long adjust(long date, long rule) const;
+   //business days in (from, to], negative when to < from
+   long countBusinessDays(long from, long to) const;
+
+private:
+   CompiledCalendar() {}
+   void index();
+   void check(long date) const;
+
+   long first_;
+   long last_;
+   long base_;                                  // date of bit 0 of word 0, a multiple of 64
+   std::vector<boost::uint64_t> words_;
+   std::vector<long> rank_;                     // business days before each word
+   std::vector<long> business_;                 // the business days, in order
+};
+
+//compiled calendars by id, shared by the entry points
+class CompiledCalendars
+{
+public:
+   static CompiledCalendars &Instance();
+
+   //throws if the id has no calendar
+   boost::shared_ptr<const CompiledCalendar> find(long id) const;
+   void store(long id, const boost::shared_ptr<const CompiledCalendar> &calendar);
+
+private:
+   CompiledCalendars() {}
+   CompiledCalendars(const CompiledCalendars &);
+   CompiledCalendars &operator=(const CompiledCalendars &);
+
+   mutable boost::mutex mutex_;
+   std::map<long, boost::shared_ptr<const CompiledCalendar> > calendars_;
+};
+//@}
+
+} // namespace libor
+
+#endif // _CCOMPILEDCALENDAR_H__
@@ -0,0 +1,215 @@
+//cCurveRegistry.cpp
+#include <cctype>
+#include "cCurveRegistry.h"
+#include "cShmCurveStore.h"
+#include "eAtomic.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace shm_curve {
+
+namespace {
+   const long GENERATION_BITS = 15;
+
+   long makeHandle(long idx, boost::uint32_t generation)
+   {
+      return static_cast<long>((generation & ((1u << GENERATION_BITS) - 1)) << 16) | idx;
+   }
+
+   //the generation bits of a handle are never zero, so that no handle is zero
+   void bumpGeneration(boost::uint32_t &generation)
+   {
+      if(!(++generation & ((1u << GENERATION_BITS) - 1))) ++generation;
+   }
+
+   //retries of a lookup racing a writer before it waits on the mutex
+   const long READ_RETRIES = 64;
+}
+
+CurveRegistry::CurveRegistry()
+{
+   for(long i = 0; i < REGISTRY_MAX_CURVES / REGISTRY_CHUNK; ++i) chunks_[i] = 0;
+}
+
+CurveRegistry::~CurveRegistry()
+{
+   for(long i = 0; i < REGISTRY_MAX_CURVES / REGISTRY_CHUNK; ++i) delete [] chunks_[i];
+}
+
+CurveRegistry &CurveRegistry::Instance()
+{
+   static CurveRegistry registry;
+   return registry;
+}
+
+CurveRegistry::HotEntry &CurveRegistry::hot(long idx)
+{
+   HotEntry *chunk = chunks_[idx / REGISTRY_CHUNK];
+   if(!chunk) {
+      chunk = new HotEntry[REGISTRY_CHUNK];
+      for(long i = 0; i < REGISTRY_CHUNK; ++i) chunk[i].seq = chunk[i].handle = chunk[i].slot = chunk[i].slotGeneration = 0;
+      //the words are initialised before the chunk is seen by the readers
+      atomic_ops::fence();
+      chunks_[idx / REGISTRY_CHUNK] = chunk;
+   }
+   return chunk[idx % REGISTRY_CHUNK];
+}
+
+void CurveRegistry::writeHot(long idx, boost::uint32_t handle, long slot, boost::uint32_t slotGeneration)
+{
+   HotEntry &h = hot(idx);
+   atomic_ops::store(h.seq, h.seq + 1);
+   h.handle = handle;
+   h.slot = static_cast<boost::uint32_t>(slot + 1);
+   h.slotGeneration = slotGeneration;
+   atomic_ops::store(h.seq, h.seq + 1);
+}
+
+void CurveRegistry::readSlot(long handle, long &slot, boost::uint32_t &slotGeneration) const
+{
+   const long idx = handle & 0xFFFF;
+   const HotEntry *chunk = handle > 0 && idx < REGISTRY_MAX_CURVES ? chunks_[idx / REGISTRY_CHUNK] : 0;
+   atomic_ops::fence();
+   if(!chunk) throw pdg::Error(2, "#Error in CurveRegistry, invalid curve handle " + xtos(handle));
+   const HotEntry &h = chunk[idx % REGISTRY_CHUNK];
+   for(long retry = 0; retry < READ_RETRIES; ++retry) {
+      const boost::uint32_t seq = atomic_ops::load(h.seq);
+      if(seq & 1) continue;
+      const boost::uint32_t live = h.handle;
+      slot = static_cast<long>(h.slot) - 1;
+      slotGeneration = h.slotGeneration;
+      if(atomic_ops::load(h.seq) != seq) continue;
+      if(live != static_cast<boost::uint32_t>(handle))
+         throw pdg::Error(2, "#Error in CurveRegistry, stale curve handle " + xtos(handle) + ", resolve the curve name again");
+      return;
+   }
+   //a writer holds the entry: wait for it on the mutex
+   boost::mutex::scoped_lock lock(mutex_);
+   index(handle);
+   slot = static_cast<long>(h.slot) - 1;
+   slotGeneration = h.slotGeneration;
+}
+
+std::string CurveRegistry::canonicalName(const char *name)
+{
+   if(!name) throw pdg::Error(2, "#Error in CurveRegistry, null curve name");
+   std::string res(name);
+   std::string::size_type first = res.find_first_not_of(" \t");
+   std::string::size_type last = res.find_last_not_of(" \t");
+   res = (first == std::string::npos) ? std::string() : res.substr(first, last - first + 1);
+   for(std::string::iterator it = res.begin(); it != res.end(); ++it) *it = static_cast<char>(toupper(*it));
+   if(res.empty()) throw pdg::Error(2, "#Error in CurveRegistry, empty curve name");
+   return res;
+}
+
+long CurveRegistry::index(long handle) const
+{
+   const long idx = handle & 0xFFFF;
+   if(handle <= 0 || idx >= static_cast<long>(entries_.size()))
+      throw pdg::Error(2, "#Error in CurveRegistry, invalid curve handle " + xtos(handle));
+   const Entry &e = entries_[idx];
+   if(!e.live || makeHandle(idx, e.generation) != handle)
+      throw pdg::Error(2, "#Error in CurveRegistry, stale curve handle " + xtos(handle) + ", resolve the curve name again");
+   return idx;
+}
+
+long CurveRegistry::intern(const std::string &canonical)
+{
+   std::map<std::string, long>::const_iterator it = ids_.find(canonical);
+   if(it != ids_.end()) return it->second;
+
+   long idx;
+   if(!free_.empty()) {
+      idx = free_.back();
+      free_.pop_back();
+   }
+   else {
+      if(static_cast<long>(entries_.size()) == REGISTRY_MAX_CURVES)
+         throw pdg::Error(2, "#Error in CurveRegistry, too many curve handles");
+      idx = static_cast<long>(entries_.size());
+      entries_.push_back(Entry());
+   }
+   Entry &e = entries_[idx];
+   e.name = canonical;
+   e.live = true;
+   e.liborHandle = -1;
+   writeHot(idx, makeHandle(idx, e.generation), -1, 0);
+   ids_[canonical] = idx;
+   return idx;
+}
+
+long CurveRegistry::resolve(const char *name)
+{
+   const std::string canonical = canonicalName(name);
+   boost::mutex::scoped_lock lock(mutex_);
+   const long idx = intern(canonical);
+   return makeHandle(idx, entries_[idx].generation);
+}
+
+void CurveRegistry::release(long handle)
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   const long idx = index(handle);
+   Entry &e = entries_[idx];
+   ids_.erase(e.name);
+   e.live = false;
+   e.name.clear();
+   bumpGeneration(e.generation);
+   writeHot(idx, 0, -1, 0);
+   free_.push_back(idx);
+}
+
+void CurveRegistry::invalidate(const char *name)
+{
+   const std::string canonical = canonicalName(name);
+   boost::mutex::scoped_lock lock(mutex_);
+   std::map<std::string, long>::const_iterator it = ids_.find(canonical);
+   if(it == ids_.end()) return;
+   Entry &e = entries_[it->second];
+   bumpGeneration(e.generation);
+   e.liborHandle = -1;
+   writeHot(it->second, makeHandle(it->second, e.generation), -1, 0);
+}
+
+std::string CurveRegistry::name(long handle) const
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   return entries_[index(handle)].name;
+}
+
+long CurveRegistry::liborHandle(const char *name) const
+{
+   const std::string canonical = canonicalName(name);
+   boost::mutex::scoped_lock lock(mutex_);
+   std::map<std::string, long>::const_iterator it = ids_.find(canonical);
+   return it == ids_.end() ? -1 : entries_[it->second].liborHandle;
+}
+
+void CurveRegistry::setLiborHandle(const char *name, long liborHandle)
+{
+   const std::string canonical = canonicalName(name);
+   boost::mutex::scoped_lock lock(mutex_);
+   entries_[intern(canonical)].liborHandle = liborHandle;
+}
+
+bool CurveRegistry::interpDisc(long handle, const long *dates, long n, double *out)
+{
+   long slot;
+   boost::uint32_t slotGeneration;
+   readSlot(handle, slot, slotGeneration);
+
+   ShmCurveStore &store = ShmCurveStore::Instance();
+   if(slot >= 0 && store.interpDiscSlot(slot, slotGeneration, dates, n, out)) return true;
+
+   //first use, or the slot has been freed or reused: find the curve by name and cache its slot
+   slot = store.findSlot(name(handle).c_str(), &slotGeneration);
+   if(slot < 0) return false;
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      const long idx = index(handle);
+      writeHot(idx, static_cast<boost::uint32_t>(handle), slot, slotGeneration);
+   }
+   return store.interpDiscSlot(slot, slotGeneration, dates, n, out);
+}
+
+} // namespace shm_curve
@@ -0,0 +1,96 @@
+//cCurveRegistry.h
+#ifndef _CCURVEREGISTRY_H__
+#define _CCURVEREGISTRY_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace shm_curve {
+
+/**
+* @defgroup curveregistry Interned curve names and handles.
+*
+* Curve names are canonicalised (trimmed, upper case) and interned once per
+* process. A handle packs the index of the entry in a dense table with the
+* generation of the entry: resolving a handle is a bounds checked index and
+* a generation compare, a handle issued before the curve was cleared (or the
+* handle released) is detected as stale.
+* Each entry caches what the shm entry points need to reach the curve: the
+* libor_client handle and the slot of the curve block. The live handle and
+* the slot of each entry are also kept in fixed chunks of words that never
+* move, written under the mutex and read without it (a seqlock per entry):
+* evaluating a handle takes no lock unless its slot has to be found again.
+*/
+
+//@{
+const long REGISTRY_MAX_CURVES = 0x10000;
+const long REGISTRY_CHUNK = 0x100;
+
+class CurveRegistry
+{
+public:
+   static CurveRegistry &Instance();
+
+   static std::string canonicalName(const char *name);
+
+   //handle of the name, interned on first use
+   long resolve(const char *name);
+   void release(long handle);
+   //makes the handles of the name stale (the curve has been cleared)
+   void invalidate(const char *name);
+
+   //canonical name of a live handle, throws on a stale or invalid one
+   std::string name(long handle) const;
+
+   //libor_client handle cached for the name, -1 if not cached yet
+   long liborHandle(const char *name) const;
+   void setLiborHandle(const char *name, long liborHandle);
+
+   //discounts of the curve block of the handle, false if the curve has no evaluable block
+   bool interpDisc(long handle, const long *dates, long n, double *out);
+
+private:
+   struct Entry {
+      Entry() : generation(1), live(false), liborHandle(-1) {}
+      std::string name;
+      boost::uint32_t generation;
+      bool live;
+      long liborHandle;
+   };
+
+   //what a lookup without the mutex reads
+   struct HotEntry {
+      volatile boost::uint32_t seq;             // odd while the entry is written
+      volatile boost::uint32_t handle;          // live handle of the entry, 0 if none
+      volatile boost::uint32_t slot;            // slot + 1 of the block in ShmCurveStore, 0 if not resolved
+      volatile boost::uint32_t slotGeneration;
+   };
+
+   CurveRegistry();
+   ~CurveRegistry();
+   CurveRegistry(const CurveRegistry &);
+   CurveRegistry &operator=(const CurveRegistry &);
+
+   //the mutex must be locked by the callers of the following four functions
+   long index(long handle) const;
+   long intern(const std::string &canonical);
+   HotEntry &hot(long idx);
+   void writeHot(long idx, boost::uint32_t handle, long slot, boost::uint32_t slotGeneration);
+
+   //slot cached for a live handle, without the mutex; throws on a stale or invalid handle
+   void readSlot(long handle, long &slot, boost::uint32_t &slotGeneration) const;
+
+   mutable boost::mutex mutex_;
+   HotEntry *volatile chunks_[REGISTRY_MAX_CURVES / REGISTRY_CHUNK];
+   std::vector<Entry> entries_;
+   std::vector<long> free_;
+   std::map<std::string, long> ids_;
+};
+//@}
+
+} // namespace shm_curve
+
+#endif // _CCURVEREGISTRY_H__
@@ -0,0 +1,116 @@
+//cParallelReduce.cpp
+#include <algorithm>
+#include <string>
+#include <boost/bind.hpp>
+#include <boost/thread/tss.hpp>
+#include "cParallelReduce.h"
+#include "cThreadPool.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace parallel {
+
+namespace {
+   const size_t ARENA_BLOCK = 1 << 16;
+   const size_t ARENA_ALIGN = 16;
+
+   boost::thread_specific_ptr<ScratchArena> threadArena;
+
+   //one chunk of a loop, its error kept for the caller
+   void runChunk(const range_function *body, long begin, long end, std::string *error)
+   {
+      try {
+         ScratchArena &scratch = ScratchArena::local();
+         scratch.reset();
+         (*body)(begin, end, scratch);
+      }
+      catch(pdg::Error e) {
+         *error = e.getInfo().des;
+      }
+      catch(...) {
+         *error = "#Error in parallelFor, chunk " + xtos(begin) + " to " + xtos(end) + " failed";
+      }
+   }
+
+   //chunk of a sum, accumulated in the partial of the chunk
+   void sumChunk(const reduce_function *body, std::vector<double> *partials, long grain, long width,
+                 long begin, long end, ScratchArena &scratch)
+   {
+      (*body)(begin, end, scratch, &(*partials)[(begin / grain) * width]);
+   }
+}
+
+ScratchArena::ScratchArena()
+: block_(0), used_(0)
+{}
+
+ScratchArena::~ScratchArena()
+{
+   for(size_t i = 0; i < blocks_.size(); ++i) delete [] blocks_[i];
+}
+
+ScratchArena &ScratchArena::local()
+{
+   if(!threadArena.get()) threadArena.reset(new ScratchArena);
+   return *threadArena;
+}
+
+void ScratchArena::reset()
+{
+   block_ = 0;
+   used_ = 0;
+}
+
+void *ScratchArena::bytes(size_t n)
+{
+   n = (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+   //the next block with room, a new one after the last
+   while(block_ < blocks_.size() && used_ + n > sizes_[block_]) {
+      ++block_;
+      used_ = 0;
+   }
+   if(block_ == blocks_.size()) {
+      const size_t size = std::max(n, ARENA_BLOCK);
+      blocks_.push_back(new char[size]);
+      sizes_.push_back(size);
+   }
+   void *res = blocks_[block_] + used_;
+   used_ += n;
+   return res;
+}
+
+void parallelFor(ThreadPool &pool, long n, long grain, const range_function &body)
+{
+   if(n <= 0) return;
+   if(grain <= 0) throw pdg::Error(2, "#Error in parallelFor, grain " + xtos(grain) + " not positive");
+
+   const long nChunks = (n + grain - 1) / grain;
+   std::vector<std::string> errors(nChunks);
+   if(nChunks == 1) {
+      runChunk(&body, 0, n, &errors[0]);
+   }
+   else {
+      std::vector<ThreadPool::task_type> tasks(nChunks);
+      for(long k = 0; k < nChunks; ++k)
+         tasks[k] = boost::bind(&runChunk, &body, k * grain, std::min(n, (k + 1) * grain), &errors[k]);
+      pool.run(tasks);
+   }
+   for(long k = 0; k < nChunks; ++k)
+      if(errors[k].size() > 0) throw pdg::Error(2, errors[k]);
+}
+
+void parallelSum(ThreadPool &pool, long n, long grain, long width, const reduce_function &body, double *out)
+{
+   std::fill(out, out + width, 0.0);
+   if(n <= 0 || width <= 0) return;
+   if(grain <= 0) throw pdg::Error(2, "#Error in parallelSum, grain " + xtos(grain) + " not positive");
+
+   //chunk k accumulates in partials[k * width, (k + 1) * width)
+   const long nChunks = (n + grain - 1) / grain;
+   std::vector<double> partials(nChunks * width, 0.0);
+   parallelFor(pool, n, grain, boost::bind(&sumChunk, &body, &partials, grain, width, _1, _2, _3));
+   for(long k = 0; k < nChunks; ++k)
+      for(long j = 0; j < width; ++j) out[j] += partials[k * width + j];
+}
+
+} // namespace parallel
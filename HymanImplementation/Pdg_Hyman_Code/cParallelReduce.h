@@ -0,0 +1,67 @@
+//cParallelReduce.h
+#ifndef _CPARALLELREDUCE_H__
+#define _CPARALLELREDUCE_H__
+
+#include <cstddef>
+#include <vector>
+#include <boost/function.hpp>
+
+namespace parallel {
+
+class ThreadPool;
+
+/**
+* @defgroup parallelreduce Deterministic parallel loops.
+*
+* A range [0, n) is cut in chunks of a fixed grain, whatever the number of
+* threads, and the chunks are tasks of the pool. A reduction accumulates each
+* chunk in its own partial and adds the partials in the order of the chunks
+* once all of them are done: the result is the same to the bit with one
+* thread or many. Each chunk gets the scratch arena of the thread running
+* it, rewound at the start of the chunk, for its temporaries. The bodies read
+* shared data that nothing modifies during the loop (snapshots of the
+* curves taken before it), so they need no lock.
+*/
+
+//@{
+class ScratchArena
+{
+public:
+   ScratchArena();
+   ~ScratchArena();
+
+   //room for n objects of type T, valid until the next reset
+   template <class T>
+   T *alloc(size_t n) { return static_cast<T *>(bytes(n * sizeof(T))); }
+   //frees everything allocated, the memory is kept for the next allocations
+   void reset();
+
+   //arena of the calling thread
+   static ScratchArena &local();
+
+private:
+   ScratchArena(const ScratchArena &);
+   ScratchArena &operator=(const ScratchArena &);
+
+   void *bytes(size_t n);
+
+   std::vector<char *> blocks_;
+   std::vector<size_t> sizes_;
+   size_t block_;                   // block being allocated from
+   size_t used_;                    // bytes used in it
+};
+
+typedef boost::function<void (long begin, long end, ScratchArena &scratch)> range_function;
+//adds the contribution of [begin, end) to partial, zeroed by the caller
+typedef boost::function<void (long begin, long end, ScratchArena &scratch, double *partial)> reduce_function;
+
+//body on the chunks [k * grain, (k + 1) * grain) of [0, n); the first error of a chunk, in the order of
+//the chunks, is thrown once all of them are done. Not to be called from a task of the pool.
+void parallelFor(ThreadPool &pool, long n, long grain, const range_function &body);
+//out[0, width) = sum of the partials of the chunks, in the order of the chunks
+void parallelSum(ThreadPool &pool, long n, long grain, long width, const reduce_function &body, double *out);
+//@}
+
+} // namespace parallel
+
+#endif // _CPARALLELREDUCE_H__
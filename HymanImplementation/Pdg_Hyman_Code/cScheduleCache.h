@@ -0,0 +1,163 @@
+//cScheduleCache.h
+#ifndef _CSCHEDULECACHE_H__
+#define _CSCHEDULECACHE_H__
+
+#include <list>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace libor {
+
+/**
+* @defgroup schedulecache Memoised swap schedules.
+*
+* Building a swap generates its fixed and floating schedules, adjusts them
+* on the calendar of the currency and computes the year fractions, while the
+* sheets price the same swaps over and over. The cache keeps what was built,
+* keyed by the terms of the swap (the fixed rate and the notional included, so
+* that a swap is priced exactly as built), in least recently used order up to a bounded number of entries. Entries are
+* shared pointers to immutable data, an eviction does not invalidate an entry
+* still in use. A miss is built by the caller outside the lock: when two
+* threads miss the same key both build it and the first one inserted is kept.
+*/
+
+//@{
+//terms and conventions of a swap
+struct SwapKey {
+   SwapKey()
+   : currency(0), start(0), maturity(0), matMonths(0), fixFreq(0), fixDayCount(0), fltFreq(0), fltDayCount(0),
+     adjust(0), firstCpnFixed(false), firstCpn(0.), fullFloatLegEval(false), fixRate(0.), nominal(100.)
+   {}
+
+   long currency;
+   long start;
+   long maturity;
+   long matMonths;
+   long fixFreq;
+   long fixDayCount;
+   long fltFreq;
+   long fltDayCount;
+   long adjust;
+   bool firstCpnFixed;
+   double firstCpn;
+   bool fullFloatLegEval;
+   double fixRate;
+   double nominal;
+
+   bool operator<(const SwapKey &o) const
+   {
+      #define SWAPKEY_LESS(f) if(f != o.f) return f < o.f;
+      SWAPKEY_LESS(currency) SWAPKEY_LESS(start) SWAPKEY_LESS(maturity) SWAPKEY_LESS(matMonths)
+      SWAPKEY_LESS(fixFreq) SWAPKEY_LESS(fixDayCount) SWAPKEY_LESS(fltFreq) SWAPKEY_LESS(fltDayCount)
+      SWAPKEY_LESS(adjust) SWAPKEY_LESS(firstCpnFixed) SWAPKEY_LESS(firstCpn) SWAPKEY_LESS(fullFloatLegEval)
+      SWAPKEY_LESS(fixRate)
+      #undef SWAPKEY_LESS
+      return nominal < o.nominal;
+   }
+};
+
+struct ScheduleCacheStats {
+   long hits;
+   long misses;
+   long evictions;
+   long size;
+   long capacity;
+};
+
+template <class Key, class T>
+class ScheduleCache
+{
+public:
+   typedef boost::shared_ptr<T> value_type;
+
+   explicit ScheduleCache(long capacity = 1024) : capacity_(capacity), hits_(0), misses_(0), evictions_(0) {}
+
+   //entry of key, null on a miss
+   value_type find(const Key &key)
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      typename index_type::iterator it = index_.find(key);
+      if(it == index_.end()) {
+         ++misses_;
+         return value_type();
+      }
+      ++hits_;
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return it->second->second;
+   }
+
+   //inserts the entry built on a miss, returns the one already there if any
+   value_type insert(const Key &key, const value_type &value)
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      if(capacity_ <= 0) return value;
+      typename index_type::iterator it = index_.find(key);
+      if(it != index_.end()) return it->second->second;
+      lru_.push_front(std::make_pair(key, value));
+      index_[key] = lru_.begin();
+      trim();
+      return value;
+   }
+
+   //drops the entry of key, a stale one
+   void erase(const Key &key)
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      typename index_type::iterator it = index_.find(key);
+      if(it == index_.end()) return;
+      lru_.erase(it->second);
+      index_.erase(it);
+   }
+
+   //0 disables the cache
+   void setCapacity(long capacity)
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      capacity_ = capacity;
+      trim();
+   }
+
+   void clear()
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      lru_.clear();
+      index_.clear();
+   }
+
+   ScheduleCacheStats stats() const
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      ScheduleCacheStats res = { hits_, misses_, evictions_, static_cast<long>(index_.size()), capacity_ };
+      return res;
+   }
+
+private:
+   typedef std::list<std::pair<Key, value_type> > lru_type;
+   typedef std::map<Key, typename lru_type::iterator> index_type;
+
+   //the mutex must be locked
+   void trim()
+   {
+      while(static_cast<long>(index_.size()) > std::max(capacity_, 0L)) {
+         index_.erase(lru_.back().first);
+         lru_.pop_back();
+         ++evictions_;
+      }
+   }
+
+   mutable boost::mutex mutex_;
+   lru_type lru_;                      // most recently used first
+   index_type index_;
+   long capacity_;
+   long hits_;
+   long misses_;
+   long evictions_;
+};
+//@}
+
+} // namespace libor
+
+#endif // _CSCHEDULECACHE_H__
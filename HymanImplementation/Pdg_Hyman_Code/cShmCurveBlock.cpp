@@ -0,0 +1,806 @@
+//cShmCurveBlock.cpp
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "cShmCurveBlock.h"
+#include "eAtomic.h"
+#include "eInterpolator.h"
+#include "eContInterp.hpp"
+#include "ciDates.h"
+#include "eDayCountBulk.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace shm_curve {
+
+namespace {
+   enum seed_type { stNone = 0, stRate = 1, stRateTime = 2, stDiscount = 3 };
+
+   enum interp_code { icLinear = 1, icQuadratic = 2, icConst = 3, icSpline = 4, icKruger = 5, icMonotonicSpline = 6 };
+
+   //days in a year of an ACT day count, 0 for the other bases
+   double actDays(long dayCount)
+   {
+      switch(daycount::basisOf(dayCount)) {
+         case daycount::dbAct360: return 360.0;
+         case daycount::dbAct365: return 365.0;
+         default: return 0.0;
+      }
+   }
+
+   size_t alignUp(size_t bytes)
+   {
+      return (bytes + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+   }
+
+   long seedType(long interpOn)
+   {
+      long seed = interpOn % 20;
+      return (seed >= stRate && seed <= stDiscount) ? seed : static_cast<long>(stNone);
+   }
+
+   double discountToRate(double disc, double t, long comp)
+   {
+      switch(comp) {
+         case 1: return (1.0 / disc - 1.0) / t;
+         case 2: return std::pow(disc, -1.0 / t) - 1.0;
+         default: return -std::log(disc) / t;
+      }
+   }
+
+   double rateToDiscount(double rate, double t, long comp)
+   {
+      switch(comp) {
+         case 1: return 1.0 / (1.0 + rate * t);
+         case 2: return std::pow(1.0 + rate, -t);
+         default: return std::exp(-rate * t);
+      }
+   }
+
+   //natural cubic spline written in place as y + dx * (b + dx * (c + dx * d))
+   void naturalSpline(const double *x, const double *y, long n, double *b, double *c, double *d)
+   {
+      //second derivatives are solved in c with the Thomas algorithm, b holds the modified super-diagonal
+      c[0] = 0.0;
+      b[0] = 0.0;
+      for(long i = 1; i < n - 1; ++i) {
+         const double h0 = x[i] - x[i - 1];
+         const double h1 = x[i + 1] - x[i];
+         const double rhs = 6.0 * ((y[i + 1] - y[i]) / h1 - (y[i] - y[i - 1]) / h0);
+         const double den = 2.0 * (h0 + h1) - h0 * b[i - 1];
+         b[i] = h1 / den;
+         c[i] = (rhs - h0 * c[i - 1]) / den;
+      }
+      c[n - 1] = 0.0;
+      for(long i = n - 2; i > 0; --i)
+         c[i] -= b[i] * c[i + 1];
+
+      for(long i = 0; i < n - 1; ++i) {
+         const double h = x[i + 1] - x[i];
+         b[i] = (y[i + 1] - y[i]) / h - h * (2.0 * c[i] + c[i + 1]) / 6.0;
+         d[i] = (c[i + 1] - c[i]) / (6.0 * h);
+         c[i] *= 0.5;
+      }
+   }
+
+   //Hyman filter on the first derivatives of a cubic, then hermite coefficients
+   void hymanFilter(const double *x, const double *y, long n, double *b, double *c, double *d)
+   {
+      const long last = n - 1;
+      const double hl = x[last] - x[last - 1];
+      double pLast = b[last - 1] + hl * (2.0 * c[last - 1] + 3.0 * hl * d[last - 1]);
+
+      #define SLOPE(k) ((y[(k) + 1] - y[(k)]) / (x[(k) + 1] - x[(k)]))
+      #define DX(k) (x[(k) + 1] - x[(k)])
+      for(long i = 0; i <= last; ++i) {
+         double &p = (i == last) ? pLast : b[i];
+         double filter;
+         if(i == 0) {
+            const double s0 = SLOPE(0);
+            filter = (p * s0 > 0.0) ? p / std::fabs(p) * std::min(std::fabs(p), std::fabs(3.0 * s0)) : 0.0;
+         }
+         else if(i == last) {
+            const double sl = SLOPE(last - 1);
+            filter = (p * sl > 0.0) ? p / std::fabs(p) * std::min(std::fabs(p), std::fabs(3.0 * sl)) : 0.0;
+         }
+         else {
+            const double sm = SLOPE(i - 1), s = SLOPE(i);
+            const double pm = (sm * DX(i) + s * DX(i - 1)) / (DX(i - 1) + DX(i));
+            double M = 3.0 * std::min(std::min(std::fabs(sm), std::fabs(s)), std::fabs(pm));
+            if(i > 1) {
+               const double smm = SLOPE(i - 2);
+               if((sm - smm) * (s - sm) > 0.0) {
+                  const double pd = (sm * (2.0 * DX(i - 1) + DX(i - 2)) - smm * DX(i - 1)) / (DX(i - 2) + DX(i - 1));
+                  if(pm * pd > 0.0 && pm * (sm - smm) > 0.0)
+                     M = std::max(M, 1.5 * std::min(std::fabs(pm), std::fabs(pd)));
+               }
+            }
+            if(i < last - 1) {
+               const double sp = SLOPE(i + 1);
+               if((s - sm) * (sp - s) > 0.0) {
+                  const double pu = (s * (2.0 * DX(i) + DX(i + 1)) - sp * DX(i)) / (DX(i) + DX(i + 1));
+                  if(pm * pu > 0.0 && -pm * (s - sm) > 0.0)
+                     M = std::max(M, 1.5 * std::min(std::fabs(pm), std::fabs(pu)));
+               }
+            }
+            filter = (p * pm > 0.0) ? p / std::fabs(p) * std::min(std::fabs(p), M) : 0.0;
+         }
+         p = filter;
+      }
+
+      for(long i = 0; i < last; ++i) {
+         const double h = DX(i);
+         const double s = SLOPE(i);
+         const double p0 = b[i];
+         const double p1 = (i + 1 == last) ? pLast : b[i + 1];
+         c[i] = (3.0 * s - 2.0 * p0 - p1) / h;
+         d[i] = (p0 + p1 - 2.0 * s) / (h * h);
+      }
+      #undef DX
+      #undef SLOPE
+   }
+
+   //coefficients b, c, d of the interpolation of the seeds y, returns the block flags they allow
+   boost::uint32_t interpCoefficients(long typeInterp, const double *t, const double *y, long n, double *b, double *c, double *d)
+   {
+      switch(typeInterp) {
+         case icLinear:
+            for(long i = 0; i < n - 1; ++i) {
+               b[i] = (y[i + 1] - y[i]) / (t[i + 1] - t[i]);
+               c[i] = d[i] = 0.;
+            }
+            return bfEvaluable;
+         case icQuadratic:
+         case icConst:
+            return bfEvaluable;
+         case icSpline:
+            //the engine interpolates up to three pillars linearly
+            if(n <= 3) return 0;
+            naturalSpline(t, y, n, b, c, d);
+            return bfEvaluable | bfCubic;
+         case icKruger:
+            if(n < 4) return 0;
+            cont_interp::kruger_preconditioning(t, t + n, y, b, c, d);
+            return bfEvaluable | bfCubic;
+         case icMonotonicSpline:
+            if(n <= 3) return 0;
+            naturalSpline(t, y, n, b, c, d);
+            hymanFilter(t, y, n, b, c, d);
+            return bfEvaluable | bfCubic;
+         default:
+            return 0;
+      }
+   }
+
+   //relative to the seeds, beyond the rounding of the engine's B-spline solve
+   const double ENGINE_SPLINE_TOLERANCE = 1.e-9;
+
+   //the natural spline of the seeds against interp::interpNaturalBSpline, the routine of the engine curves, at
+   //the pillars and the middle of the intervals; the monotonic spline is checked before the Hyman filter, a port
+   //of the one of interp::interpMonotonicNaturalBSpline, the Kruger cubics are the engine's own
+   bool matchesEngine(long typeInterp, const double *t, const double *y, long n)
+   {
+      if(typeInterp != icSpline && typeInterp != icMonotonicSpline) return true;
+      std::vector<double> b(n), c(n), d(n);
+      naturalSpline(t, y, n, &b[0], &c[0], &d[0]);
+
+      std::vector<double> x(t, t + n), v(y, y + n), probes(2 * n - 1);
+      for(long i = 0; i < n; ++i) probes[2 * i] = t[i];
+      for(long i = 0; i < n - 1; ++i) probes[2 * i + 1] = 0.5 * (t[i] + t[i + 1]);
+      const std::vector<double> engine = interp::interpNaturalBSpline(x, v, probes);
+      for(long k = 0; k < 2 * n - 1; ++k) {
+         const long i = std::min(k / 2, n - 2);
+         const double dx = probes[k] - t[i];
+         const double block = y[i] + dx * (b[i] + dx * (c[i] + dx * d[i]));
+         if(!(std::fabs(block - engine[k]) <= ENGINE_SPLINE_TOLERANCE * std::max(1.0, std::fabs(engine[k])))) return false;
+      }
+      return true;
+   }
+
+   //d discountToRate / d disc
+   double discountToRateDerivative(double disc, double t, long comp)
+   {
+      switch(comp) {
+         case 1: return -1.0 / (disc * disc * t);
+         case 2: return -std::pow(disc, -1.0 / t - 1.0) / t;
+         default: return -1.0 / (disc * t);
+      }
+   }
+
+   //d rateToDiscount / d rate
+   double rateToDiscountDerivative(double rate, double t, long comp)
+   {
+      switch(comp) {
+         case 1: {
+            const double disc = 1.0 / (1.0 + rate * t);
+            return -t * disc * disc;
+         }
+         case 2: return -t * std::pow(1.0 + rate, -t - 1.0);
+         default: return -t * std::exp(-rate * t);
+      }
+   }
+
+   //relative bump of the seeds differentiating the filtered cubics by central differences, see
+   //ShmCurveBlockAdjoint for the accuracy
+   const double JACOBIAN_BUMP = 1.e-6;
+
+   //spins on a block held by a writer before yielding
+   const long WRITER_SPINS = 1024;
+}
+
+BlockSpec::BlockSpec()
+: currency(0), typeInterp(1), interpOn(1), comp(3), dayCount(5), version(0), publishTime(0.), name(0), backbone(0), evaluable(true)
+{}
+
+void copyName(char *dest, const char *src)
+{
+   std::memset(dest, 0, BLOCK_NAME_SZ);
+   if(src) {
+      for(size_t i = 0; i < BLOCK_NAME_SZ - 1 && src[i]; ++i)
+         dest[i] = static_cast<char>(toupper(src[i]));
+   }
+}
+
+bool sameName(const char *stored, const char *name)
+{
+   size_t i = 0;
+   for(; i < BLOCK_NAME_SZ - 1 && name[i]; ++i)
+      if(stored[i] != static_cast<char>(toupper(name[i]))) return false;
+   return stored[i] == 0 && (i < BLOCK_NAME_SZ - 1 || name[i] == 0);
+}
+
+void retryRead(long &attempts, const char *context)
+{
+   if(++attempts >= BLOCK_READ_RETRIES)
+      throw pdg::Error(2, std::string("#Error in ") + context + ", no consistent read of the curve block in " + xtos(attempts) + " attempts");
+   if(attempts > 1) boost::this_thread::yield();
+}
+
+size_t blockBytes(long capacity)
+{
+   const size_t cap = static_cast<size_t>(capacity);
+   return alignUp(sizeof(BlockHeader))
+        + alignUp(cap * sizeof(boost::int32_t))
+        + 4 * alignUp(cap * sizeof(double))  // times, discounts, values and ...
+        + 2 * alignUp(cap * sizeof(double)); // ... the three coefficients arrays
+}
+
+double blockYearFraction(long dayCount, long startDate, long endDate)
+{
+   switch(dayCount) {
+      case 4: return (endDate - startDate) / 360.0;
+      case 5: return (endDate - startDate) / 365.0;
+      default: {
+         double yrf = 0.;
+         pdgerr_t res = pdg_yrfDayCount(startDate, endDate, dayCount, &yrf);
+         if(res.code) throw pdg::Error(res);
+         return yrf;
+      }
+   }
+}
+
+namespace {
+   //largest capacity (at least n) of a block fitting in bytes
+   long fittingCapacity(size_t bytes, long n)
+   {
+      long capacity = n;
+      while(blockBytes(capacity + 1) <= bytes) ++capacity;
+      return capacity;
+   }
+
+   void layoutBlock(BlockHeader *h, long capacity)
+   {
+      const size_t cap = static_cast<size_t>(capacity);
+      size_t offset = alignUp(sizeof(BlockHeader));
+      h->capacity = capacity;
+      h->datesOffset = static_cast<boost::uint32_t>(offset);   offset += alignUp(cap * sizeof(boost::int32_t));
+      h->timesOffset = static_cast<boost::uint32_t>(offset);   offset += alignUp(cap * sizeof(double));
+      h->discOffset = static_cast<boost::uint32_t>(offset);    offset += alignUp(cap * sizeof(double));
+      h->valuesOffset = static_cast<boost::uint32_t>(offset);  offset += alignUp(cap * sizeof(double));
+      h->coefOffset = static_cast<boost::uint32_t>(offset);    offset += 3 * alignUp(cap * sizeof(double));
+      h->totalBytes = static_cast<boost::uint32_t>(offset);
+   }
+
+   //k-th coefficients array (0, 1, 2) of a block
+   double *coefArray(void *mem, int k)
+   {
+      BlockHeader *h = static_cast<BlockHeader *>(mem);
+      return reinterpret_cast<double *>(static_cast<char *>(mem) + h->coefOffset)
+           + k * alignUp(static_cast<size_t>(h->capacity) * sizeof(double)) / sizeof(double);
+   }
+
+   template<class T>
+   T *blockArray(void *mem, boost::uint32_t offset)
+   {
+      return reinterpret_cast<T *>(static_cast<char *>(mem) + offset);
+   }
+
+   //seq goes odd: readers of the block will retry
+   void beginWrite(BlockHeader *h)
+   {
+      if(h->magic != BLOCK_MAGIC) h->seq = 0;
+      atomic_ops::increment(h->seq);
+   }
+
+   void endWrite(BlockHeader *h)
+   {
+      atomic_ops::increment(h->seq);
+   }
+}
+
+void writeBlock(void *mem, size_t bytes, const BlockSpec &spec, const long *dates, const double *discs, long n)
+{
+   if(n < 1) throw pdg::Error(2, "#Error in shm_curve::writeBlock, empty curve");
+   if(blockBytes(n) > bytes) throw pdg::Error(2, "#Error in shm_curve::writeBlock, block too small for " + xtos(n) + " pillars");
+   for(long i = 1; i < n; ++i)
+      if(dates[i] <= dates[i - 1]) throw pdg::Error(2, "#Error in shm_curve::writeBlock, dates are not strictly increasing");
+
+   BlockHeader *h = static_cast<BlockHeader *>(mem);
+   beginWrite(h);
+
+   h->magic = BLOCK_MAGIC;
+   h->layoutVersion = BLOCK_LAYOUT_VERSION;
+   h->flags = 0;
+   h->version = spec.version;
+   h->publishTime = spec.publishTime;
+   h->currency = spec.currency;
+   h->typeInterp = spec.typeInterp;
+   h->interpOn = spec.interpOn;
+   h->comp = spec.comp;
+   h->dayCount = spec.dayCount;
+   h->today = dates[0];
+   h->size = n;
+   layoutBlock(h, fittingCapacity(bytes, n));
+   copyName(h->name, spec.name);
+   copyName(h->backbone, spec.backbone);
+
+   boost::int32_t *d = blockArray<boost::int32_t>(mem, h->datesOffset);
+   double *t = blockArray<double>(mem, h->timesOffset);
+   double *df = blockArray<double>(mem, h->discOffset);
+   double *y = blockArray<double>(mem, h->valuesOffset);
+   double *cb = coefArray(mem, 0);
+   double *cc = coefArray(mem, 1);
+   double *cd = coefArray(mem, 2);
+
+   boost::uint32_t flags = 0;
+   try {
+      const long seed = seedType(spec.interpOn);
+      for(long i = 0; i < n; ++i) {
+         d[i] = dates[i];
+         t[i] = blockYearFraction(spec.dayCount, dates[0], dates[i]);
+         df[i] = discs[i];
+         switch(seed) {
+            case stRate:     y[i] = t[i] > 0. ? discountToRate(discs[i], t[i], spec.comp) : 0.; break;
+            case stRateTime: y[i] = t[i] > 0. ? discountToRate(discs[i], t[i], spec.comp) * t[i] : 0.; break;
+            default:         y[i] = discs[i];
+         }
+      }
+      //the rate at the calc date is not defined, it is taken from the first pillar
+      if(seed == stRate && n > 1 && t[0] <= 0.) y[0] = y[1];
+
+      if(seed != stNone && n > 1) {
+         flags = interpCoefficients(spec.typeInterp, t, y, n, cb, cc, cd);
+         //a spline the engine would not draw is left to the engine
+         if((flags & bfCubic) && !matchesEngine(spec.typeInterp, t, y, n)) flags = 0;
+      }
+      if(!spec.evaluable) flags = 0;
+   }
+   catch(...) {
+      //leave a consistent, non evaluable block behind
+      endWrite(h);
+      throw;
+   }
+   if(spec.backbone && spec.backbone[0]) flags |= bfSpread;
+   h->flags = flags;
+
+   endWrite(h);
+}
+
+void copyBlock(void *mem, size_t bytes, const ShmCurveBlockView &src)
+{
+   const BlockHeader &sh = src.header();
+   const long n = sh.size;
+   if(blockBytes(n) > bytes) throw pdg::Error(2, "#Error in shm_curve::copyBlock, block too small for " + xtos(n) + " pillars");
+
+   BlockHeader *h = static_cast<BlockHeader *>(mem);
+   beginWrite(h);
+
+   const boost::uint32_t seq = h->seq;
+   *h = sh;
+   h->seq = seq;
+   h->flags &= ~static_cast<boost::uint32_t>(bfRetired);
+   layoutBlock(h, fittingCapacity(bytes, n));
+
+   std::copy(src.dates(), src.dates() + n, blockArray<boost::int32_t>(mem, h->datesOffset));
+   std::copy(src.times(), src.times() + n, blockArray<double>(mem, h->timesOffset));
+   std::copy(src.discounts(), src.discounts() + n, blockArray<double>(mem, h->discOffset));
+   std::copy(src.values(), src.values() + n, blockArray<double>(mem, h->valuesOffset));
+   for(int k = 0; k < 3; ++k) {
+      const double *coef = src.coefficients(k);
+      std::copy(coef, coef + n, coefArray(mem, k));
+   }
+
+   endWrite(h);
+}
+
+ShmCurveBlockView::ShmCurveBlockView()
+: header_(0)
+{}
+
+ShmCurveBlockView::ShmCurveBlockView(const void *mem)
+: header_(static_cast<const BlockHeader *>(mem))
+{}
+
+bool ShmCurveBlockView::valid() const
+{
+   return header_ && header_->magic == BLOCK_MAGIC && header_->layoutVersion == BLOCK_LAYOUT_VERSION;
+}
+
+bool ShmCurveBlockView::evaluable() const
+{
+   return valid() && (header_->flags & bfEvaluable);
+}
+
+const boost::int32_t *ShmCurveBlockView::dates() const
+{
+   return reinterpret_cast<const boost::int32_t *>(reinterpret_cast<const char *>(header_) + header_->datesOffset);
+}
+
+const double *ShmCurveBlockView::times() const
+{
+   return reinterpret_cast<const double *>(reinterpret_cast<const char *>(header_) + header_->timesOffset);
+}
+
+const double *ShmCurveBlockView::discounts() const
+{
+   return reinterpret_cast<const double *>(reinterpret_cast<const char *>(header_) + header_->discOffset);
+}
+
+const double *ShmCurveBlockView::values() const
+{
+   return reinterpret_cast<const double *>(reinterpret_cast<const char *>(header_) + header_->valuesOffset);
+}
+
+const double *ShmCurveBlockView::coefficients(int k) const
+{
+   return coefArray(const_cast<BlockHeader *>(header_), k);
+}
+
+boost::uint32_t ShmCurveBlockView::beginRead() const
+{
+   boost::uint32_t seq = atomic_ops::load(header_->seq);
+   if(!(seq & 1u)) return seq;
+
+   //a writer is inside: spin a little, then yield, and give up on a writer that never leaves
+   using namespace boost::posix_time;
+   const ptime start = microsec_clock::universal_time();
+   for(long spin = 1; (seq = atomic_ops::load(header_->seq)) & 1u; ++spin) {
+      if(spin < WRITER_SPINS) continue;
+      boost::this_thread::yield();
+      if(spin % WRITER_SPINS == 0 && (microsec_clock::universal_time() - start).total_milliseconds() > BLOCK_WRITE_TIMEOUT_MS)
+         throw pdg::Error(2, std::string("#Error in ShmCurveBlockView, the block of curve ") + header_->name +
+                             " has been held by a writer for more than " + xtos(BLOCK_WRITE_TIMEOUT_MS) + " ms");
+   }
+   return seq;
+}
+
+bool ShmCurveBlockView::endRead(boost::uint32_t seq) const
+{
+   return atomic_ops::load(header_->seq) == seq;
+}
+
+long ShmCurveBlockView::bracket(double t, long from) const
+{
+   const double *x = times();
+   const long n = header_->size;
+   if(t <= x[from + 1]) return from;
+   return static_cast<long>(std::upper_bound(x + from + 1, x + n - 1, t) - x) - 1;
+}
+
+double ShmCurveBlockView::seedAt(long i, double t) const
+{
+   const double *x = times();
+   const double *y = values();
+   const long n = header_->size;
+   const double dx = t - x[i];
+
+   if(header_->flags & bfCubic) {
+      const double *b = coefficients(0);
+      const double *c = coefficients(1);
+      const double *d = coefficients(2);
+      if(t > x[n - 1] && header_->typeInterp != icKruger) {
+         //natural splines are extrapolated linearly with the slope at the last pillar
+         const long j = n - 2;
+         const double h = x[n - 1] - x[j];
+         const double slope = b[j] + h * (2.0 * c[j] + 3.0 * h * d[j]);
+         return y[n - 1] + slope * (t - x[n - 1]);
+      }
+      return y[i] + dx * (b[i] + dx * (c[i] + dx * d[i]));
+   }
+
+   switch(header_->typeInterp) {
+      case icConst:
+         return (t > x[n - 1]) ? y[n - 1] : ((t <= x[i]) ? y[i] : y[i + 1]);
+      case icQuadratic: {
+         const long ll = i > 0 ? i - 1 : i;
+         const long gg = i + 2 < n ? i + 2 : i + 1;
+         if(ll == i && gg == i + 1) return interp::linearInterp(x[i], t, x[i + 1], y[i], y[i + 1]);
+         return interp::quadraticInterp(t, x[ll], x[i], x[i + 1], x[gg], y[ll], y[i], y[i + 1], y[gg]);
+      }
+      default:
+         return y[i] + coefficients()[i] * dx;
+   }
+}
+
+double ShmCurveBlockView::seedToDiscount(double y, double t) const
+{
+   switch(seedType(header_->interpOn)) {
+      case stRate:     return rateToDiscount(y, t, header_->comp);
+      case stRateTime: return t > 0. ? rateToDiscount(y / t, t, header_->comp) : 1.0;
+      default:         return y;
+   }
+}
+
+double ShmCurveBlockView::discountAtTime(double t) const
+{
+   double res;
+   discountsAtTimes(&t, 1, &res);
+   return res;
+}
+
+double ShmCurveBlockView::discount(long date) const
+{
+   double res;
+   discounts(&date, 1, &res);
+   return res;
+}
+
+void ShmCurveBlockView::discountsAtTimes(const double *t, long n, double *out) const
+{
+   if(!evaluable()) throw pdg::Error(2, "#Error in ShmCurveBlockView, interpolation not supported by the curve block");
+
+   const double *x = times();
+   const double *df = discounts();
+   const long sz = header_->size;
+   const bool flatZero = (header_->typeInterp == icLinear);
+   long i = 0;
+   for(long k = 0; k < n; ++k) {
+      const double tk = t[k];
+      if(tk < x[0]) throw pdg::Error(2, "#Error in ShmCurveBlockView, time before the curve calc date");
+      if(k && tk < t[k - 1]) i = 0; // not ordered: restart the walk
+      if(tk > x[sz - 1]) {
+         if(flatZero) { // as the linear term structure interpolator, zero rate is extrapolated flat
+            out[k] = std::pow(df[sz - 1], tk / x[sz - 1]);
+            continue;
+         }
+         out[k] = seedToDiscount(seedAt(sz - 2, tk), tk);
+         continue;
+      }
+      i = bracket(tk, i);
+      if(tk == x[i]) out[k] = df[i];
+      else if(tk == x[i + 1]) out[k] = df[i + 1];
+      else out[k] = seedToDiscount(seedAt(i, tk), tk);
+   }
+}
+
+void ShmCurveBlockView::discountsAtYearFractions(long dayCount, const double *yf, long n, double *out) const
+{
+   if(dayCount == header_->dayCount) {
+      discountsAtTimes(yf, n, out);
+      return;
+   }
+   //another ACT basis counts the same days over another year
+   const double from = actDays(dayCount), to = actDays(header_->dayCount);
+   if(from <= 0. || to <= 0.)
+      throw pdg::Error(2, "#Error in ShmCurveBlockView, year fractions in day count " + xtos(dayCount) +
+                          " do not convert to the day count " + xtos(long(header_->dayCount)) + " of the curve");
+   //in chunks to stay off the heap
+   const long CHUNK = 256;
+   double t[CHUNK];
+   for(long k = 0; k < n; k += CHUNK) {
+      const long m = std::min(CHUNK, n - k);
+      for(long j = 0; j < m; ++j) t[j] = yf[k + j] * from / to;
+      discountsAtTimes(t, m, out + k);
+   }
+}
+
+void ShmCurveBlockView::discounts(const long *dates, long n, double *out) const
+{
+   if(!evaluable()) throw pdg::Error(2, "#Error in ShmCurveBlockView, interpolation not supported by the curve block");
+
+   const boost::int32_t *d = this->dates();
+   const double *x = times();
+   const double *df = discounts();
+   const long sz = header_->size;
+   const long today = header_->today;
+   const long dayCount = header_->dayCount;
+   const bool flatZero = (header_->typeInterp == icLinear);
+   long i = 0;
+   for(long k = 0; k < n; ++k) {
+      const long dk = dates[k];
+      if(dk < today) throw pdg::Error(2, "#Error in ShmCurveBlockView, date before the curve calc date");
+      if(k && dk < dates[k - 1]) i = 0; // not ordered: restart the walk
+      const double tk = blockYearFraction(dayCount, today, dk);
+      if(dk > d[sz - 1]) {
+         out[k] = flatZero ? std::pow(df[sz - 1], tk / x[sz - 1]) : seedToDiscount(seedAt(sz - 2, tk), tk);
+         continue;
+      }
+      if(sz == 1) { out[k] = df[0]; continue; }
+      i = bracket(tk, i);
+      if(dk == d[i]) out[k] = df[i];
+      else if(dk == d[i + 1]) out[k] = df[i + 1];
+      else out[k] = seedToDiscount(seedAt(i, tk), tk);
+   }
+}
+
+ShmCurveBlockAdjoint::ShmCurveBlockAdjoint()
+{}
+
+bool ShmCurveBlockAdjoint::load(const ShmCurveBlockView &src)
+{
+   if(!src.evaluable()) throw pdg::Error(2, "#Error in ShmCurveBlockAdjoint, interpolation not supported by the curve block");
+
+   const boost::uint32_t seq = src.beginRead();
+   const size_t bytes = blockBytes(src.size());
+   mem_.assign(bytes / sizeof(double), 0.);
+   try {
+      copyBlock(&mem_[0], bytes, src);
+   }
+   catch(...) {
+      if(!src.endRead(seq)) return false; // the size changed meanwhile
+      throw;
+   }
+   if(!src.endRead(seq) || (src.header().flags & bfRetired)) return false;
+   view_ = ShmCurveBlockView(&mem_[0]);
+
+   //cubics: jacobian of the coefficients of each interval with respect to the seeds
+   const BlockHeader &h = view_.header();
+   jac_.clear();
+   if(!(h.flags & bfCubic)) return true;
+   const long n = h.size;
+   const double *x = view_.times();
+   const double *y = view_.values();
+   jac_.assign(3 * n * n, 0.);
+   std::vector<double> yb(n), b(n), c(n), d(n), b2(n), c2(n), d2(n);
+   for(long m = 0; m < n; ++m) {
+      double step = 1.0;
+      if(h.typeInterp == icSpline) {
+         //the natural spline is linear in the seeds: the column is the spline of a unit seed
+         std::fill(yb.begin(), yb.end(), 0.);
+         yb[m] = 1.0;
+         interpCoefficients(h.typeInterp, x, &yb[0], n, &b[0], &c[0], &d[0]);
+      }
+      else {
+         //the filters of Kruger and Hyman are not: central differences
+         step = JACOBIAN_BUMP * std::max(1.0, std::fabs(y[m]));
+         std::copy(y, y + n, yb.begin());
+         yb[m] = y[m] + step;
+         interpCoefficients(h.typeInterp, x, &yb[0], n, &b[0], &c[0], &d[0]);
+         yb[m] = y[m] - step;
+         interpCoefficients(h.typeInterp, x, &yb[0], n, &b2[0], &c2[0], &d2[0]);
+         for(long i = 0; i < n - 1; ++i) {
+            b[i] -= b2[i];
+            c[i] -= c2[i];
+            d[i] -= d2[i];
+         }
+         step *= 2.0;
+      }
+      for(long i = 0; i < n - 1; ++i) {
+         jac_[i * n + m] = b[i] / step;
+         jac_[(n + i) * n + m] = c[i] / step;
+         jac_[(2 * n + i) * n + m] = d[i] / step;
+      }
+   }
+   return true;
+}
+
+void ShmCurveBlockAdjoint::seedAdjoint(long i, double t, double bar, double *yBar) const
+{
+   const BlockHeader &h = view_.header();
+   const double *x = view_.times();
+   const long n = h.size;
+   const double y = view_.seedAt(i, t);
+
+   //discount of the seed
+   double sBar = bar;
+   switch(seedType(h.interpOn)) {
+      case stRate:     sBar *= rateToDiscountDerivative(y, t, h.comp); break;
+      case stRateTime: sBar *= t > 0. ? rateToDiscountDerivative(y / t, t, h.comp) / t : 0.; break;
+   }
+
+   //seed against the seeds of the pillars, as seedAt
+   const double dx = t - x[i];
+   if(h.flags & bfCubic) {
+      const double *jb = &jac_[0];
+      const double *jc = jb + n * n;
+      const double *jd = jc + n * n;
+      if(t > x[n - 1] && h.typeInterp != icKruger) {
+         const long j = n - 2;
+         const double hl = x[n - 1] - x[j], e = t - x[n - 1];
+         yBar[n - 1] += sBar;
+         for(long m = 0; m < n; ++m)
+            yBar[m] += sBar * e * (jb[j * n + m] + hl * (2.0 * jc[j * n + m] + 3.0 * hl * jd[j * n + m]));
+         return;
+      }
+      yBar[i] += sBar;
+      for(long m = 0; m < n; ++m)
+         yBar[m] += sBar * dx * (jb[i * n + m] + dx * (jc[i * n + m] + dx * jd[i * n + m]));
+      return;
+   }
+
+   switch(h.typeInterp) {
+      case icConst:
+         yBar[(t > x[n - 1]) ? n - 1 : ((t <= x[i]) ? i : i + 1)] += sBar;
+         return;
+      case icQuadratic: {
+         const long ll = i > 0 ? i - 1 : i;
+         const long gg = i + 2 < n ? i + 2 : i + 1;
+         if(ll != i || gg != i + 1) {
+            //linear in the seeds: the weights are the interpolations of unit seeds
+            const long idx[4] = { ll, i, i + 1, gg };
+            for(int q = 0; q < 4; ++q) {
+               double u[4] = { 0., 0., 0., 0. };
+               u[q] = 1.0;
+               yBar[idx[q]] += sBar * interp::quadraticInterp(t, x[ll], x[i], x[i + 1], x[gg], u[0], u[1], u[2], u[3]);
+            }
+            return;
+         }
+      }
+      //fall through: two pillars, linear
+      default: {
+         const double w = dx / (x[i + 1] - x[i]);
+         yBar[i] += sBar * (1.0 - w);
+         yBar[i + 1] += sBar * w;
+      }
+   }
+}
+
+void ShmCurveBlockAdjoint::adjoint(const long *dates, long n, const double *bar, double *grad) const
+{
+   const BlockHeader &h = view_.header();
+   const boost::int32_t *d = view_.dates();
+   const double *x = view_.times();
+   const double *df = view_.discounts();
+   const long sz = h.size;
+   const bool flatZero = (h.typeInterp == icLinear);
+
+   //adjoints of the seeds of the pillars first, as ShmCurveBlockView::discounts walks
+   std::vector<double> yBar(sz, 0.);
+   long i = 0;
+   for(long k = 0; k < n; ++k) {
+      const long dk = dates[k];
+      if(dk < h.today) throw pdg::Error(2, "#Error in ShmCurveBlockAdjoint, date before the curve calc date");
+      if(k && dk < dates[k - 1]) i = 0;
+      const double tk = blockYearFraction(h.dayCount, h.today, dk);
+      if(dk > d[sz - 1]) {
+         if(flatZero) grad[sz - 1] += bar[k] * tk / x[sz - 1] * std::pow(df[sz - 1], tk / x[sz - 1] - 1.0);
+         else seedAdjoint(sz - 2, tk, bar[k], &yBar[0]);
+         continue;
+      }
+      if(sz == 1) { grad[0] += bar[k]; continue; }
+      i = view_.bracket(tk, i);
+      if(dk == d[i]) grad[i] += bar[k];
+      else if(dk == d[i + 1]) grad[i + 1] += bar[k];
+      else seedAdjoint(i, tk, bar[k], &yBar[0]);
+   }
+
+   //then of the pillar discounts
+   const long seed = seedType(h.interpOn);
+   if(seed == stRate && sz > 1 && x[0] <= 0.) {
+      yBar[1] += yBar[0];
+      yBar[0] = 0.;
+   }
+   for(long j = 0; j < sz; ++j) {
+      if(yBar[j] == 0. || (seed != stDiscount && x[j] <= 0.)) continue;
+      switch(seed) {
+         case stRate:     grad[j] += yBar[j] * discountToRateDerivative(df[j], x[j], h.comp); break;
+         case stRateTime: grad[j] += yBar[j] * x[j] * discountToRateDerivative(df[j], x[j], h.comp); break;
+         default:         grad[j] += yBar[j];
+      }
+   }
+}
+
+} // namespace shm_curve
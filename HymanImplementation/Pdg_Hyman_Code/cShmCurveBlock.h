@@ -0,0 +1,192 @@
+//cShmCurveBlock.h
+#ifndef _CSHMCURVEBLOCK_H__
+#define _CSHMCURVEBLOCK_H__
+
+#include <cstddef>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+namespace shm_curve {
+
+/**
+* @defgroup shmcurveblock Fixed layout binary curve block.
+*
+* A curve block is a single, position independent chunk of memory holding
+* everything needed to evaluate a discount curve: a header with conventions,
+* interpolation codes and publication version, followed by 64 byte aligned
+* arrays of pillar dates, times, discounts, interpolation seeds and
+* precomputed interpolation coefficients.
+* Writers build the block in place (e.g. directly inside a shared memory
+* segment), readers evaluate directly against the mapped memory without
+* copying the pillars out. The cubics of the natural and monotonic splines
+* are checked against the engine's interp::interpNaturalBSpline when the
+* block is written, and the pushes of curves compare every interpolation,
+* extrapolation included, with the engine's DiscTermStructure on a dense
+* grid of dates; a curve the block would not draw as the engine does is
+* not evaluable, and its readers fall back on the engine.
+* Concurrency is handled by a sequence lock: seq is odd while a writer is
+* inside, readers retry when seq changed during their evaluation. A reader
+* never waits forever: a writer that stays inside longer than
+* BLOCK_WRITE_TIMEOUT_MS (a process that died while writing) and a block that
+* is not read consistently in BLOCK_READ_RETRIES attempts are errors.
+*/
+
+//@{
+const boost::uint32_t BLOCK_MAGIC          = 0x43474450; // "PDGC"
+const boost::uint32_t BLOCK_LAYOUT_VERSION = 2;
+const size_t          BLOCK_ALIGN          = 64;
+const size_t          BLOCK_NAME_SZ        = 48;
+const long            BLOCK_WRITE_TIMEOUT_MS = 1000;
+const long            BLOCK_READ_RETRIES   = 10000;
+
+enum block_flag {
+   bfEvaluable = 1, // the seed/interpolation pair is supported by the block evaluator
+   bfCubic     = 2, // coefficients hold a cubic per interval
+   bfSpread    = 4, // the block is a spread over the curve named in backbone
+   bfRetired   = 8  // the block has been replaced, readers must resolve the curve again
+};
+
+struct BlockHeader {
+   boost::uint32_t magic;
+   boost::uint32_t layoutVersion;
+   volatile boost::uint32_t seq;
+   boost::uint32_t flags;
+   boost::uint64_t version;      // publication counter of the curve
+   double          publishTime;  // XL serial date-time of the publication
+   boost::int32_t  currency;
+   boost::int32_t  typeInterp;   // 1-based, see pdg_getInterpMethod
+   boost::int32_t  interpOn;     // see pdg_getInterpSeed
+   boost::int32_t  comp;         // see pdg_getCompoundingMethod
+   boost::int32_t  dayCount;
+   boost::int32_t  today;
+   boost::int32_t  size;
+   boost::int32_t  capacity;
+   boost::uint32_t datesOffset;  // offsets are from the beginning of the block
+   boost::uint32_t timesOffset;
+   boost::uint32_t discOffset;
+   boost::uint32_t valuesOffset;
+   boost::uint32_t coefOffset;
+   boost::uint32_t totalBytes;
+   boost::int64_t  retiredNext;  // owner of the memory: next block retired with this one, never read by readers
+   char            name[BLOCK_NAME_SZ];
+   char            backbone[BLOCK_NAME_SZ];
+};
+
+// Conventions of a block, as passed to the pdg_pushShmLibor* functions
+struct BlockSpec {
+   BlockSpec();
+   long currency;
+   long typeInterp;
+   long interpOn;
+   long comp;
+   long dayCount;
+   boost::uint64_t version;
+   double publishTime;
+   const char *name;
+   const char *backbone; // empty or null for outright curves
+   bool evaluable;       // false publishes a block its readers leave to the engine
+};
+
+// bytes needed by a block able to hold capacity pillars
+size_t blockBytes(long capacity);
+
+// builds the block in the memory pointed by mem (of size bytes), the first date is the curve calc date
+void writeBlock(void *mem, size_t bytes, const BlockSpec &spec, const long *dates, const double *discs, long n);
+
+// upper case copy of a curve name, truncated to BLOCK_NAME_SZ - 1 characters
+void copyName(char *dest, const char *src);
+
+// case insensitive comparison of a stored (upper case) name with a curve name
+bool sameName(const char *stored, const char *name);
+
+// counts the attempts of a read loop (torn reads, retired blocks), yields from the second one
+// and throws past BLOCK_READ_RETRIES
+void retryRead(long &attempts, const char *context);
+
+// year fraction used for the block times (the curve day count)
+double blockYearFraction(long dayCount, long startDate, long endDate);
+
+class ShmCurveBlockView
+{
+public:
+   ShmCurveBlockView();
+   explicit ShmCurveBlockView(const void *mem);
+
+   bool valid() const;
+   bool evaluable() const;
+   const BlockHeader &header() const { return *header_; }
+   const void *address() const { return header_; }
+
+   long size() const { return header_->size; }
+   long today() const { return header_->today; }
+   const boost::int32_t *dates() const;
+   const double *times() const;
+   const double *discounts() const;
+   const double *values() const;
+   const double *coefficients(int k = 0) const; // k-th of the three coefficients arrays
+
+   //sequence lock, a read is consistent if endRead(beginRead()) holds after it. beginRead spins
+   //while a writer is inside, then yields, and throws after BLOCK_WRITE_TIMEOUT_MS
+   boost::uint32_t beginRead() const;
+   bool endRead(boost::uint32_t seq) const;
+
+   double discount(long date) const;
+   double discountAtTime(double t) const;
+   //when dates (times) are ascending a single merge walk is used, otherwise each point is bracketed
+   void discounts(const long *dates, long n, double *out) const;
+   void discountsAtTimes(const double *t, long n, double *out) const;
+   //same on year fractions from today in dayCount, the one of the block or another ACT basis
+   void discountsAtYearFractions(long dayCount, const double *yf, long n, double *out) const;
+
+private:
+   friend class ShmCurveBlockAdjoint;
+
+   double seedAt(long i, double t) const;
+   double seedToDiscount(double y, double t) const;
+   long bracket(double t, long from) const;
+
+   const BlockHeader *header_;
+};
+
+// copy of the block viewed by src into the memory pointed by mem (of size bytes), the copy
+// is compacted to the smallest capacity fitting in bytes
+void copyBlock(void *mem, size_t bytes, const ShmCurveBlockView &src);
+
+// Adjoint of the discounts of a block with respect to its pillar discounts. The block is copied,
+// so that the discounts and their adjoint come from the same publication. The seeds of the
+// discounts are linear in the seeds of the pillars for the linear, constant and quadratic
+// interpolations and the natural spline, differentiated exactly. The Kruger and Hyman cubics are
+// not (their slopes are clipped or harmonic means of the secants): their coefficients are
+// differentiated by central differences, refitting them with each seed bumped by
+// 1e-6 * max(1, |seed|), 2n fits for n pillars. The truncation error is of the order of the bump
+// squared and the rounding error of 1e-10 relative; against a bump and reprice of the discounts the
+// gradients agree to about 1e-8 relative. Where a seed sits on a kink of the filter (a secant changing
+// sign for Kruger, a slope at the monotonicity bound of Hyman) the derivative is one sided and the
+// central difference averages both sides: the error reaches 1e-5 relative on such columns.
+class ShmCurveBlockAdjoint
+{
+public:
+   ShmCurveBlockAdjoint();
+
+   //copies the block and differentiates its coefficients, false if it was written meanwhile
+   bool load(const ShmCurveBlockView &src);
+   //the copy, to evaluate the discounts
+   const ShmCurveBlockView &view() const { return view_; }
+   //grad[j] += sum of bar[k] * d discount(dates[k]) / d discounts()[j], for the size() pillars
+   void adjoint(const long *dates, long n, const double *bar, double *grad) const;
+
+private:
+   ShmCurveBlockAdjoint(const ShmCurveBlockAdjoint &);
+   ShmCurveBlockAdjoint &operator=(const ShmCurveBlockAdjoint &);
+
+   void seedAdjoint(long i, double t, double bar, double *yBar) const;
+
+   std::vector<double> mem_;          // the copy of the block
+   ShmCurveBlockView view_;
+   std::vector<double> jac_;          // cubics: d coefficient / d seed, the b, c and d rows of n x n each
+};
+//@}
+
+} // namespace shm_curve
+
+#endif // _CSHMCURVEBLOCK_H__
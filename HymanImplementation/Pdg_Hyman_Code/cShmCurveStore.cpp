@@ -0,0 +1,722 @@
+//cShmCurveStore.cpp
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+#include "cShmCurveStore.h"
+#include "eAtomic.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace shm_curve {
+
+typedef boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> store_lock;
+
+namespace {
+   const long MAX_POLL_MS = 32;
+   //retries of a read racing the writer of a slot before it takes the directory lock
+   const long SLOT_READ_RETRIES = 64;
+
+#if defined(_WIN32)
+   //Windows has no wait on a word shared between processes: the waiters block on a semaphore named
+   //after the segment, which a publication releases once per waiter. A release nobody consumes (a
+   //waiter that timed out meanwhile) only wakes a later wait early, the waiters check the versions
+   //again. Null when it cannot be created, the waiters then poll. Two threads racing on the first call
+   //open the same semaphore
+   HANDLE wakeSemaphore()
+   {
+      static HANDLE res = CreateSemaphoreA(0, 0, LONG_MAX, (std::string("Local\\") + STORE_SEGMENT_NAME + "_WAKE").c_str());
+      return res;
+   }
+#endif
+
+   //the directory lock must be held: readers without it see an odd seq while the slot changes
+   void beginWrite(StoreSlot &s)
+   {
+      atomic_ops::store(s.seq, s.seq + 1);
+   }
+
+   void endWrite(StoreSlot &s)
+   {
+      atomic_ops::store(s.seq, s.seq + 1);
+   }
+
+   //finds or creates the directory, within the lock of the segment
+   class DirectoryInit
+   {
+   public:
+      explicit DirectoryInit(boost::interprocess::managed_shared_memory &segment) : dir(0), segment_(segment) {}
+
+      void operator()()
+      {
+         dir = segment_.find<StoreDirectory>("StoreDirectory").first;
+         if(dir) return;
+         //value initialisation: a new directory starts with every slot and counter at zero
+         dir = segment_.construct<StoreDirectory>("StoreDirectory")();
+         dir->magic = STORE_MAGIC;
+         dir->layoutVersion = STORE_LAYOUT_VERSION;
+         dir->directoryBytes = sizeof(StoreDirectory);
+      }
+
+      StoreDirectory *dir;
+
+   private:
+      boost::interprocess::managed_shared_memory &segment_;
+   };
+
+   long msSince(const boost::posix_time::ptime &start)
+   {
+      return static_cast<long>((boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds());
+   }
+
+   // registers the calling thread among the waiters of the directory for its lifetime
+   class WaiterGuard
+   {
+   public:
+      explicit WaiterGuard(volatile boost::uint32_t &waiters) : waiters_(waiters) { atomic_ops::increment(waiters_); }
+      ~WaiterGuard() { atomic_ops::decrement(waiters_); }
+   private:
+      volatile boost::uint32_t &waiters_;
+   };
+}
+
+double xlNow()
+{
+   using namespace boost::posix_time;
+   ptime now = microsec_clock::local_time();
+   return (now.date() - boost::gregorian::date(1899, 12, 30)).days()
+        + now.time_of_day().total_microseconds() / 86400.e6;
+}
+
+ShmCurveStore &ShmCurveStore::Instance()
+{
+   static ShmCurveStore store;
+   return store;
+}
+
+ShmCurveStore::ReadGuard::ReadGuard(const ShmCurveStore &store)
+: readers_(0)
+{
+   StoreDirectory *dir = store.dir_;
+   for(;;) {
+      const boost::uint32_t phase = atomic_ops::load(dir->readPhase);
+      volatile boost::uint32_t &readers = dir->readers[phase & 1];
+      atomic_ops::increment(readers);
+      //a writer that moved the phase meanwhile may have missed the registration: register again
+      if(atomic_ops::load(dir->readPhase) == phase) {
+         readers_ = &readers;
+         return;
+      }
+      atomic_ops::decrement(readers);
+   }
+}
+
+ShmCurveStore::ReadGuard::~ReadGuard()
+{
+   atomic_ops::decrement(*readers_);
+}
+
+ShmCurveStore::ShmCurveStore()
+: segment_(boost::interprocess::open_or_create, STORE_SEGMENT_NAME, STORE_SEGMENT_SIZE),
+  dir_(0)
+{
+   DirectoryInit init(segment_);
+   segment_.atomic_func(init);
+   dir_ = init.dir;
+   if(!dir_) throw pdg::Error(2, "#Error in ShmCurveStore, unable to map the curve directory");
+   if(dir_->magic != STORE_MAGIC || dir_->layoutVersion != STORE_LAYOUT_VERSION || dir_->directoryBytes != sizeof(StoreDirectory))
+      throw pdg::Error(2, std::string("#Error in ShmCurveStore, the segment ") + STORE_SEGMENT_NAME + " was created with another layout " +
+                          "(version " + xtos(long(dir_->layoutVersion)) + ", expected " + xtos(long(STORE_LAYOUT_VERSION)) +
+                          "), close the processes using it to recreate it");
+}
+
+void *ShmCurveStore::blockAddress(boost::int64_t block) const
+{
+   return static_cast<char *>(segment_.get_address()) + block;
+}
+
+long ShmCurveStore::slotIndex(const char *name) const
+{
+   for(long i = 0; i < dir_->nSlots; ++i)
+      if(sameName(dir_->slots[i].name, name)) return i;
+   return -1;
+}
+
+void ShmCurveStore::retire(boost::int64_t block)
+{
+   BlockHeader *h = static_cast<BlockHeader *>(blockAddress(block));
+   atomic_ops::increment(h->seq);
+   h->flags |= bfRetired;
+   atomic_ops::increment(h->seq);
+
+   h->retiredNext = dir_->retiredCurrent;
+   dir_->retiredCurrent = block;
+}
+
+void ShmCurveStore::reclaim()
+{
+   if(!dir_->retiredCurrent && !dir_->retiredPrevious) return;
+   const boost::uint32_t phase = dir_->readPhase;
+   //readers of the previous phase may hold any block retired up to now, those of the current
+   //one only the blocks retired since it started
+   if(atomic_ops::load(dir_->readers[(phase + 1) & 1])) return;
+   for(boost::int64_t block = dir_->retiredPrevious; block; ) {
+      const boost::int64_t next = static_cast<const BlockHeader *>(blockAddress(block))->retiredNext;
+      segment_.deallocate(blockAddress(block));
+      block = next;
+   }
+   dir_->retiredPrevious = dir_->retiredCurrent;
+   dir_->retiredCurrent = 0;
+   atomic_ops::store(dir_->readPhase, phase + 1);
+}
+
+long ShmCurveStore::createSlot(const char *name)
+{
+   long slot;
+   for(slot = 0; slot < dir_->nSlots && dir_->slots[slot].name[0]; ++slot)
+      ;
+   if(slot == STORE_MAX_CURVES) throw pdg::Error(2, "#Error in ShmCurveStore, too many curves published");
+   if(slot == dir_->nSlots) ++dir_->nSlots;
+   StoreSlot &fresh = dir_->slots[slot];
+   beginWrite(fresh);
+   copyName(fresh.name, name);
+   fresh.block = 0;
+   fresh.capacity = 0;
+   fresh.history = 0;
+   fresh.historyDepth = 0;
+   fresh.historyNext = 0;
+   fresh.composite = 0;
+   fresh.compositeVersion = 0;
+   fresh.compositeBackbone = 0;
+   ++fresh.generation;
+   endWrite(fresh);
+   return slot;
+}
+
+boost::int64_t *ShmCurveStore::historyRing(const StoreSlot &s) const
+{
+   return static_cast<boost::int64_t *>(blockAddress(s.history));
+}
+
+void ShmCurveStore::dropHistory(StoreSlot &s)
+{
+   if(!s.history) return;
+   boost::int64_t *ring = historyRing(s);
+   for(long i = 0; i < s.historyDepth; ++i)
+      if(ring[i]) retire(ring[i]);
+   segment_.deallocate(ring);
+   s.history = 0;
+   s.historyDepth = 0;
+   s.historyNext = 0;
+}
+
+void ShmCurveStore::recordHistory(StoreSlot &s)
+{
+   const ShmCurveBlockView current(blockAddress(s.block));
+
+   //entries are rewritten in place while the curve fits, a new entry is sized to the curve
+   boost::int64_t &entry = historyRing(s)[s.historyNext];
+   size_t bytes = entry ? blockBytes(static_cast<const BlockHeader *>(blockAddress(entry))->capacity) : 0;
+   if(bytes < blockBytes(current.size())) {
+      bytes = blockBytes(current.size());
+      void *mem = segment_.allocate(bytes);
+      std::memset(mem, 0, sizeof(BlockHeader));
+      if(entry) retire(entry);
+      entry = static_cast<char *>(mem) - static_cast<char *>(segment_.get_address());
+   }
+   copyBlock(blockAddress(entry), bytes, current);
+   s.historyNext = (s.historyNext + 1) % s.historyDepth;
+}
+
+void ShmCurveStore::setHistoryDepth(const char *name, long depth)
+{
+   if(depth < 0 || depth > STORE_MAX_HISTORY)
+      throw pdg::Error(2, "#Error in ShmCurveStore::setHistoryDepth, depth must be between 0 and " + xtos(STORE_MAX_HISTORY));
+   if(!name || !name[0] || std::strlen(name) >= BLOCK_NAME_SZ)
+      throw pdg::Error(2, "#Error in ShmCurveStore::setHistoryDepth, curve names must have 1 to " + xtos(BLOCK_NAME_SZ - 1) + " characters");
+
+   store_lock lock(dir_->mutex);
+
+   long slot = slotIndex(name);
+   if(slot < 0) slot = createSlot(name);
+   StoreSlot &s = dir_->slots[slot];
+   if(s.historyDepth == depth) return;
+
+   dropHistory(s);
+   reclaim();
+   if(!depth) return;
+   void *ring = segment_.allocate(depth * sizeof(boost::int64_t));
+   std::memset(ring, 0, depth * sizeof(boost::int64_t));
+   s.history = static_cast<char *>(ring) - static_cast<char *>(segment_.get_address());
+   s.historyDepth = depth;
+   s.historyNext = 0;
+   if(s.block) recordHistory(s);
+}
+
+boost::uint64_t ShmCurveStore::publish(const BlockSpec &spec, const long *dates, const double *discs, long n)
+{
+   if(!spec.name || !spec.name[0] || std::strlen(spec.name) >= BLOCK_NAME_SZ)
+      throw pdg::Error(2, "#Error in ShmCurveStore::publish, curve names must have 1 to " + xtos(BLOCK_NAME_SZ - 1) + " characters");
+   if(n < 1) throw pdg::Error(2, "#Error in ShmCurveStore::publish, empty curve");
+
+   store_lock lock(dir_->mutex);
+
+   long slot = slotIndex(spec.name);
+   if(slot < 0) slot = createSlot(spec.name);
+   StoreSlot &s = dir_->slots[slot];
+
+   //a new block is written before the slot points to it, the readers never see it half built
+   boost::int64_t block = s.block;
+   long capacity = s.capacity;
+   if(!block || capacity < n) {
+      capacity = STORE_MIN_CAPACITY;
+      while(capacity < n) capacity *= 2;
+      void *mem = segment_.allocate(blockBytes(capacity));
+      std::memset(mem, 0, sizeof(BlockHeader));
+      block = static_cast<char *>(mem) - static_cast<char *>(segment_.get_address());
+   }
+
+   BlockSpec published(spec);
+   published.version = s.version + 1;
+   published.publishTime = xlNow();
+   try {
+      writeBlock(blockAddress(block), blockBytes(capacity), published, dates, discs, n);
+   }
+   catch(...) {
+      //a rejected curve: a fresh block is given back, the current one is left non evaluable
+      if(block != s.block) segment_.deallocate(blockAddress(block));
+      throw;
+   }
+   if(block != s.block) {
+      const boost::int64_t old = s.block;
+      beginWrite(s);
+      s.block = block;
+      s.capacity = capacity;
+      endWrite(s);
+      if(old) retire(old);
+   }
+   s.version = published.version;
+   if(s.historyDepth) recordHistory(s);
+   reclaim();
+
+   atomic_ops::increment(dir_->epoch);
+   wakeWaiters();
+   return s.version;
+}
+
+void ShmCurveStore::remove(const char *name)
+{
+   store_lock lock(dir_->mutex);
+
+   long slot = slotIndex(name);
+   if(slot < 0) return;
+   StoreSlot &s = dir_->slots[slot];
+   if(s.block) retire(s.block);
+   if(s.composite) retire(s.composite);
+   dropHistory(s);
+   s.composite = 0;
+   beginWrite(s);
+   s.block = 0;
+   s.capacity = 0;
+   s.name[0] = 0;
+   ++s.generation;
+   endWrite(s);
+   reclaim();
+
+   atomic_ops::increment(dir_->epoch);
+   wakeWaiters();
+}
+
+long ShmCurveStore::findSlot(const char *name, boost::uint32_t *generation) const
+{
+   store_lock lock(dir_->mutex);
+   long slot = slotIndex(name);
+   if(generation) *generation = slot < 0 ? 0 : dir_->slots[slot].generation;
+   return slot;
+}
+
+ShmCurveBlockView ShmCurveStore::slotView(long slot, boost::uint32_t generation) const
+{
+   return resolve(CurveRef(slot, generation), rmCurrent, 0, 0.);
+}
+
+long ShmCurveStore::refSlot(const CurveRef &ref) const
+{
+   if(ref.name) return slotIndex(ref.name);
+   if(ref.slot < 0 || ref.slot >= dir_->nSlots) return -1;
+   const StoreSlot &s = dir_->slots[ref.slot];
+   return (s.name[0] && s.generation == ref.generation) ? ref.slot : -1;
+}
+
+bool ShmCurveStore::readCurrent(const CurveRef &ref, ShmCurveBlockView &view) const
+{
+   view = ShmCurveBlockView();
+   const long nSlots = dir_->nSlots;
+   atomic_ops::fence();
+   if(!ref.name && (ref.slot < 0 || ref.slot >= nSlots)) return true;
+
+   const long first = ref.name ? 0 : ref.slot, last = ref.name ? nSlots : ref.slot + 1;
+   for(long i = first; i < last; ++i) {
+      const StoreSlot &s = dir_->slots[i];
+      for(long retry = 0; ; ++retry) {
+         if(retry == SLOT_READ_RETRIES) return false;
+         const boost::uint32_t seq = atomic_ops::load(s.seq);
+         if(seq & 1) continue;
+         const bool match = ref.name ? sameName(s.name, ref.name) : (s.name[0] && s.generation == ref.generation);
+         const boost::int64_t block = s.block;
+         if(atomic_ops::load(s.seq) != seq) continue;
+         if(!match) break;
+         if(block) view = ShmCurveBlockView(blockAddress(block));
+         return true;
+      }
+   }
+   return true;
+}
+
+ShmCurveBlockView ShmCurveStore::resolve(const CurveRef &ref, resolve_mode mode, boost::uint64_t version, double xlTime) const
+{
+   if(mode == rmCurrent) {
+      ShmCurveBlockView view;
+      if(readCurrent(ref, view)) return view;
+   }
+
+   store_lock lock(dir_->mutex);
+   long slot = refSlot(ref);
+   if(slot < 0) return ShmCurveBlockView();
+   const StoreSlot &s = dir_->slots[slot];
+
+   //the current block answers for its own version and time even when no history is kept
+   if(s.block) {
+      const BlockHeader *current = static_cast<const BlockHeader *>(blockAddress(s.block));
+      if(mode == rmCurrent || (mode == rmVersion && current->version == version) ||
+         (mode == rmTime && current->publishTime <= xlTime))
+         return ShmCurveBlockView(current);
+   }
+   if(mode == rmCurrent || !s.history) return ShmCurveBlockView();
+
+   const BlockHeader *best = 0;
+   const boost::int64_t *ring = historyRing(s);
+   for(long i = 0; i < s.historyDepth; ++i) {
+      if(!ring[i]) continue;
+      const BlockHeader *h = static_cast<const BlockHeader *>(blockAddress(ring[i]));
+      if(mode == rmVersion && h->version == version) return ShmCurveBlockView(h);
+      if(mode == rmTime && h->publishTime <= xlTime && (!best || h->publishTime > best->publishTime)) best = h;
+   }
+   return best ? ShmCurveBlockView(best) : ShmCurveBlockView();
+}
+
+ShmCurveBlockView ShmCurveStore::find(const char *name) const
+{
+   return resolve(name, rmCurrent, 0, 0.);
+}
+
+ShmCurveBlockView ShmCurveStore::findVersion(const char *name, boost::uint64_t version) const
+{
+   return resolve(name, rmVersion, version, 0.);
+}
+
+ShmCurveBlockView ShmCurveStore::findAtTime(const char *name, double xlTime) const
+{
+   return resolve(name, rmTime, 0, xlTime);
+}
+
+long ShmCurveStore::history(const char *name, long sz, boost::uint64_t *versions, double *publishTimes) const
+{
+   store_lock lock(dir_->mutex);
+   long slot = slotIndex(name);
+   if(slot < 0) return 0;
+   const StoreSlot &s = dir_->slots[slot];
+
+   long count = 0;
+   if(!s.history) {
+      if(s.block && sz > 0) {
+         const BlockHeader *current = static_cast<const BlockHeader *>(blockAddress(s.block));
+         versions[0] = current->version;
+         publishTimes[0] = current->publishTime;
+         count = 1;
+      }
+      return count;
+   }
+   const boost::int64_t *ring = historyRing(s);
+   for(long k = 1; k <= s.historyDepth && count < sz; ++k) {
+      const boost::int64_t entry = ring[(s.historyNext - k + s.historyDepth) % s.historyDepth];
+      if(!entry) break;
+      const BlockHeader *h = static_cast<const BlockHeader *>(blockAddress(entry));
+      versions[count] = h->version;
+      publishTimes[count] = h->publishTime;
+      ++count;
+   }
+   return count;
+}
+
+bool ShmCurveStore::sameCurve(const CurveRef &ref, const BlockHeader &h) const
+{
+   if(ref.name) return sameName(h.name, ref.name);
+   const StoreSlot &s = dir_->slots[ref.slot];
+   for(long retry = 0; retry < SLOT_READ_RETRIES; ++retry) {
+      const boost::uint32_t seq = atomic_ops::load(s.seq);
+      if(seq & 1) continue;
+      const bool same = s.generation == ref.generation && std::strncmp(s.name, h.name, BLOCK_NAME_SZ) == 0;
+      if(atomic_ops::load(s.seq) == seq) return same;
+   }
+   return false;
+}
+
+bool ShmCurveStore::interpDiscResolved(const CurveRef &ref, resolve_mode mode, boost::uint64_t version, double xlTime,
+                                       const long *dates, long n, double *out, long depth) const
+{
+   ReadGuard guard(*this);
+   for(long attempts = 0; ; retryRead(attempts, "ShmCurveStore::interpDisc")) {
+      ShmCurveBlockView view = resolve(ref, mode, version, xlTime);
+      if(!view.valid()) return false;
+
+      boost::uint32_t seq = view.beginRead();
+      const boost::uint32_t flags = view.header().flags;
+      if(flags & bfRetired) continue;
+      if(!(flags & bfEvaluable)) {
+         if(view.endRead(seq)) return false;
+         continue;
+      }
+
+      if(flags & bfSpread) {
+         char backbone[BLOCK_NAME_SZ];
+         std::memcpy(backbone, view.header().backbone, BLOCK_NAME_SZ);
+         if(!view.endRead(seq)) continue;
+         if(depth >= STORE_MAX_SPREAD_CHAIN)
+            throw pdg::Error(2, std::string("#Error in ShmCurveStore, backbone chain too long (or circular) for curve ") + backbone);
+         if(!interpDiscResolved(backbone, mode == rmTime ? rmTime : rmCurrent, 0, xlTime, dates, n, out, depth + 1))
+            return false;
+         seq = view.beginRead();
+         if(view.header().flags & bfRetired) continue;
+      }
+
+      try {
+         if(flags & bfSpread) {
+            //spread discounts multiply the backbone ones, in chunks to stay off the heap
+            const long CHUNK = 64;
+            double spread[CHUNK];
+            for(long k = 0; k < n; k += CHUNK) {
+               const long m = std::min(CHUNK, n - k);
+               view.discounts(dates + k, m, spread);
+               for(long j = 0; j < m; ++j) out[k + j] *= spread[j];
+            }
+         }
+         else view.discounts(dates, n, out);
+      }
+      catch(pdg::Error) {
+         if(view.endRead(seq)) throw; // a genuine error, not a torn read
+         continue;
+      }
+      const bool same = sameCurve(ref, view.header());
+      if(view.endRead(seq) && same) return true;
+   }
+}
+
+boost::uint64_t ShmCurveStore::effectiveVersion(long slot, long depth) const
+{
+   const StoreSlot &s = dir_->slots[slot];
+   if(!s.block) return s.version;
+   const BlockHeader *h = static_cast<const BlockHeader *>(blockAddress(s.block));
+   if(!(h->flags & bfSpread) || depth >= STORE_MAX_SPREAD_CHAIN) return s.version;
+   long backbone = slotIndex(h->backbone);
+   return s.version + (backbone < 0 ? 0 : effectiveVersion(backbone, depth + 1));
+}
+
+void ShmCurveStore::pillarDates(const char *name, std::vector<long> &dates, long depth)
+{
+   if(depth > STORE_MAX_SPREAD_CHAIN)
+      throw pdg::Error(2, std::string("#Error in ShmCurveStore, backbone chain too long (or circular) for curve ") + name);
+   ReadGuard guard(*this);
+   for(long attempts = 0; ; retryRead(attempts, "ShmCurveStore::pillarDates")) {
+      ShmCurveBlockView view = find(name);
+      if(!view.valid()) throw pdg::Error(2, std::string("#Error in ShmCurveStore, curve not published: ") + name);
+
+      boost::uint32_t seq = view.beginRead();
+      const size_t first = dates.size();
+      dates.insert(dates.end(), view.dates(), view.dates() + view.size());
+      char backbone[BLOCK_NAME_SZ];
+      std::memcpy(backbone, view.header().backbone, BLOCK_NAME_SZ);
+      const bool spread = (view.header().flags & bfSpread) != 0;
+      const bool same = sameName(view.header().name, name);
+      if(!view.endRead(seq) || (view.header().flags & bfRetired) || !same) {
+         dates.resize(first);
+         continue;
+      }
+      if(spread) pillarDates(backbone, dates, depth + 1);
+      return;
+   }
+}
+
+ShmCurveBlockView ShmCurveStore::composite(const char *name)
+{
+   for(long attempts = 0; ; retryRead(attempts, "ShmCurveStore::composite")) {
+      boost::uint64_t spreadVersion, backboneVersion;
+      BlockSpec spec;
+      {
+         store_lock lock(dir_->mutex);
+         long slot = slotIndex(name);
+         if(slot < 0 || !dir_->slots[slot].block) return ShmCurveBlockView();
+         const StoreSlot &s = dir_->slots[slot];
+         const BlockHeader *h = static_cast<const BlockHeader *>(blockAddress(s.block));
+         if(!(h->flags & bfSpread)) return ShmCurveBlockView(h);
+
+         spreadVersion = s.version;
+         backboneVersion = effectiveVersion(slot, 0) - s.version;
+         if(s.composite && s.compositeVersion == spreadVersion && s.compositeBackbone == backboneVersion)
+            return ShmCurveBlockView(blockAddress(s.composite));
+
+         spec.currency = h->currency;
+         spec.typeInterp = h->typeInterp;
+         spec.interpOn = h->interpOn % 20;
+         spec.comp = h->comp;
+         spec.dayCount = h->dayCount;
+      }
+
+      //the grid is built without holding the directory, the evaluation takes it
+      std::vector<long> grid;
+      pillarDates(name, grid, 0);
+      const long today = grid.front(); // the spread calc date comes first
+      std::sort(grid.begin(), grid.end());
+      grid.erase(std::unique(grid.begin(), grid.end()), grid.end());
+      grid.erase(grid.begin(), std::lower_bound(grid.begin(), grid.end(), today));
+      std::vector<double> discs(grid.size());
+      if(grid.empty() || !interpDisc(name, &grid[0], static_cast<long>(grid.size()), &discs[0]))
+         throw pdg::Error(2, std::string("#Error in ShmCurveStore::composite, unable to evaluate curve ") + name);
+
+      store_lock lock(dir_->mutex);
+      long slot = slotIndex(name);
+      if(slot < 0) return ShmCurveBlockView();
+      StoreSlot &s = dir_->slots[slot];
+      if(s.version != spreadVersion || effectiveVersion(slot, 0) - s.version != backboneVersion)
+         continue; // republished meanwhile
+
+      const long n = static_cast<long>(grid.size());
+      size_t bytes = s.composite ? blockBytes(static_cast<const BlockHeader *>(blockAddress(s.composite))->capacity) : 0;
+      if(bytes < blockBytes(n)) {
+         long capacity = STORE_MIN_CAPACITY;
+         while(capacity < n) capacity *= 2;
+         bytes = blockBytes(capacity);
+         void *mem = segment_.allocate(bytes);
+         std::memset(mem, 0, sizeof(BlockHeader));
+         if(s.composite) retire(s.composite);
+         s.composite = static_cast<char *>(mem) - static_cast<char *>(segment_.get_address());
+      }
+      spec.version = spreadVersion;
+      spec.publishTime = xlNow();
+      spec.name = s.name;
+      writeBlock(blockAddress(s.composite), bytes, spec, &grid[0], &discs[0], n);
+      s.compositeVersion = spreadVersion;
+      s.compositeBackbone = backboneVersion;
+      reclaim();
+      return ShmCurveBlockView(blockAddress(s.composite));
+   }
+}
+
+bool ShmCurveStore::interpDisc(const char *name, const long *dates, long n, double *out) const
+{
+   return interpDiscResolved(name, rmCurrent, 0, 0., dates, n, out);
+}
+
+bool ShmCurveStore::interpDiscSlot(long slot, boost::uint32_t generation, const long *dates, long n, double *out) const
+{
+   return interpDiscResolved(CurveRef(slot, generation), rmCurrent, 0, 0., dates, n, out);
+}
+
+bool ShmCurveStore::interpDiscAtVersion(const char *name, boost::uint64_t version, const long *dates, long n, double *out) const
+{
+   return interpDiscResolved(name, rmVersion, version, 0., dates, n, out);
+}
+
+bool ShmCurveStore::interpDiscAtTime(const char *name, double xlTime, const long *dates, long n, double *out) const
+{
+   return interpDiscResolved(name, rmTime, 0, xlTime, dates, n, out);
+}
+
+boost::uint32_t ShmCurveStore::epoch() const
+{
+   return atomic_ops::load(dir_->epoch);
+}
+
+void ShmCurveStore::wakeWaiters()
+{
+   //publishers only pay for the system call when somebody is waiting
+   const boost::uint32_t waiters = atomic_ops::load(dir_->waiters);
+   if(!waiters) return;
+#if defined(_WIN32)
+   if(wakeSemaphore()) ReleaseSemaphore(wakeSemaphore(), static_cast<LONG>(waiters), 0);
+#else
+   atomic_ops::wakeAll(dir_->epoch);
+#endif
+}
+
+void ShmCurveStore::waitForEpoch(boost::uint32_t epoch, long timeoutMs, long &backoffMs) const
+{
+#if defined(_WIN32)
+   (void)epoch; // the semaphore is released after the epoch moves
+   if(wakeSemaphore()) {
+      WaitForSingleObject(wakeSemaphore(), static_cast<DWORD>(timeoutMs));
+      return;
+   }
+#else
+   if(atomic_ops::waitWhileEqual(dir_->epoch, epoch, timeoutMs)) return;
+#endif
+
+   //no cross process wait on this platform: poll the epoch with an increasing sleep
+   boost::this_thread::sleep(boost::posix_time::milliseconds(std::min(backoffMs, timeoutMs)));
+   backoffMs = std::min(2 * backoffMs, MAX_POLL_MS);
+}
+
+void ShmCurveStore::versions(const char **names, long n, boost::uint64_t *out) const
+{
+   store_lock lock(dir_->mutex);
+   for(long i = 0; i < n; ++i) {
+      long slot = slotIndex(names[i]);
+      out[i] = slot < 0 ? 0 : effectiveVersion(slot, 0);
+   }
+}
+
+long ShmCurveStore::waitForChange(const char **names, long n, boost::uint64_t *known, long timeoutMs, long batchMs) const
+{
+   if(n <= 0) return 0;
+
+   WaiterGuard guard(dir_->waiters);
+   const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+   std::vector<boost::uint64_t> current(n);
+   long backoffMs = 1;
+
+   for(;;) {
+      //the epoch is read before the versions: a publication in between makes the wait return at once
+      const boost::uint32_t e = epoch();
+      versions(names, n, &current[0]);
+      if(!std::equal(current.begin(), current.end(), known)) break;
+
+      const long remaining = timeoutMs - msSince(start);
+      if(remaining <= 0) return 0;
+      waitForEpoch(e, remaining, backoffMs);
+   }
+
+   if(batchMs > 0) {
+      const boost::posix_time::ptime batchStart = boost::posix_time::microsec_clock::universal_time();
+      backoffMs = 1;
+      for(long remaining = batchMs; remaining > 0; remaining = batchMs - msSince(batchStart))
+         waitForEpoch(epoch(), remaining, backoffMs);
+      versions(names, n, &current[0]);
+   }
+
+   long changed = 0;
+   for(long i = 0; i < n; ++i) {
+      if(current[i] != known[i]) ++changed;
+      known[i] = current[i];
+   }
+   return changed;
+}
+
+} // namespace shm_curve
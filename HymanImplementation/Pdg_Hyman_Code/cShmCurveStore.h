@@ -0,0 +1,203 @@
+//cShmCurveStore.h
+#ifndef _CSHMCURVESTORE_H__
+#define _CSHMCURVESTORE_H__
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include "cShmCurveBlock.h"
+
+namespace shm_curve {
+
+/**
+* @defgroup shmcurvestore Directory of the published curve blocks.
+*
+* The blocks live in a dedicated managed shared memory segment, next to the
+* one used by ShmLibor. A curve keeps its slot (and its block, as long as the
+* number of pillars fits in the capacity) for the life of the segment, so a
+* republication rewrites the block in place. When a block has to grow (or a
+* curve, its history or its composite grid goes) the old one is flagged as
+* retired and freed only once no reader can hold it: readers register in the
+* current read phase for as long as they use a block (ReadGuard), the blocks
+* retired in a phase are freed by a later writer once the readers of that
+* phase are all gone, and the phase moves on. A reader that dies inside keeps
+* the blocks retired since then allocated, it never exposes freed memory.
+* After a read, the readers also check that the block still carries the name
+* (and the slot the generation) of the curve they resolved.
+* Optionally a curve keeps a ring with its last publications (the current one
+* included), each as a compact copy of the block, so that it can be evaluated
+* as of a given version or time.
+* The current block of a curve is resolved without the directory lock: a
+* slot is changed under the lock by writers bumping its seq around the change
+* (odd while inside), readers take the name, generation and block of the slot
+* and retry when seq moved, as for the blocks themselves. Past publications
+* and the writers still take the lock. The directory starts with a magic, a
+* layout version and its own size: a segment created by a build with another
+* layout is rejected rather than misread. The segment (its allocator, the
+* mutex of the directory) is only shared by processes of the same bitness, a
+* 32 bit process finds a directory of another size.
+* Spread curves (published with a backbone name) are composite: their
+* discounts are the product of the backbone and spread discounts, evaluated
+* on the fly against both blocks, so a backbone republication is seen by all
+* its spread curves without pushing them again. Consumers needing pillars get
+* a materialised grid on the union of both pillar sets, cached in the spread
+* slot and rebuilt only when the version of either component changes.
+*/
+
+//@{
+const boost::uint32_t STORE_MAGIC          = 0x44474450; // "PDGD"
+const boost::uint32_t STORE_LAYOUT_VERSION = 3;
+const char * const STORE_SEGMENT_NAME  = "PDG_SHM_CURVE_BLOCKS";
+const size_t       STORE_SEGMENT_SIZE  = 128 * 1024 * 1024;
+const long         STORE_MAX_CURVES    = 1024;
+const long         STORE_MIN_CAPACITY  = 64;
+const long         STORE_MAX_HISTORY   = 256;
+const long         STORE_MAX_SPREAD_CHAIN = 4;  // spread over spread over ... backbone
+
+// offsets are from the beginning of the segment, which every process maps at its own address
+struct StoreSlot {
+   volatile boost::uint32_t seq;        // odd while name, block or generation change
+   char            name[BLOCK_NAME_SZ]; // empty for a free slot
+   boost::int64_t  block;               // offset of the block in the segment, 0 if none
+   boost::int32_t  capacity;
+   boost::uint64_t version;
+   boost::int64_t  history;             // offset of the ring of history block offsets, 0 if none
+   boost::int32_t  historyDepth;
+   boost::int32_t  historyNext;         // ring entry written by the next publication
+   boost::uint32_t generation;          // changes when the slot is given to a curve or freed
+   boost::int64_t  composite;           // materialised grid of a spread curve, 0 if none
+   boost::uint64_t compositeVersion;    // version of the spread ...
+   boost::uint64_t compositeBackbone;   // ... and effective version of the backbone it was built from
+};
+
+struct StoreDirectory {
+   boost::uint32_t magic;
+   boost::uint32_t layoutVersion;
+   boost::uint32_t directoryBytes;     // sizeof(StoreDirectory) of the creator
+   boost::interprocess::interprocess_mutex mutex;
+   volatile boost::uint32_t epoch;     // incremented on every publication or removal
+   volatile boost::uint32_t waiters;   // processes blocked in waitForChange, see wakeWaiters
+   volatile boost::int32_t nSlots;     // only grows
+   volatile boost::uint32_t readPhase; // phase the readers register in, see ReadGuard
+   volatile boost::uint32_t readers[2];// readers inside, by parity of the phase they registered in
+   boost::int64_t  retiredCurrent;     // blocks retired in the current phase, chained by retiredNext
+   boost::int64_t  retiredPrevious;    // ... and in the previous one
+   StoreSlot       slots[STORE_MAX_CURVES];
+};
+
+class ShmCurveStore
+{
+public:
+   static ShmCurveStore &Instance();
+
+   //Registers the calling thread as a reader for its lifetime: the blocks it resolves in the meantime
+   //are not freed. The views returned by the store (find, slotView, composite, ...) are to be resolved
+   //and read under a guard taken before; the evaluations of the store take their own.
+   class ReadGuard
+   {
+   public:
+      explicit ReadGuard(const ShmCurveStore &store);
+      ~ReadGuard();
+   private:
+      ReadGuard(const ReadGuard &);
+      ReadGuard &operator=(const ReadGuard &);
+
+      volatile boost::uint32_t *readers_;
+   };
+
+   //builds the block of spec.name in place, version and publish time of spec are assigned here
+   boost::uint64_t publish(const BlockSpec &spec, const long *dates, const double *discs, long n);
+   void remove(const char *name);
+   //number of past publications kept for the named curve, 0 to stop keeping them
+   void setHistoryDepth(const char *name, long depth);
+
+   //slot of the named curve and its generation, -1 if it is not published
+   long findSlot(const char *name, boost::uint32_t *generation = 0) const;
+   //view on the current block of the slot, not valid if the slot has been freed or reused since
+   //the generation was read
+   ShmCurveBlockView slotView(long slot, boost::uint32_t generation) const;
+   ShmCurveBlockView find(const char *name) const;
+   //block of the given publication, not valid if it is no longer (or was never) kept
+   ShmCurveBlockView findVersion(const char *name, boost::uint64_t version) const;
+   //block of the last publication at or before the XL serial date-time xlTime
+   ShmCurveBlockView findAtTime(const char *name, double xlTime) const;
+   //versions and publish times of the kept publications, newest first, returns how many were written
+   long history(const char *name, long sz, boost::uint64_t *versions, double *publishTimes) const;
+
+   //evaluates the discounts of the named outright curve against the mapped block,
+   //false if the curve is not published or not supported by the block evaluator
+   bool interpDisc(const char *name, const long *dates, long n, double *out) const;
+   //same as interpDisc, false also when the slot has been freed or reused since generation was read
+   bool interpDiscSlot(long slot, boost::uint32_t generation, const long *dates, long n, double *out) const;
+   //a spread curve at a past version is composed with the current backbone, at a past time with
+   //the backbone as it was at that time
+   bool interpDiscAtVersion(const char *name, boost::uint64_t version, const long *dates, long n, double *out) const;
+   bool interpDiscAtTime(const char *name, double xlTime, const long *dates, long n, double *out) const;
+
+   boost::uint32_t epoch() const;
+
+   //materialised block of a composite curve, the current block for outright curves
+   ShmCurveBlockView composite(const char *name);
+
+   //Current versions of the named curves (0 for curves not published), under a single lock.
+   //The version of a spread curve also moves when its backbone is republished.
+   void versions(const char **names, long n, boost::uint64_t *out) const;
+
+   //Blocks until the version of at least one of the named curves differs from the one in known,
+   //or timeoutMs elapses. Once a change is seen, waits batchMs more so that a burst of publications
+   //is collected by a single wake up. known is updated, the number of changed curves is returned.
+   long waitForChange(const char **names, long n, boost::uint64_t *known, long timeoutMs, long batchMs) const;
+
+private:
+   ShmCurveStore();
+   ShmCurveStore(const ShmCurveStore &);
+   ShmCurveStore &operator=(const ShmCurveStore &);
+
+   enum resolve_mode { rmCurrent, rmVersion, rmTime };
+
+   //a curve is referred to by name, or by slot and slot generation
+   struct CurveRef {
+      CurveRef(const char *n) : name(n), slot(-1), generation(0) {}
+      CurveRef(long s, boost::uint32_t g) : name(0), slot(s), generation(g) {}
+      const char *name;
+      long slot;
+      boost::uint32_t generation;
+   };
+
+   //the caller must hold the directory lock
+   long slotIndex(const char *name) const;
+   long createSlot(const char *name);
+   void retire(boost::int64_t block);
+   //frees the blocks retired in the previous phase when its readers are gone, and starts a new phase
+   void reclaim();
+   void dropHistory(StoreSlot &s);
+   void recordHistory(StoreSlot &s);
+   boost::uint64_t effectiveVersion(long slot, long depth) const;
+   //the block read for the curve still carries its name and, for a slot, the slot its generation
+   bool sameCurve(const CurveRef &ref, const BlockHeader &h) const;
+
+   long refSlot(const CurveRef &ref) const;
+   //current block of the curve without the directory lock, false if no consistent read was made
+   bool readCurrent(const CurveRef &ref, ShmCurveBlockView &view) const;
+
+   ShmCurveBlockView resolve(const CurveRef &ref, resolve_mode mode, boost::uint64_t version, double xlTime) const;
+   bool interpDiscResolved(const CurveRef &ref, resolve_mode mode, boost::uint64_t version, double xlTime,
+                           const long *dates, long n, double *out, long depth = 0) const;
+   void pillarDates(const char *name, std::vector<long> &dates, long depth);
+   boost::int64_t *historyRing(const StoreSlot &s) const;
+   void *blockAddress(boost::int64_t block) const;
+   void wakeWaiters();
+   void waitForEpoch(boost::uint32_t epoch, long timeoutMs, long &backoffMs) const;
+
+   mutable boost::interprocess::managed_shared_memory segment_;
+   StoreDirectory *dir_;
+};
+
+// XL serial date-time of the local clock, used to stamp publications
+double xlNow();
+//@}
+
+} // namespace shm_curve
+
+#endif // _CSHMCURVESTORE_H__
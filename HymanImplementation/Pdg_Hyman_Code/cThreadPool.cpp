@@ -0,0 +1,189 @@
+//cThreadPool.cpp
+#include <boost/bind.hpp>
+#include <boost/thread/tss.hpp>
+#include "cThreadPool.h"
+
+namespace parallel {
+
+namespace {
+   //identifies the pool and the queue of the calling worker thread
+   struct WorkerId {
+      const ThreadPool *pool;
+      long id;
+   };
+   boost::thread_specific_ptr<WorkerId> currentWorker;
+
+   //completion count of the tasks of ThreadPool::run
+   struct Batch {
+      boost::mutex mutex;
+      boost::condition_variable done;
+      long remaining;
+   };
+
+   void runCounted(const ThreadPool::task_type &task, Batch *batch)
+   {
+      try {
+         task();
+      }
+      catch(...) {
+      }
+      boost::mutex::scoped_lock lock(batch->mutex);
+      if(!--batch->remaining) batch->done.notify_all();
+   }
+}
+
+namespace {
+   struct SharedPool {
+      SharedPool() : size(0) {}
+      boost::mutex mutex;
+      boost::shared_ptr<ThreadPool> pool;
+      long size;
+   };
+
+   SharedPool &sharedPool()
+   {
+      static SharedPool res;
+      return res;
+   }
+}
+
+boost::shared_ptr<ThreadPool> ThreadPool::shared()
+{
+   SharedPool &s = sharedPool();
+   boost::mutex::scoped_lock lock(s.mutex);
+   if(!s.pool) s.pool.reset(new ThreadPool(s.size));
+   return s.pool;
+}
+
+void ThreadPool::setSharedSize(long nThreads)
+{
+   boost::shared_ptr<ThreadPool> old;
+   {
+      SharedPool &s = sharedPool();
+      boost::mutex::scoped_lock lock(s.mutex);
+      if(nThreads <= 0) nThreads = 0;
+      if(s.pool && s.size == nThreads) return;
+      s.size = nThreads;
+      old.swap(s.pool);
+   }
+   //joined here, outside of the lock, when no call holds it any more
+}
+
+void ThreadPool::shutdownShared()
+{
+   boost::shared_ptr<ThreadPool> old;
+   {
+      SharedPool &s = sharedPool();
+      boost::mutex::scoped_lock lock(s.mutex);
+      old.swap(s.pool);
+   }
+}
+
+ThreadPool::ThreadPool(long nThreads)
+: queued_(0), pending_(0), nextQueue_(0), stop_(false)
+{
+   if(nThreads <= 0) nThreads = static_cast<long>(boost::thread::hardware_concurrency());
+   if(nThreads <= 0) nThreads = 1;
+   for(long i = 0; i < nThreads; ++i) queues_.push_back(boost::shared_ptr<Queue>(new Queue));
+   for(long i = 0; i < nThreads; ++i) threads_.create_thread(boost::bind(&ThreadPool::work, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      stop_ = true;
+   }
+   workAvailable_.notify_all();
+   threads_.join_all();
+}
+
+void ThreadPool::submit(const task_type &task)
+{
+   const WorkerId *worker = currentWorker.get();
+   const bool local = worker && worker->pool == this;
+   long id;
+   {
+      boost::mutex::scoped_lock lock(mutex_);
+      ++pending_;
+      ++queued_;
+      id = local ? worker->id : (nextQueue_++ % size());
+   }
+   {
+      Queue &q = *queues_[id];
+      boost::mutex::scoped_lock lock(q.mutex);
+      if(local) q.tasks.push_front(task);
+      else q.tasks.push_back(task);
+   }
+   workAvailable_.notify_one();
+}
+
+void ThreadPool::run(const std::vector<task_type> &tasks)
+{
+   Batch batch;
+   batch.remaining = static_cast<long>(tasks.size());
+   for(size_t i = 0; i < tasks.size(); ++i) submit(boost::bind(&runCounted, tasks[i], &batch));
+
+   boost::mutex::scoped_lock lock(batch.mutex);
+   while(batch.remaining) batch.done.wait(lock);
+}
+
+void ThreadPool::wait()
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   while(pending_) allDone_.wait(lock);
+}
+
+bool ThreadPool::take(long id, task_type &task)
+{
+   {
+      Queue &own = *queues_[id];
+      boost::mutex::scoped_lock lock(own.mutex);
+      if(!own.tasks.empty()) {
+         task = own.tasks.front();
+         own.tasks.pop_front();
+         return true;
+      }
+   }
+   for(long k = 1; k < size(); ++k) {
+      Queue &victim = *queues_[(id + k) % size()];
+      boost::mutex::scoped_lock lock(victim.mutex);
+      if(!victim.tasks.empty()) {
+         task = victim.tasks.back();
+         victim.tasks.pop_back();
+         return true;
+      }
+   }
+   return false;
+}
+
+void ThreadPool::work(long id)
+{
+   WorkerId *worker = new WorkerId;
+   worker->pool = this;
+   worker->id = id;
+   currentWorker.reset(worker);
+
+   for(;;) {
+      {
+         boost::mutex::scoped_lock lock(mutex_);
+         while(!queued_ && !stop_) workAvailable_.wait(lock);
+         if(stop_ && !queued_) return;
+         --queued_; // this worker will find a task, in its queue or in another one
+      }
+      task_type task;
+      while(!take(id, task))
+         boost::this_thread::yield(); // the task counted above is still being pushed
+
+      try {
+         task();
+      }
+      catch(...) {
+      }
+
+      boost::mutex::scoped_lock lock(mutex_);
+      if(!--pending_) allDone_.notify_all();
+   }
+}
+
+} // namespace parallel
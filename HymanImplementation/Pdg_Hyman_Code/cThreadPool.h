@@ -0,0 +1,78 @@
+//cThreadPool.h
+#ifndef _CTHREADPOOL_H__
+#define _CTHREADPOOL_H__
+
+#include <deque>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace parallel {
+
+/**
+* @defgroup threadpool Work stealing thread pool.
+*
+* Each worker owns a queue: tasks submitted from a worker go to the front
+* of its own queue (so dependent work stays hot in its cache), tasks
+* submitted from outside are dealt round robin. An idle worker takes from
+* the front of its queue and steals from the back of the others.
+* Tasks must not throw: an escaping exception is swallowed by the pool.
+*/
+
+//@{
+class ThreadPool
+{
+public:
+   typedef boost::function<void()> task_type;
+
+   //nThreads <= 0 uses the number of hardware threads
+   explicit ThreadPool(long nThreads = 0);
+   ~ThreadPool();
+
+   void submit(const task_type &task);
+   //submits the tasks and blocks until all of them have completed, not to be called from a task of the pool
+   void run(const std::vector<task_type> &tasks);
+   //blocks until every task submitted so far, and the ones they submitted, has completed
+   void wait();
+   long size() const { return static_cast<long>(queues_.size()); }
+
+   //pool shared by the library functions, held by the callers for the time of a call
+   static boost::shared_ptr<ThreadPool> shared();
+   //the next calls to shared() get a pool of nThreads threads (<= 0 for the hardware threads),
+   //the current pool finishes its tasks and ends with its last holder
+   static void setSharedSize(long nThreads);
+   //joins the threads of the shared pool now rather than in the static destruction of the library (under
+   //the loader lock when it is a DLL); a call still holding the pool joins them when it ends. A later
+   //shared() starts a new pool
+   static void shutdownShared();
+
+private:
+   struct Queue {
+      boost::mutex mutex;
+      std::deque<task_type> tasks;
+   };
+
+   ThreadPool(const ThreadPool &);
+   ThreadPool &operator=(const ThreadPool &);
+
+   void work(long id);
+   bool take(long id, task_type &task);
+
+   std::vector<boost::shared_ptr<Queue> > queues_;
+   boost::thread_group threads_;
+   boost::mutex mutex_;
+   boost::condition_variable workAvailable_;
+   boost::condition_variable allDone_;
+   long queued_;      // tasks waiting in the queues
+   long pending_;     // tasks submitted and not completed
+   long nextQueue_;
+   bool stop_;
+};
+//@}
+
+} // namespace parallel
+
+#endif // _CTHREADPOOL_H__
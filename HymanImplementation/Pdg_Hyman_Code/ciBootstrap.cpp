@@ -0,0 +1,604 @@
+//ciBootstrap.cpp
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "safe_begin.h"
+#include "ciBootstrap.h"
+#include "ciLibor.h"
+#include "cShmLibor.h"
+#include "eCurrency.h"
+#include "cIROptions.h"
+#include "cShmCurveStore.h"
+#include "rateBootstrapScheduler.h"
+#include "rateBootstrapSolver.h"
+#include "rateBootstrapState.h"
+#include "rateBootstrapScenarios.h"
+#include "rateDeltaLadder.h"
+#include "rateCrossCurrency.h"
+#include "cThreadPool.h"
+#include "cRTDebugger.h"
+#include "cError.h"
+#include "xtos.h"
+
+using namespace pdg::pdgbase;
+
+namespace {
+
+   //seconds since mark, which moves to now
+   double lap(boost::posix_time::ptime &mark)
+   {
+      const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+      const double res = (now - mark).total_microseconds() * 1.e-6;
+      mark = now;
+      return res;
+   }
+
+   std::string upperName(const char *name)
+   {
+      std::string res(name ? name : "");
+      std::transform(res.begin(), res.end(), res.begin(), toupper);
+      return res;
+   }
+
+   template <class Instrument>
+   struct EndsBefore {
+      EndsBefore(const Instrument *instr) : instr_(instr) {}
+      bool operator()(long a, long b) const { return instr_[a].end_date < instr_[b].end_date; }
+      const Instrument *instr_;
+   };
+
+   //instruments of the C interface sorted by end date, order[k] is the position in instr of the k-th
+   std::vector<libor::BootstrapInstrument> unpackInstruments(long n_instr, const pdg_bootstrap_instrument_type *instr,
+                                                             std::vector<long> *order = 0)
+   {
+      std::vector<long> idx(n_instr);
+      for(long i = 0; i < n_instr; ++i) idx[i] = i;
+      std::stable_sort(idx.begin(), idx.end(), EndsBefore<pdg_bootstrap_instrument_type>(instr));
+      if(order) *order = idx;
+
+      std::vector<libor::BootstrapInstrument> res(n_instr);
+      for(long i = 0; i < n_instr; ++i) {
+         const pdg_bootstrap_instrument_type &in = instr[idx[i]];
+         libor::BootstrapInstrument &out = res[i];
+         out.type = in.type;
+         out.quote = in.quote;
+         out.start = in.start_date;
+         out.end = in.end_date;
+         out.yrf = in.yrf;
+         if(in.n_fixed > 0) {
+            out.fixedDates.assign(in.fixed_dates, in.fixed_dates + in.n_fixed);
+            out.fixedYrf.assign(in.fixed_yrf, in.fixed_yrf + in.n_fixed);
+         }
+         if(in.n_float > 0) out.floatDates.assign(in.float_dates, in.float_dates + in.n_float);
+      }
+      return res;
+   }
+
+   //exogenous discounting curve read from shared memory, the points up to today are not pillars
+   std::auto_ptr<libor::BootstrapCurve> exogenousCurve(long today, const pdg::ZCData &data)
+   {
+      std::auto_ptr<libor::BootstrapCurve> curve(new libor::BootstrapCurve(today, data.typeInterp, data.interpOn, data.comp, data.dayCount));
+      std::vector<long> dates;
+      std::vector<double> discs;
+      for(long i = 0; i < data.get_size(); ++i) {
+         if(data.dates[i] <= today) continue;
+         dates.push_back(data.dates[i]);
+         discs.push_back(data.discounts[i]);
+      }
+      curve->setPillars(dates);
+      for(size_t k = 0; k < discs.size(); ++k) curve->setDiscount(static_cast<long>(k), discs[k]);
+      return curve;
+   }
+
+   std::vector<libor::CrossCurrencyInstrument> unpackCrossCurrency(long n_instr, const pdg_xccy_instrument_type *instr)
+   {
+      std::vector<long> idx(n_instr);
+      for(long i = 0; i < n_instr; ++i) idx[i] = i;
+      std::stable_sort(idx.begin(), idx.end(), EndsBefore<pdg_xccy_instrument_type>(instr));
+
+      std::vector<libor::CrossCurrencyInstrument> res(n_instr);
+      for(long i = 0; i < n_instr; ++i) {
+         const pdg_xccy_instrument_type &in = instr[idx[i]];
+         libor::CrossCurrencyInstrument &out = res[i];
+         out.type = in.type;
+         out.quote = in.quote;
+         out.start = in.start_date;
+         out.end = in.end_date;
+         out.yrf = in.yrf;
+         if(in.n_for > 0) {
+            out.forDates.assign(in.for_dates, in.for_dates + in.n_for);
+            out.forYrf.assign(in.for_yrf, in.for_yrf + in.n_for);
+         }
+         if(in.n_dom > 0) out.domDates.assign(in.dom_dates, in.dom_dates + in.n_dom);
+      }
+      return res;
+   }
+
+   //curve of shared memory named by a custom field, null when the field is not set
+   std::auto_ptr<libor::BootstrapCurve> namedCurve(long today, IROptions &customOpt, const char *field,
+                                                   const std::string &errMsg)
+   {
+      std::auto_ptr<libor::BootstrapCurve> curve;
+      const std::string name = upperName(customOpt.get_string(field, "").c_str());
+      if(name.empty()) return curve;
+      pdg::ZCData data;
+      if(!libor::getShmZCData(name, data)) throw pdg::Error(2, errMsg + "curve " + name + " not found");
+      return exogenousCurve(today, data);
+   }
+
+   std::string discCurveName(const pdg_curve_spec_type &spec)
+   {
+      IROptions customOpt(spec.custom_fields, spec.custom_values, spec.custom_sz);
+      return upperName(customOpt.get_string("DiscCurveName", "").c_str());
+   }
+
+   //bootstraps a curve on the in-tree solver and pushes it in shared memory, as a spread curve when it has
+   //a backbone. Nothing goes through the engine bootstrap, the curves of a batch run it in parallel.
+   void bootstrapInstruments(const char *caller, long today, long currency, const std::string &curveName,
+                             const std::string &backboneName, long n_instr, const pdg_bootstrap_instrument_type *instr,
+                             long type_interp, long interp_on, long comp, long day_count,
+                             long custom_sz, const char **custom_fields, const double *custom_values,
+                             long *out_sz, long *out_dates, double *out_vals)
+   {
+      boost::posix_time::ptime mark = boost::posix_time::microsec_clock::universal_time();
+      const std::string errMsg = std::string("#Error in ") + caller + ", ";
+      if(*out_sz < n_instr + 1) throw pdg::Error(2, errMsg + xtos(n_instr + 1) + " points needed, room for " + xtos(*out_sz));
+
+      IROptions customOpt(custom_fields, custom_values, custom_sz);
+      const bool incremental = customOpt.get("Incremental", 0.) > 0.5;
+      const bool global = customOpt.get("GlobalSolver", 0.) > 0.5;
+      const bool warmStart = customOpt.get("WarmStart", 0.) > 0.5;
+      const bool instrumented = customOpt.get("Instrumentation", 0.) > 0.5;
+
+      libor::BootstrapState state;
+      state.today = today;
+      state.typeInterp = type_interp;
+      state.interpOn = interp_on;
+      state.comp = comp;
+      state.dayCount = day_count;
+      state.instruments = unpackInstruments(n_instr, instr);
+
+      //if needed, get the exogenous discounting curve
+      std::auto_ptr<libor::BootstrapCurve> exo;
+      const std::string exoDiscName = upperName(customOpt.get_string("DiscCurveName", "").c_str());
+      if(exoDiscName.size() > 0) {
+         pdg::ZCData exo_disc_curve_data;
+         if(!libor::getShmZCData(exoDiscName, exo_disc_curve_data))
+            throw pdg::Error(2, errMsg + "curve " + exoDiscName + " not found");
+         state.exoName = exoDiscName;
+         state.exoTypeInterp = exo_disc_curve_data.typeInterp;
+         state.exoInterpOn = exo_disc_curve_data.interpOn;
+         state.exoComp = exo_disc_curve_data.comp;
+         state.exoDayCount = exo_disc_curve_data.dayCount;
+         state.exoDates = exo_disc_curve_data.dates;
+         state.exoDiscounts = exo_disc_curve_data.discounts;
+         exo = exogenousCurve(today, exo_disc_curve_data);
+      }
+
+      if(instrumented) state.timings.parse = lap(mark);
+
+      libor::BootstrapCurve curve(today, type_interp, interp_on, comp, day_count);
+      libor::BootstrapSolver solver(curve, state.instruments, exo.get());
+      solver.setTimed(instrumented);
+
+      //an incremental bootstrap keeps the pillars before the first instrument that changed
+      long first = 0;
+      libor::BootstrapState prev;
+      if(incremental && libor::BootstrapStateCache::Instance().find(curveName, prev)) {
+         first = libor::firstAffectedPillar(prev, state, curve.local() && !global);
+         for(long k = 0; k < first; ++k) curve.setDiscount(k, prev.discounts[k]);
+      }
+      //a warm start seeds each pillar with the discount of the published curve at the same date
+      pdg::ZCData published;
+      if(warmStart && first < n_instr && libor::getShmZCData(curveName, published)) {
+         std::vector<double> guesses(n_instr, 0.0);
+         for(long k = first; k < n_instr; ++k) {
+            std::vector<long>::const_iterator it = std::lower_bound(published.dates.begin(), published.dates.end(), curve.pillarDate(k));
+            if(it != published.dates.end() && *it == curve.pillarDate(k)) guesses[k] = published.discounts[it - published.dates.begin()];
+         }
+         solver.setGuesses(guesses);
+      }
+      if(instrumented) state.timings.prepare = lap(mark);
+      if(global && first < n_instr) solver.solveGlobal();
+      else solver.solve(first);
+      if(instrumented) state.timings.solve = lap(mark);
+
+      MTD(mt_ios::essential) << "[" << caller << "]" << curveName << ": pillars " << first << " to " << n_instr
+                             << " solved, " << solver.stats().iterations << " newton steps, "
+                             << solver.stats().globalIterations << " global iterations, "
+                             << solver.stats().warmStarted << " warm started" << std::endl;
+
+      state.discounts.resize(n_instr);
+      for(long k = 0; k < n_instr; ++k) state.discounts[k] = curve.pillarDiscount(k);
+      state.stats = solver.stats();
+
+      //today first, then the pillars
+      std::vector<double> out_discs(n_instr + 1, 1.0);
+      out_dates[0] = today;
+      for(long k = 0; k < n_instr; ++k) {
+         out_dates[k + 1] = curve.pillarDate(k);
+         out_discs[k + 1] = curve.pillarDiscount(k);
+      }
+      *out_sz = n_instr + 1;
+
+      long out_val_type = customOpt.get("OutputType", 0.) > 0.5 ? 1 : 0;
+      for(long i = 0; i < *out_sz; ++i) {
+         if(out_val_type == 0 || out_dates[i] <= today) {
+            out_vals[i] = out_val_type == 0 ? out_discs[i] : 0.;
+            continue;
+         }
+         pdgerr_t res = pdg_discToRateExt(out_vals + i, out_discs[i], today, out_dates[i], comp - 1, day_count);
+         if(res.code > 0) throw pdg::Error(2, res.des);
+      }
+
+      const std::string curStr = currency::handleToString(static_cast<currency_code>(currency));
+      pdgerr_t res;
+      if(backboneName.empty()) {
+         res = pdg_pushShmLiborCurveName(curStr.c_str(), curveName.c_str(), out_dates, safe_begin(out_discs),
+                                         type_interp, interp_on, comp, day_count, *out_sz);
+      }
+      else {
+         //the spread curve holds the ratio to its backbone on its own pillars
+         std::vector<double> backDiscs(*out_sz);
+         if(!shm_curve::ShmCurveStore::Instance().interpDisc(backboneName.c_str(), out_dates, *out_sz, safe_begin(backDiscs)))
+            throw pdg::Error(2, errMsg + "backbone " + backboneName + " not found");
+         for(long k = 0; k < *out_sz; ++k) out_discs[k] /= backDiscs[k];
+         res = pdg_pushShmLiborSpreadCurve(curStr.c_str(), curveName.c_str(), backboneName.c_str(), today, out_dates,
+                                           safe_begin(out_discs), type_interp, interp_on, comp, day_count, *out_sz);
+      }
+      if(res.code > 0) throw pdg::Error(2, res.des);
+
+      if(instrumented) state.timings.publish = lap(mark);
+      libor::BootstrapStateCache::Instance().store(curveName, state);
+   }
+
+   //bootstraps the curves of a batch, each task runs the whole bootstrap of its curve
+   class CurveBatch
+   {
+   public:
+      CurveBatch(long today, pdg_curve_spec_type *specs) : today_(today), specs_(specs) {}
+
+      bool bootstrap(long i, std::string &)
+      {
+         pdg_curve_spec_type &spec = specs_[i];
+         const std::string curveName = upperName(spec.curve_name);
+         bootstrapInstruments("pdg_liborCurveBatch", today_, spec.currency, curveName, upperName(spec.backbone_name),
+                              spec.n_instr, spec.instr, spec.type_interp, spec.interp_on, spec.comp, spec.day_count,
+                              spec.custom_sz, spec.custom_fields, spec.custom_values,
+                              &spec.out_sz, spec.out_dates, spec.out_vals);
+         MTD(mt_ios::essential) << "[pdg_liborCurveBatch]Published: " << curveName << std::endl;
+         return true;
+      }
+
+   private:
+      long today_;
+      pdg_curve_spec_type *specs_;
+   };
+}
+
+PDGLIB_API pdgerr_t pdg_liborCurveBatch(long today, long n_curves, pdg_curve_spec_type *specs, long n_threads,
+                                        pdgerr_t *curve_res)
+{
+   try {
+      std::vector<std::string> names(n_curves);
+      std::vector<std::vector<std::string> > deps(n_curves);
+      for(long i = 0; i < n_curves; ++i) {
+         names[i] = upperName(specs[i].curve_name);
+         if(names[i].empty()) throw pdg::Error(2, "#Error in pdg_liborCurveBatch, empty curve name");
+         const std::string exoDiscName = discCurveName(specs[i]);
+         if(exoDiscName.size() > 0) deps[i].push_back(exoDiscName);
+         const std::string backboneName = upperName(specs[i].backbone_name);
+         if(backboneName.size() > 0) deps[i].push_back(backboneName);
+      }
+
+      libor::BootstrapScheduler scheduler(names, deps);
+      CurveBatch batch(today, specs);
+      libor::BootstrapScheduler::task_type task = boost::bind(&CurveBatch::bootstrap, &batch, _1, _2);
+      if(n_threads > 0) {
+         parallel::ThreadPool pool(n_threads);
+         scheduler.run(pool, task);
+      }
+      else {
+         scheduler.run(*parallel::ThreadPool::shared(), task);
+      }
+
+      for(long i = 0; i < n_curves; ++i) {
+         if(scheduler.succeeded(i)) curve_res[i] = RES_OK;
+         else curve_res[i] = pdg::Error(2, scheduler.message(i)).getInfo();
+      }
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_liborCurveInstruments(long today, long currency, const char *curve_name, long n_instr,
+                                              const pdg_bootstrap_instrument_type *instr,
+                                              long type_interp, long interp_on, long comp, long day_count,
+                                              long custom_sz, const char **custom_fields, const double *custom_values,
+                                              long *out_sz, long *out_dates, double *out_vals)
+{
+   try {
+      const std::string curveName = upperName(curve_name);
+      if(curveName.empty()) throw pdg::Error(2, "#Error in pdg_liborCurveInstruments, empty curve name");
+      bootstrapInstruments("pdg_liborCurveInstruments", today, currency, curveName, "", n_instr, instr,
+                           type_interp, interp_on, comp, day_count, custom_sz, custom_fields, custom_values,
+                           out_sz, out_dates, out_vals);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_liborCurveInstrumentsJacobian(long today, long n_instr, const pdg_bootstrap_instrument_type *instr,
+                                                      long type_interp, long interp_on, long comp, long day_count,
+                                                      long custom_sz, const char **custom_fields, const double *custom_values,
+                                                      long *out_sz, long *out_dates, double *out_discs,
+                                                      double *jac_quotes, long *exo_sz, double *jac_exo)
+{
+   try {
+      const std::string errMsg("#Error in pdg_liborCurveInstrumentsJacobian, ");
+      if(*out_sz < n_instr + 1) throw pdg::Error(2, errMsg + xtos(n_instr + 1) + " points needed, room for " + xtos(*out_sz));
+
+      IROptions customOpt(custom_fields, custom_values, custom_sz);
+      std::vector<long> order;
+      std::vector<libor::BootstrapInstrument> instruments = unpackInstruments(n_instr, instr, &order);
+
+      std::auto_ptr<libor::BootstrapCurve> exo;
+      pdg::ZCData exo_disc_curve_data;
+      const std::string exoDiscName = upperName(customOpt.get_string("DiscCurveName", "").c_str());
+      if(exoDiscName.size() > 0) {
+         if(!libor::getShmZCData(exoDiscName, exo_disc_curve_data))
+            throw pdg::Error(2, errMsg + "curve " + exoDiscName + " not found");
+         if(jac_exo && *exo_sz < exo_disc_curve_data.get_size())
+            throw pdg::Error(2, errMsg + xtos(exo_disc_curve_data.get_size()) + " exogenous points, room for " + xtos(*exo_sz));
+         exo = exogenousCurve(today, exo_disc_curve_data);
+      }
+
+      libor::BootstrapCurve curve(today, type_interp, interp_on, comp, day_count);
+      libor::BootstrapSolver solver(curve, instruments, exo.get());
+      solver.solveGlobal();
+
+      std::vector<double> dQuote, dExo;
+      solver.jacobian(dQuote, &dExo);
+
+      //today first, its discount does not move
+      *out_sz = n_instr + 1;
+      out_dates[0] = today;
+      out_discs[0] = 1.0;
+      std::fill(jac_quotes, jac_quotes + n_instr, 0.0);
+      for(long k = 0; k < n_instr; ++k) {
+         out_dates[k + 1] = curve.pillarDate(k);
+         out_discs[k + 1] = curve.pillarDiscount(k);
+         for(long j = 0; j < n_instr; ++j) jac_quotes[(k + 1) * n_instr + order[j]] = dQuote[k * n_instr + j];
+      }
+
+      //the points of the exogenous curve up to today are not pillars, their columns are zero
+      const long m = exo_disc_curve_data.get_size();
+      *exo_sz = m;
+      if(jac_exo && m) {
+         std::fill(jac_exo, jac_exo + (n_instr + 1) * m, 0.0);
+         const long skipped = m - (exo.get() ? exo->size() : 0);
+         for(long k = 0; k < n_instr; ++k)
+            for(long j = skipped; j < m; ++j) jac_exo[(k + 1) * m + j] = dExo[k * (m - skipped) + j - skipped];
+      }
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_liborDeltaLadder(long n_grad, const char **curve_names, const long *grad_sz, const double **grads,
+                                         long n_out, const char **out_names, long sz_deltas, double *out_deltas,
+                                         long *out_sz)
+{
+   try {
+      libor::DeltaLadder ladder;
+      for(long i = 0; i < n_grad; ++i) ladder.add(upperName(curve_names[i]), grads[i], grad_sz[i]);
+      ladder.solve();
+
+      std::fill(out_deltas, out_deltas + n_out * sz_deltas, 0.0);
+      for(long i = 0; i < n_out; ++i) {
+         const std::vector<double> &deltas = ladder.quoteDeltas(upperName(out_names[i]));
+         out_sz[i] = static_cast<long>(deltas.size());
+         std::copy(deltas.begin(), deltas.begin() + std::min(sz_deltas, out_sz[i]), out_deltas + i * sz_deltas);
+      }
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_liborCurveSolverStats(const char *curve_name, pdg_bootstrap_stats_type *stats)
+{
+   try {
+      libor::BootstrapState state;
+      if(!libor::BootstrapStateCache::Instance().find(upperName(curve_name), state))
+         throw pdg::Error(2, std::string("#Error in pdg_liborCurveSolverStats, no bootstrap of curve ") + curve_name);
+
+      const libor::BootstrapStats &s = state.stats;
+      stats->first_solved = s.firstSolved;
+      stats->passes = s.passes;
+      stats->iterations = s.iterations;
+      stats->global_iterations = s.globalIterations;
+      stats->warm_started = s.warmStarted;
+      stats->max_residual = s.maxResidual;
+      stats->global_seconds = s.globalSeconds;
+      stats->parse_seconds = state.timings.parse;
+      stats->prepare_seconds = state.timings.prepare;
+      stats->solve_seconds = state.timings.solve;
+      stats->publish_seconds = state.timings.publish;
+
+      //the arrays are optional, the pillars kept by an incremental bootstrap have no timing nor iteration
+      const long n = static_cast<long>(state.instruments.size());
+      const long sz = std::min(stats->sz, n);
+      for(long k = 0; k < sz; ++k) {
+         if(stats->pillar_dates) stats->pillar_dates[k] = state.instruments[k].end;
+         if(stats->pillar_iterations) stats->pillar_iterations[k] = k < static_cast<long>(s.pillarIterations.size()) ? s.pillarIterations[k] : 0;
+         if(stats->pillar_residuals) stats->pillar_residuals[k] = k < static_cast<long>(s.pillarResiduals.size()) ? s.pillarResiduals[k] : 0.;
+         if(stats->pillar_seconds) stats->pillar_seconds[k] = k < static_cast<long>(s.pillarSeconds.size()) ? s.pillarSeconds[k] : 0.;
+      }
+      stats->sz = n;
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_liborCurveScenarioBatch(long today, long n_instr, const pdg_bootstrap_instrument_type *instr,
+                                                long type_interp, long interp_on, long comp, long day_count,
+                                                long custom_sz, const char **custom_fields, const double *custom_values,
+                                                long n_scen, const double *quotes, long n_threads,
+                                                long *out_sz, long *out_dates, double *out_discs)
+{
+   try {
+      const std::string errMsg("#Error in pdg_liborCurveScenarioBatch, ");
+      if(*out_sz < n_instr + 1) throw pdg::Error(2, errMsg + xtos(n_instr + 1) + " points needed, room for " + xtos(*out_sz));
+      if(n_scen < 0) throw pdg::Error(2, errMsg + "negative number of scenarios");
+
+      IROptions customOpt(custom_fields, custom_values, custom_sz);
+      std::vector<long> order;
+      std::vector<libor::BootstrapInstrument> instruments = unpackInstruments(n_instr, instr, &order);
+
+      std::auto_ptr<libor::BootstrapCurve> exo;
+      const std::string exoDiscName = upperName(customOpt.get_string("DiscCurveName", "").c_str());
+      if(exoDiscName.size() > 0) {
+         pdg::ZCData exo_disc_curve_data;
+         if(!libor::getShmZCData(exoDiscName, exo_disc_curve_data))
+            throw pdg::Error(2, errMsg + "curve " + exoDiscName + " not found");
+         exo = exogenousCurve(today, exo_disc_curve_data);
+      }
+
+      libor::BootstrapCurve curve(today, type_interp, interp_on, comp, day_count);
+      libor::BootstrapScenarios scenarios(curve, instruments, exo.get());
+
+      //quotes in the order of the sorted instruments
+      std::vector<double> sorted(n_scen * n_instr), discs(n_scen * n_instr);
+      for(long s = 0; s < n_scen; ++s)
+         for(long j = 0; j < n_instr; ++j) sorted[s * n_instr + j] = quotes[s * n_instr + order[j]];
+      if(n_scen > 0) {
+         if(n_threads > 0) {
+            parallel::ThreadPool pool(n_threads);
+            scenarios.solve(n_scen, &sorted[0], &discs[0], pool);
+         }
+         else {
+            scenarios.solve(n_scen, &sorted[0], &discs[0], *parallel::ThreadPool::shared());
+         }
+      }
+
+      //today first, then the pillars
+      *out_sz = n_instr + 1;
+      out_dates[0] = today;
+      for(long k = 0; k < n_instr; ++k) out_dates[k + 1] = scenarios.curve().pillarDate(k);
+      for(long s = 0; s < n_scen; ++s) {
+         out_discs[s * (n_instr + 1)] = 1.0;
+         for(long k = 0; k < n_instr; ++k) out_discs[s * (n_instr + 1) + k + 1] = discs[s * n_instr + k];
+      }
+
+      MTD(mt_ios::essential) << "[pdg_liborCurveScenarioBatch] " << n_scen << " scenarios of " << n_instr
+                             << " instruments solved" << std::endl;
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_crossCurrencyBasisCurveInstruments(long today, long for_currency, const char *curve_name,
+                                                           double spot_fx_dom2for, long n_instr,
+                                                           const pdg_xccy_instrument_type *instr,
+                                                           long type_interp, long interp_on, long comp, long day_count,
+                                                           long custom_sz, const char **custom_fields, const double *custom_values,
+                                                           long *out_sz, long *out_dates, double *out_vals)
+{
+   try {
+      const std::string errMsg("#Error in pdg_crossCurrencyBasisCurveInstruments, ");
+      const std::string curveName = upperName(curve_name);
+      if(curveName.empty()) throw pdg::Error(2, errMsg + "empty curve name");
+      if(*out_sz < n_instr + 1) throw pdg::Error(2, errMsg + xtos(n_instr + 1) + " points needed, room for " + xtos(*out_sz));
+
+      IROptions customOpt(custom_fields, custom_values, custom_sz);
+      std::auto_ptr<libor::BootstrapCurve> domDisc = namedCurve(today, customOpt, "DomDiscCurveName", errMsg);
+      std::auto_ptr<libor::BootstrapCurve> domFwd = namedCurve(today, customOpt, "DomFwdCurveName", errMsg);
+      std::auto_ptr<libor::BootstrapCurve> forFwd = namedCurve(today, customOpt, "ForFwdCurveName", errMsg);
+
+      libor::CrossCurrencyMarket market;
+      market.spot = spot_fx_dom2for;
+      market.pointsScale = customOpt.get("FxPointsScale", 1.e-4);
+      market.domDisc = domDisc.get();
+      market.domFwd = domFwd.get();
+      market.forFwd = forFwd.get();
+      std::vector<libor::BootstrapInstrument> instruments =
+         libor::crossCurrencyInstruments(unpackCrossCurrency(n_instr, instr), market, *parallel::ThreadPool::shared());
+
+      libor::BootstrapCurve curve(today, type_interp, interp_on, comp, day_count);
+      libor::BootstrapSolver solver(curve, instruments);
+      if(customOpt.get("GlobalSolver", 0.) > 0.5) solver.solveGlobal();
+      else solver.solve();
+
+      //today first, then the pillars
+      std::vector<double> out_discs(n_instr + 1, 1.0);
+      out_dates[0] = today;
+      for(long k = 0; k < n_instr; ++k) {
+         out_dates[k + 1] = curve.pillarDate(k);
+         out_discs[k + 1] = curve.pillarDiscount(k);
+      }
+      *out_sz = n_instr + 1;
+
+      long out_val_type = customOpt.get("OutputType", 0.) > 0.5 ? 1 : 0;
+      for(long i = 0; i < *out_sz; ++i) {
+         if(out_val_type == 0 || out_dates[i] <= today) {
+            out_vals[i] = out_val_type == 0 ? out_discs[i] : 0.;
+            continue;
+         }
+         pdgerr_t res = pdg_discToRateExt(out_vals + i, out_discs[i], today, out_dates[i], comp - 1, day_count);
+         if(res.code > 0) throw pdg::Error(2, res.des);
+      }
+
+      const std::string curStr = currency::handleToString(static_cast<currency_code>(for_currency));
+      pdgerr_t res = pdg_pushShmLiborCurveName(curStr.c_str(), curveName.c_str(), out_dates, safe_begin(out_discs),
+                                               type_interp, interp_on, comp, day_count, *out_sz);
+      if(res.code > 0) throw pdg::Error(2, res.des);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
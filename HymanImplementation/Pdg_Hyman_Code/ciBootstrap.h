@@ -0,0 +1,166 @@
+//ciBootstrap.h
+#ifndef _CIBOOTSTRAP_H__
+#define _CIBOOTSTRAP_H__
+
+#include "pdgapi.h"
+#include "ciError.h"
+
+#ifdef __cplusplus
+extern "C" {     /* Begin C Interface wrapping */
+#endif
+
+// Instrument with its schedule already generated, for pdg_liborCurveInstruments.
+// Rates are in natural units, futures are quoted as a price (0.99 for a 1% rate).
+typedef struct pdg_bootstrap_instrument {
+   long type;                 // 1 deposit, 2 fra, 3 future, 4 swap
+   double quote;
+   long start_date;
+   long end_date;             // pillar of the instrument
+   double yrf;                // accrual of a deposit, fra or future
+   long n_fixed;              // swap fixed leg: payment dates and accruals
+   const long *fixed_dates;
+   const double *fixed_yrf;
+   long n_float;              // swap floating leg: ends of the periods, the first one starts at start_date
+   const long *float_dates;
+} pdg_bootstrap_instrument_type;
+
+// Bootstraps a curve on instruments with explicit schedules and pushes it in shared memory.
+// Each instrument gives a pillar at its end date; type_interp can be linear, constant or spline.
+// The custom field DiscCurveName gives the discounting curve of the swaps, OutputType=1 returns
+// zero rates instead of discounts. With Incremental=1 the solved pillars are kept from one call
+// to the next and only the pillars from the first instrument that changed on are solved again
+// (all of them with the spline). WarmStart=1 starts the solver of each pillar from the discount
+// of the curve currently published under curve_name at the same date (from the default guess for
+// the pillars whose date is not in the published curve). GlobalSolver=1 solves all the pillars at
+// once with Newton-Raphson, which is consistent and much faster than the repeated sequential
+// passes with the spline. Instrumentation=1 times the phases of the call and the solve of each
+// pillar, see pdg_liborCurveSolverStats. out_sz holds on input the room in out_dates and out_vals, on
+// output the number of points: today followed by the pillars.
+PDGLIB_API pdgerr_t pdg_liborCurveInstruments(long today, long currency, const char *curve_name, long n_instr,
+                                              const pdg_bootstrap_instrument_type *instr,
+                                              long type_interp, long interp_on, long comp, long day_count,
+                                              long custom_sz, const char **custom_fields, const double *custom_values,
+                                              long *out_sz, long *out_dates, double *out_vals);
+
+// One curve of a batch: the arguments of pdg_liborCurveInstruments. A curve with a backbone_name
+// (empty or NULL for outright curves) is published as a spread curve over its backbone.
+// out_sz holds on input the room in out_dates and out_vals, on output the number of points.
+typedef struct pdg_curve_spec {
+   long currency;
+   const char *curve_name;
+   const char *backbone_name;
+   long n_instr;
+   const pdg_bootstrap_instrument_type *instr;
+   long type_interp;
+   long interp_on;
+   long comp;
+   long day_count;
+   long custom_sz;
+   const char **custom_fields;
+   const double *custom_values;
+   long out_sz;
+   long *out_dates;
+   double *out_vals;
+} pdg_curve_spec_type;
+
+// Bootstraps a set of curves as pdg_liborCurveInstruments does and pushes each of them in shared
+// memory as soon as it is ready. A curve waits for the curves of the batch it reads from shared
+// memory (its DiscCurveName and its backbone), independent curves are bootstrapped in parallel on
+// n_threads threads (0 uses the library pool). curve_res receives the outcome of every curve: a curve
+// whose dependency failed is not bootstrapped. The call fails only on an inconsistent batch
+// (duplicated names, circular dependencies), the failures of single curves are reported in curve_res.
+PDGLIB_API pdgerr_t pdg_liborCurveBatch(long today, long n_curves, pdg_curve_spec_type *specs, long n_threads,
+                                        pdgerr_t *curve_res);
+
+// Solver statistics of the last bootstrap of a curve by pdg_liborCurveInstruments. The timings are
+// filled when the bootstrap was called with the custom field Instrumentation=1, zero otherwise.
+typedef struct pdg_bootstrap_stats {
+   long first_solved;         // first pillar solved, the ones before were kept by an incremental bootstrap
+   long passes;               // sequential passes over the pillars
+   long iterations;           // newton steps of the pillar solvers
+   long global_iterations;    // newton steps of the global solver
+   long warm_started;         // pillars started from the published curve
+   double max_residual;       // largest residual on a quote
+   double parse_seconds;      // phases of the call: instruments and options ...
+   double prepare_seconds;    // ... exogenous curve and instrument times ...
+   double solve_seconds;
+   double publish_seconds;    // ... output and push in shared memory
+   double global_seconds;     // part of solve_seconds spent in the global newton steps
+   long sz;                   // on input the room in the arrays, on output the number of instruments
+   long *pillar_dates;        // per instrument, in pillar order, each array may be NULL
+   long *pillar_iterations;
+   double *pillar_residuals;
+   double *pillar_seconds;
+} pdg_bootstrap_stats_type;
+
+PDGLIB_API pdgerr_t pdg_liborCurveSolverStats(const char *curve_name, pdg_bootstrap_stats_type *stats);
+
+// Same bootstrap as pdg_liborCurveInstruments (without pushing the curve) and the jacobian of the
+// discounts, from the implicit function theorem at the solved curve. jac_quotes is row major
+// out_sz x n_instr: row i holds the derivatives of the discount at out_dates[i] with respect to the
+// quotes of the instruments, in the order of instr. When DiscCurveName is set, jac_exo (out_sz x
+// exo_sz, may be NULL) holds the derivatives with respect to the discounts of the exogenous curve,
+// exo_sz is on input the room for its points and on output their number.
+PDGLIB_API pdgerr_t pdg_liborCurveInstrumentsJacobian(long today, long n_instr, const pdg_bootstrap_instrument_type *instr,
+                                                      long type_interp, long interp_on, long comp, long day_count,
+                                                      long custom_sz, const char **custom_fields, const double *custom_values,
+                                                      long *out_sz, long *out_dates, double *out_discs,
+                                                      double *jac_quotes, long *exo_sz, double *jac_exo);
+
+// Par quote delta ladder of curves bootstrapped by pdg_liborCurveInstruments. grads[i] (grad_sz[i] points)
+// holds the derivatives of a value with respect to the discounts of curve_names[i] at today and its
+// pillars (out_dates of pdg_liborCurveInstruments, the pillars of pdg_shmSwapPortfolioNPVAdjoint); the
+// derivatives given for the same curve are added. Each curve is carried to its quotes by one solve with
+// the transposed jacobian of its last bootstrap, and the derivatives with respect to its DiscCurveName
+// curve are passed down to that curve. Row i of out_deltas (row major n_out x sz_deltas) holds the deltas
+// of out_names[i] to the quotes of its instruments in the order of its pillars, out_sz[i] is their number
+// (0 for a curve without a bootstrap).
+PDGLIB_API pdgerr_t pdg_liborDeltaLadder(long n_grad, const char **curve_names, const long *grad_sz, const double **grads,
+                                         long n_out, const char **out_names, long sz_deltas, double *out_deltas,
+                                         long *out_sz);
+
+// Bootstraps the curve of the instruments under n_scen sets of quotes, for historical scenarios:
+// quotes[s * n_instr + j] is the quote of instr[j] in scenario s (the quote field of instr is not
+// used). Times, accruals and the exogenous discounts (DiscCurveName) are computed once, the
+// scenarios are solved in parallel on n_threads threads (the library pool if n_threads <= 0).
+// out_dates receives today and the pillars, out_sz points, and out_discs the discounts, row major
+// n_scen x out_sz. Nothing is pushed in shared memory.
+PDGLIB_API pdgerr_t pdg_liborCurveScenarioBatch(long today, long n_instr, const pdg_bootstrap_instrument_type *instr,
+                                                long type_interp, long interp_on, long comp, long day_count,
+                                                long custom_sz, const char **custom_fields, const double *custom_values,
+                                                long n_scen, const double *quotes, long n_threads,
+                                                long *out_sz, long *out_dates, double *out_discs);
+
+// Instrument of a cross currency basis curve, for pdg_crossCurrencyBasisCurveInstruments.
+typedef struct pdg_xccy_instrument {
+   long type;                 // 1 foreign deposit, 2 fx swap, 3 cross currency basis swap
+   double quote;              // rate, fx swap points, spread on the foreign leg
+   long start_date;           // the spot date for an fx swap
+   long end_date;             // pillar of the instrument
+   double yrf;                // accrual of a deposit or an fx swap on the basis curve
+   long n_for;                // basis swap foreign leg: ends of the floating periods and accruals
+   const long *for_dates;
+   const double *for_yrf;
+   long n_dom;                // basis swap domestic leg: ends of the floating periods
+   const long *dom_dates;
+} pdg_xccy_instrument_type;
+
+// Bootstraps the cross currency basis curve (foreign cash flows, domestic collateral) on instruments
+// with explicit schedules and pushes it in shared memory under for_currency. spot_fx_dom2for is the
+// number of foreign units for one domestic unit at the start of the fx swaps. The custom fields
+// DomDiscCurveName, DomFwdCurveName (DomDiscCurveName by default) and ForFwdCurveName give the curves
+// read from shared memory, FxPointsScale the unit of the fx swap points (1e-4 by default); OutputType
+// and GlobalSolver work as in pdg_liborCurveInstruments. The fx swaps and the domestic legs are
+// priced on the domestic curves while the foreign fixings are projected, both before the bootstrap.
+PDGLIB_API pdgerr_t pdg_crossCurrencyBasisCurveInstruments(long today, long for_currency, const char *curve_name,
+                                                           double spot_fx_dom2for, long n_instr,
+                                                           const pdg_xccy_instrument_type *instr,
+                                                           long type_interp, long interp_on, long comp, long day_count,
+                                                           long custom_sz, const char **custom_fields, const double *custom_values,
+                                                           long *out_sz, long *out_dates, double *out_vals);
+
+#ifdef __cplusplus
+}     /* End C Interface wrapping */
+#endif
+
+#endif //_CIBOOTSTRAP_H__
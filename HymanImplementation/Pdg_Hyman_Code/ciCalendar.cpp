@@ -0,0 +1,96 @@
+//ciCalendar.cpp
+#include <vector>
+#include "ciCalendar.h"
+#include "cCompiledCalendar.h"
+#include "cError.h"
+#include "xtos.h"
+
+using namespace libor;
+
+PDGLIB_API pdgerr_t pdg_calendarCompile(long calendar_id, long first_date, long last_date, long weekend_mask,
+                                        long n_hol, const long *holidays)
+{
+   try {
+      if(n_hol < 0) throw pdg::Error(2, "#Error in pdg_calendarCompile, negative number of holidays");
+      std::vector<long> hol(holidays, holidays + n_hol);
+      boost::shared_ptr<const CompiledCalendar> calendar(new CompiledCalendar(first_date, last_date, hol, weekend_mask));
+      CompiledCalendars::Instance().store(calendar_id, calendar);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_calendarJoint(long n, const long *calendar_ids, long joint_id)
+{
+   try {
+      if(n < 1) throw pdg::Error(2, "#Error in pdg_calendarJoint, no calendar");
+      CompiledCalendars &calendars = CompiledCalendars::Instance();
+      boost::shared_ptr<const CompiledCalendar> joint = calendars.find(calendar_ids[0]);
+      for(long i = 1; i < n; ++i)
+         joint.reset(new CompiledCalendar(CompiledCalendar::joint(*joint, *calendars.find(calendar_ids[i]))));
+      calendars.store(joint_id, joint);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_calendarAddBusinessDays(long calendar_id, long n, const long *dates, long shift, long *out_dates)
+{
+   try {
+      boost::shared_ptr<const CompiledCalendar> calendar = CompiledCalendars::Instance().find(calendar_id);
+      for(long i = 0; i < n; ++i) out_dates[i] = calendar->addBusinessDays(dates[i], shift);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_calendarAdjust(long calendar_id, long n, const long *dates, long rule, long *out_dates)
+{
+   try {
+      boost::shared_ptr<const CompiledCalendar> calendar = CompiledCalendars::Instance().find(calendar_id);
+      for(long i = 0; i < n; ++i) out_dates[i] = calendar->adjust(dates[i], rule);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_calendarCountBusinessDays(long calendar_id, long n, const long *starts, const long *ends,
+                                                  long *out_count)
+{
+   try {
+      boost::shared_ptr<const CompiledCalendar> calendar = CompiledCalendars::Instance().find(calendar_id);
+      for(long i = 0; i < n; ++i) out_count[i] = calendar->countBusinessDays(starts[i], ends[i]);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
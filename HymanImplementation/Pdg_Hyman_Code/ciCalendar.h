@@ -0,0 +1,36 @@
+//ciCalendar.h
+#ifndef _CICALENDAR_H__
+#define _CICALENDAR_H__
+
+#include "pdgapi.h"
+#include "ciError.h"
+
+#ifdef __cplusplus
+extern "C" {     /* Begin C Interface wrapping */
+#endif
+
+// Compiles the business days of [first_date, last_date] under calendar_id, replacing a calendar
+// compiled before with the same id. A day is a business day when it is neither one of the n_hol
+// holidays nor a weekend day: bit d of weekend_mask is day d of the week, Sunday first
+// (65 for Saturday and Sunday).
+PDGLIB_API pdgerr_t pdg_calendarCompile(long calendar_id, long first_date, long last_date, long weekend_mask,
+                                        long n_hol, const long *holidays);
+
+// Compiles under joint_id the business days common to n calendars, over their common range
+PDGLIB_API pdgerr_t pdg_calendarJoint(long n, const long *calendar_ids, long joint_id);
+
+// n-th business day after each date (before it when shift < 0, the following business day when shift = 0)
+PDGLIB_API pdgerr_t pdg_calendarAddBusinessDays(long calendar_id, long n, const long *dates, long shift, long *out_dates);
+
+// Adjusted dates: rule is 0 none, 1 following, 2 modified following, 3 preceding, 4 modified preceding
+PDGLIB_API pdgerr_t pdg_calendarAdjust(long calendar_id, long n, const long *dates, long rule, long *out_dates);
+
+// Business days in (starts[i], ends[i]], negative when the end is before the start
+PDGLIB_API pdgerr_t pdg_calendarCountBusinessDays(long calendar_id, long n, const long *starts, const long *ends,
+                                                  long *out_count);
+
+#ifdef __cplusplus
+}     /* End C Interface wrapping */
+#endif
+
+#endif //_CICALENDAR_H__
@@ -0,0 +1,77 @@
+//ciDayCount.cpp
+#include "ciDayCount.h"
+#include "ciLibor.h"
+#include "eDayCountBulk.h"
+#include "cError.h"
+
+namespace {
+   //the kernels cover simple, annual and continuous compounding (comp 0 to 2 of pdg_discToRateExt)
+   //on a day count with a kernel, the rest goes through the scalar conversions
+   bool bulkConversion(long comp, long day_count)
+   {
+      return comp >= 0 && comp <= 2 && daycount::basisOf(day_count) != daycount::dbNone;
+   }
+}
+
+PDGLIB_API pdgerr_t pdg_yrfDayCountBulk(long n, const long *start_dates, long start_date, const long *end_dates,
+                                        long day_count, double *out_yrf)
+{
+   try {
+      if(start_dates) daycount::yearFractions(day_count, n, start_dates, end_dates, out_yrf);
+      else daycount::yearFractions(day_count, start_date, n, end_dates, out_yrf);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_discToRateBulk(long n, const long *start_dates, const long *end_dates, const double *discs,
+                                       long comp, long day_count, double *out_rates)
+{
+   try {
+      if(bulkConversion(comp, day_count)) {
+         daycount::discountsToRates(day_count, comp + 1, n, start_dates, end_dates, discs, out_rates);
+         return RES_OK;
+      }
+      for(long i = 0; i < n; ++i) {
+         pdgerr_t res = pdg_discToRateExt(out_rates + i, discs[i], start_dates[i], end_dates[i], comp, day_count);
+         if(res.code) return res;
+      }
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_rateToDiscBulk(long n, const long *start_dates, const long *end_dates, const double *rates,
+                                       long comp, long day_count, double *out_discs)
+{
+   try {
+      if(bulkConversion(comp, day_count)) {
+         daycount::ratesToDiscounts(day_count, comp + 1, n, start_dates, end_dates, rates, out_discs);
+         return RES_OK;
+      }
+      for(long i = 0; i < n; ++i) {
+         pdgerr_t res = pdg_rateToDiscExt(rates[i], out_discs + i, start_dates[i], end_dates[i], comp, day_count);
+         if(res.code) return res;
+      }
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
@@ -0,0 +1,31 @@
+//ciDayCount.h
+#ifndef _CIDAYCOUNT_H__
+#define _CIDAYCOUNT_H__
+
+#include "pdgapi.h"
+#include "ciError.h"
+
+#ifdef __cplusplus
+extern "C" {     /* Begin C Interface wrapping */
+#endif
+
+// Same as pdg_yrfDayCount over arrays: out_yrf[i] is the year fraction from start_dates[i] to
+// end_dates[i]. When start_dates is NULL the year fractions are from start_date. The day counts
+// 4 (ACT/360) and 5 (ACT/365) are computed in bulk, the others by pdg_yrfDayCount one date at a time.
+PDGLIB_API pdgerr_t pdg_yrfDayCountBulk(long n, const long *start_dates, long start_date, const long *end_dates,
+                                        long day_count, double *out_yrf);
+
+// Same as pdg_discToRateExt and pdg_rateToDiscExt over arrays, the year fractions and the conversions
+// in one pass. The input and output arrays may be the same. With a bulk kernel the rate over a null
+// period is 0.
+PDGLIB_API pdgerr_t pdg_discToRateBulk(long n, const long *start_dates, const long *end_dates, const double *discs,
+                                       long comp, long day_count, double *out_rates);
+
+PDGLIB_API pdgerr_t pdg_rateToDiscBulk(long n, const long *start_dates, const long *end_dates, const double *rates,
+                                       long comp, long day_count, double *out_discs);
+
+#ifdef __cplusplus
+}     /* End C Interface wrapping */
+#endif
+
+#endif //_CIDAYCOUNT_H__
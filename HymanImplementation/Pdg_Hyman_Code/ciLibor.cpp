@@ -17,9 +17,18 @@
 #include "eForwardingCurve.h"
 #include "cRTDebugger.h"
 #include "rateBootstrapUtils.h"
+#include "cShmCurveStore.h"
+#include "cCurveRegistry.h"
+#include "cScheduleCache.h"
+#include "ciShmCurve.h"
+#include "eDayCountBulk.h"
+#include "rateForwardStrip.h"
+#include "cCompiledCalendar.h"
 #include <boost/thread.hpp>
+#include <boost/bind.hpp>
 #include "boost/thread/mutex.hpp"
 
+#include <map>
 #include <vector>
 #include "matrix.h"
 #include "cError.h"
@@ -184,12 +193,21 @@ pdgerr_t pdg_liborStringToHandle(const char *mktName, long *pVal)
    try {
       MTD(mt_ios::essential) << "[pdg_liborStringToHandle]LiborName: " << mktName << std::endl;
 
-      std::string uMktName(mktName);
-      std::transform(uMktName.begin(),uMktName.end(), uMktName.begin(), toupper);
-      if (!uMktName.size()) throw pdg::Error(2, "Invalid libor name.");
+      if (!mktName || !*mktName) throw pdg::Error(2, "Invalid libor name.");
 
-      if (!libor_client::Instance().isCurvePresentByName(uMktName)) throw pdg::Error(2, "Curve (" + uMktName + ") is not present in shared memory.");
-      *pVal = libor_client::Instance().getHandleByName<ShmLibor<> >(uMktName);
+      // the presence is checked on every call (the curve may have been removed by another process),
+      // the handle is looked up once per name, until the curve is cleared
+      shm_curve::CurveRegistry &registry = shm_curve::CurveRegistry::Instance();
+      std::string uMktName(shm_curve::CurveRegistry::canonicalName(mktName));
+      if (!libor_client::Instance().isCurvePresentByName(uMktName)) {
+         registry.setLiborHandle(mktName, -1);
+         throw pdg::Error(2, "Curve (" + uMktName + ") is not present in shared memory.");
+      }
+      *pVal = registry.liborHandle(mktName);
+      if (*pVal < 0) {
+         *pVal = libor_client::Instance().getHandleByName<ShmLibor<> >(uMktName);
+         registry.setLiborHandle(mktName, *pVal);
+      }
 
       MTD(mt_ios::essential) << "[pdg_liborStringToHandle]Output: " << *pVal << std::endl;
    }
@@ -819,6 +837,8 @@ pdgerr_t pdg_clearShmCurveName(const char *liborName)
 {
    try {
       libor_client::Instance().getCurveByName<ShmLibor<> >(liborName).clearCurve();
+      shm_curve::ShmCurveStore::Instance().remove(liborName);
+      shm_curve::CurveRegistry::Instance().invalidate(liborName);
    }
    catch(pdg::Error e) {
       return e.getInfo();
@@ -854,11 +874,22 @@ pdgerr_t pdg_shmInterpRate(long hLibor, long comp, long day_count, long out_sz,
       libor_client::Instance().getCurveByHandle<ShmLibor<> >(hLibor).updateTermStructure();
 
       Date dateStart(libor_client::Instance().getCalcDateByHandle(hLibor).getExcelDate());
-      double disc;
+      if(out_sz <= 0) return RES_OK;
+      std::vector<double> disc(out_sz);
       long i;
-      for(i = 0; i < out_sz; ++i) {
-         disc = libor_client::Instance().getValueByHandle(hLibor, Date(out_date[i]));
-         out_rate[i] = libor::discToRateExt(disc, dateStart, out_date[i], comp, day_count);
+      for(i = 0; i < out_sz; ++i) disc[i] = libor_client::Instance().getValueByHandle(hLibor, Date(out_date[i]));
+
+      //the year fractions and the conversions in bulk when a kernel covers the conventions
+      if(comp >= 0 && comp <= 2 && daycount::basisOf(day_count) != daycount::dbNone) {
+         const long today = dateStart.getExcelDate();
+         std::vector<long> start(out_sz, today);
+         daycount::discountsToRates(day_count, comp + 1, out_sz, &start[0], out_date, &disc[0], out_rate);
+         //null periods keep the engine convention
+         for(i = 0; i < out_sz; ++i)
+            if(out_date[i] == today) out_rate[i] = libor::discToRateExt(disc[i], dateStart, out_date[i], comp, day_count);
+      }
+      else {
+         for(i = 0; i < out_sz; ++i) out_rate[i] = libor::discToRateExt(disc[i], dateStart, out_date[i], comp, day_count);
       }
    }
    catch(pdg::Error e) {
@@ -898,11 +929,13 @@ pdgerr_t pdg_shmInterpRateFwd(long hLibor, long fwd_date, long comp, long day_co
 pdgerr_t pdg_shmInterpDiscName(const char *libor_name, long out_sz, long *out_date, double *out_disc)
 {
    try {
-      std::string name(libor_name);
-      libor_client::Instance().getCurveByName<ShmLibor<> >(name).updateTermStructure();
+      long hLibor;
+      pdgerr_t res = pdg_liborStringToHandle(libor_name, &hLibor);
+      if (res.code) throw pdg::Error(res);
+      libor_client::Instance().getCurveByHandle<ShmLibor<> >(hLibor).updateTermStructure();
 
       long i;
-      for(i = 0; i < out_sz; ++i) out_disc[i] = libor_client::Instance().getValueByName(name, Date(out_date[i]));
+      for(i = 0; i < out_sz; ++i) out_disc[i] = libor_client::Instance().getValueByHandle(hLibor, Date(out_date[i]));
    }
    catch(pdg::Error e) {
       return e.getInfo();
@@ -972,6 +1005,62 @@ pdgerr_t pdg_shmToday(long hLibor, long *pVal)
    return RES_OK;
 }
 
+namespace {
+   //discounts of a libor curve on the distinct dates of a strip, from the libor client as pdg_shmFwRate
+   //reads them: the forwards are those of pdg_shmFwRate on the same periods
+   void liborDiscounts(long hLibor, long, const long *dates, long n, double *out)
+   {
+      for(long i = 0; i < n; ++i) out[i] = libor_client::Instance().getValueByHandle(hLibor, Date(dates[i]));
+   }
+
+   //calendars of the currencies compiled from the engine's BusinessDay, by calendar code
+   struct CurrencyCalendars {
+      boost::mutex mutex;
+      std::map<long, boost::shared_ptr<const libor::CompiledCalendar> > calendars;
+   };
+
+   CurrencyCalendars &currencyCalendars()
+   {
+      static CurrencyCalendars res;
+      return res;
+   }
+
+   //Compiled calendar of the currency covering [first, last], compiled again over a wider range when it
+   //does not. The engine gives no list of holidays: the calendar is compiled by stepping its BusinessDay
+   //from one business day to the next, about 260 steps a year of the range, a year of margin on both
+   //sides included. This is paid by the first strip of a currency and by a strip reaching out of the
+   //compiled range, the later strips share the cached calendar.
+   boost::shared_ptr<const libor::CompiledCalendar> currencyCalendar(currency_code curID, long first, long last)
+   {
+      const long code = static_cast<long>(convManager::Instance()[curID].getCalendarCode());
+      CurrencyCalendars &cc = currencyCalendars();
+      boost::mutex::scoped_lock lock(cc.mutex);
+      boost::shared_ptr<const libor::CompiledCalendar> &res = cc.calendars[code];
+      if(res && res->first() <= first && res->last() >= last) return res;
+
+      //a year of margin on both sides, so that the next strips find it compiled
+      if(res) {
+         first = std::min(first, res->first());
+         last = std::max(last, res->last());
+      }
+      first = std::max(1L, first - 366);
+      last += 366;
+      //business day after business day: the dates in between are holidays
+      std::vector<long> holidays;
+      long date = first - 7;
+      while(date <= last) {
+         BusinessDay next(convManager::Instance()[curID].getCalendarCode(), date);
+         next += 1;
+         const long nextDate = static_cast<long>(next.getExcelDate());
+         if(nextDate <= date) throw pdg::Error(2, "#Error in pdg_shmImplRatesStrip, the calendar of the currency does not move forward");
+         for(long d = std::max(date + 1, first); d < nextDate && d <= last; ++d) holidays.push_back(d);
+         date = nextDate;
+      }
+      res.reset(new libor::CompiledCalendar(first, last, holidays, 0));
+      return res;
+   }
+}
+
 pdgerr_t pdg_shmImplRates(long hLibor, long nDateFixing, long *dateFixing, long periodMonths,
                                      long lagFixing, long modFollowing, long dayCount,pdg_impl_rates_type *out_disc)
 {
@@ -990,6 +1079,45 @@ pdgerr_t pdg_shmImplRates(long hLibor, long nDateFixing, long *dateFixing, long
    return RES_OK;
 }
 
+PDGLIB_API pdgerr_t pdg_shmImplRatesStrip(long hLibor, long nDateFixing, long *dateFixing, long periodMonths,
+                                          long lagFixing, long modFollowing, long dayCount, long *start_dates,
+                                          long *end_dates, double *accruals, double *rates)
+{
+   try {
+      ShmLibor<>& curve = libor_client::Instance().getCurveByHandle<ShmLibor<> >(hLibor);
+      curve.updateTermStructure();
+      currency_code curID = curve.getCurrency();
+
+      libor::FixingConventions conv;
+      conv.periodMonths = periodMonths;
+      conv.lag = lagFixing;
+      conv.adjust = modFollowing ? libor::bdModFollowing : libor::bdFollowing;
+      conv.dayCount = dayCount;
+      //the periods on the calendar of the currency, as the engine's BusinessDay moves: the lag at most
+      //doubled by the holidays, the end of a period at most a week after its roll
+      if(nDateFixing <= 0) return RES_OK;
+      const long first = *std::min_element(dateFixing, dateFixing + nDateFixing) - 2 * labs(lagFixing) - 7;
+      const long last = *std::max_element(dateFixing, dateFixing + nDateFixing) + 2 * labs(lagFixing) + 31 * periodMonths + 7;
+      boost::shared_ptr<const libor::CompiledCalendar> calendar = currencyCalendar(curID, first, last);
+      libor::ForwardStrip strip(std::vector<long>(dateFixing, dateFixing + nDateFixing), conv, calendar.get());
+      strip.price(boost::bind(&liborDiscounts, hLibor, _1, _2, _3, _4), rates);
+
+      for(long i = 0; i < nDateFixing; ++i) {
+         if(start_dates) start_dates[i] = strip.start(i);
+         if(end_dates) end_dates[i] = strip.end(i);
+         if(accruals) accruals[i] = strip.accrual(i);
+      }
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
 // File con defnizione della cache per il DiscTermStructure
 #include "cDTSCache.h"
 
@@ -1256,6 +1384,87 @@ pdgerr_t pdg_shmImplSwap(long h_libor, long start_date, long maturity, long mat_
    return RES_OK;
 }
 
+namespace {
+   //the swap of a key, never modified once built. A call prices a copy of it (the schedules are copied, not
+   //generated again), so no lock is taken. The conventions of the currency the schedules were generated
+   //with are kept, the entry is built again when they change.
+   struct CachedSwap {
+      CachedSwap(currency_code curID, const CustomSwapConvention &conv, const BusinessDay &start, const libor::SwapKey &key)
+      : csc(conv), startDate(start),
+        calendarCode(static_cast<long>(convManager::Instance()[curID].getCalendarCode())),
+        settlementDays(static_cast<long>(convManager::Instance()[curID].getSettlementDays())),
+        swap(curID, csc, key.nominal, startDate, startDate, key.fixRate, key.matMonths ? mtMaturityMonth : mtMaturity,
+             key.matMonths ? key.matMonths : key.maturity, key.firstCpnFixed, key.firstCpn, key.fullFloatLegEval)
+      {}
+
+      bool current(currency_code curID) const
+      {
+         return calendarCode == static_cast<long>(convManager::Instance()[curID].getCalendarCode()) &&
+                settlementDays == static_cast<long>(convManager::Instance()[curID].getSettlementDays());
+      }
+
+      CustomSwapConvention csc;
+      BusinessDay startDate;
+      long calendarCode;
+      long settlementDays;
+      Swap<> swap;
+   };
+
+   typedef libor::ScheduleCache<libor::SwapKey, CachedSwap> swap_cache_type;
+
+   swap_cache_type &swapCache()
+   {
+      static swap_cache_type cache;
+      return cache;
+   }
+
+   libor::SwapKey swapKey(currency_code curID, long start_date, long maturity, long mat_months,
+                          long fix_freq, long fix_day_count, long flt_freq, long flt_day_count,
+                          long mod_follow, long flag_adj, bool first_cpn_fixed, double first_cpn)
+   {
+      adjustment_type adjust = atFwModFollowing;
+      if (!mod_follow) adjust = atForward;
+      if (!flag_adj) adjust = atNoAdjust;
+
+      libor::SwapKey key;
+      key.currency = curID;
+      key.start = start_date;
+      key.maturity = mat_months ? 0 : maturity;
+      key.matMonths = mat_months;
+      key.fixFreq = fix_freq;
+      key.fixDayCount = fix_day_count;
+      key.fltFreq = flt_freq;
+      key.fltDayCount = flt_day_count;
+      key.adjust = adjust;
+      key.firstCpnFixed = first_cpn_fixed;
+      key.firstCpn = first_cpn;
+      return key;
+   }
+
+   //swap of the key from the cache, built (schedules, calendar adjustments, year fractions) on a miss
+   boost::shared_ptr<const CachedSwap> cachedSwap(const libor::SwapKey &key)
+   {
+      currency_code curID = static_cast<currency_code>(key.currency);
+      boost::shared_ptr<CachedSwap> res = swapCache().find(key);
+      if(res && res->current(curID)) return res;
+      if(res) swapCache().erase(key);
+
+      //get std conventions for given currency and overrides them
+      CustomSwapConvention csc(curID);
+      csc.fixYrf() = static_cast<daycount_type>(key.fixDayCount);
+      csc.fixFreq() = key.fixFreq;
+      csc.floatYrf() = static_cast<daycount_type>(key.fltDayCount);
+      csc.floatFreq() = key.fltFreq;
+      csc.adjust() = static_cast<adjustment_type>(key.adjust);
+
+      //start_date is assumed to be an XL date, otherwise conversion in BusinessDay is wrong
+      //WARNING: Swap<> constructor pushes startDate forward according to settlement days currency convention, that is why we pull it back
+      BusinessDay startDate(convManager::Instance()[curID].getCalendarCode(), key.start);
+      startDate -= convManager::Instance()[curID].getSettlementDays();
+      return swapCache().insert(key, boost::shared_ptr<CachedSwap>(new CachedSwap(curID, csc, startDate, key)));
+   }
+}
+
 pdgerr_t pdg_shmImplSwap2(long h_disc, long h_fwd, long start_date, long maturity, long mat_months,
                                     long fix_freq,  long fix_day_count,long flt_freq, long flt_day_count,
 												long mod_follow, long flag_adj, bool first_cpn_fixed, double first_cpn, 
@@ -1273,29 +1482,17 @@ pdgerr_t pdg_shmImplSwap2(long h_disc, long h_fwd, long start_date, long maturit
 		pdg::Assertion(curID==curID_,"#Error in pdg_shmImplSwap2, forwarding and discounting curve have different currencies");
       
 
-      //get std conventions for given currency and overrides them
-		CustomSwapConvention csc(curID);
-      
-
       pdg::Assertion(fix_day_count < MAX_DAYCOUNT_SIZE,"#Error in pdg_shmImplSwap2, fix_day_count is greater than daycount_type.");
       pdg::Assertion(fix_day_count > -1,"#Error in pdg_shmImplSwap2, fix_day_count is negative.");
-      csc.fixYrf() = static_cast<daycount_type>(fix_day_count);
-      csc.fixFreq() = fix_freq;
       pdg::Assertion(flt_day_count < MAX_DAYCOUNT_SIZE,"#Error in pdg_shmImplSwap2, flt_day_count is greater than daycount_type.");
       pdg::Assertion(flt_day_count > -1,"#Error in pdg_shmImplSwap2, flt_day_count is negative.");
-      csc.floatYrf() = static_cast<daycount_type>(flt_day_count);
-      csc.floatFreq() = flt_freq;
-      adjustment_type adjust = atFwModFollowing;
-      if (!mod_follow) adjust = atForward;
-      if (!flag_adj) adjust = atNoAdjust;
-      csc.adjust() = adjust;
 
-      //start_date is assumed to be an XL date, otherwise conversion in BusinessDay is wrong
-      BusinessDay startDate(convManager::Instance()[curID].getCalendarCode(), start_date);
-      startDate -= convManager::Instance()[curID].getSettlementDays();
-      bool fullFloatLegEval = true;
-		Swap<> swap(curID, csc, 100, startDate, startDate, 0, mat_months ? mtMaturityMonth : mtMaturity, mat_months ? mat_months : maturity, first_cpn_fixed, first_cpn, fullFloatLegEval);
-		
+      libor::SwapKey key = swapKey(curID, start_date, maturity, mat_months, fix_freq, fix_day_count, flt_freq, flt_day_count,
+                                   mod_follow, flag_adj, first_cpn_fixed, first_cpn);
+      key.fullFloatLegEval = true;
+      boost::shared_ptr<const CachedSwap> cached = cachedSwap(key);
+      Swap<> swap(cached->swap);
+
       *impl_rate = swap.getImplRate(static_cast<Curve *>(&discCurve),static_cast<Curve *>(&fwdCurve));
    }
    catch(pdg::Error e) {
@@ -1323,23 +1520,12 @@ pdgerr_t pdg_shmImplAnnuity(long h_disc, long h_fwd, long start_date, long matur
       currency_code curID_ = fwdCurve.getCurrency();
 		pdg::Assertion(curID==curID_,"#Error in pdg_shmImplSwap2, forwarding and discounting curve have different currencies");
 
-      //get std conventions for given currency and overrides them
-		CustomSwapConvention csc(curID);
-      csc.fixYrf() = static_cast<daycount_type>(fix_day_count);
-      csc.fixFreq() = fix_freq;
-      csc.floatYrf() = static_cast<daycount_type>(flt_day_count);
-      csc.floatFreq() = flt_freq;
-      adjustment_type adjust = atFwModFollowing;
-      if (!mod_follow) adjust = atForward;
-      if (!flag_adj) adjust = atNoAdjust;
-      csc.adjust() = adjust;
+      libor::SwapKey key = swapKey(curID, start_date, maturity, mat_months, fix_freq, fix_day_count, flt_freq, flt_day_count,
+                                   mod_follow, flag_adj, first_cpn_fixed, first_cpn);
+      key.fullFloatLegEval = true;
+      boost::shared_ptr<const CachedSwap> cached = cachedSwap(key);
+      Swap<> swap(cached->swap);
 
-      //start_date is assumed to be an XL date, otherwise conversion in BusinessDay is wrong
-      BusinessDay startDate(convManager::Instance()[curID].getCalendarCode(), start_date);
-      startDate -= convManager::Instance()[curID].getSettlementDays();
-      bool fullFloatLegEval = true;
-		Swap<> swap(curID, csc, 100, startDate, startDate, 0, mat_months ? mtMaturityMonth : mtMaturity, mat_months ? mat_months : maturity, first_cpn_fixed, first_cpn, fullFloatLegEval);
-		
       *annuity = swap.getAnnuity(static_cast<Curve *>(&discCurve),static_cast<Curve *>(&fwdCurve),cash_settled>0);
    }
    catch(pdg::Error e) {
@@ -1352,6 +1538,125 @@ pdgerr_t pdg_shmImplAnnuity(long h_disc, long h_fwd, long start_date, long matur
    return RES_OK;
 }
 
+PDGLIB_API pdgerr_t pdg_shmSwapCacheStats(long *hits, long *misses, long *evictions, long *size, long *capacity)
+{
+   try {
+      libor::ScheduleCacheStats stats = swapCache().stats();
+      *hits = stats.hits;
+      *misses = stats.misses;
+      *evictions = stats.evictions;
+      *size = stats.size;
+      *capacity = stats.capacity;
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmSetSwapCacheCapacity(long capacity)
+{
+   try {
+      swapCache().setCapacity(capacity);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmClearSwapCache()
+{
+   try {
+      swapCache().clear();
+      CurrencyCalendars &cc = currencyCalendars();
+      boost::mutex::scoped_lock lock(cc.mutex);
+      cc.calendars.clear();
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+namespace {
+   //points compared in each interval between pillars, days beyond the last pillar compared in extrapolation
+   const long ENGINE_CHECK_POINTS = 8;
+   const long ENGINE_CHECK_TAIL[] = { 1, 30, 365, 3650 };
+   //relative to the discounts, beyond the rounding of the engine's term structure
+   const double ENGINE_CHECK_TOLERANCE = 1.e-9;
+
+   // The block draws the curve as the DiscTermStructure of pdg_interpDisc: both are evaluated on a dense grid
+   // of dates, the pillars, ENGINE_CHECK_POINTS dates in each interval and a few dates of extrapolation.
+   bool drawsAsEngine(const shm_curve::BlockSpec &spec, const long *date, const double *disc, long sz_disc)
+   {
+      std::vector<double> mem(shm_curve::blockBytes(sz_disc) / sizeof(double) + 1);
+      shm_curve::writeBlock(&mem[0], mem.size() * sizeof(double), spec, date, disc, sz_disc);
+      shm_curve::ShmCurveBlockView view(&mem[0]);
+      if(!view.evaluable()) return true; // nothing to check, the readers go to the engine
+
+      std::vector<long> grid(date, date + sz_disc);
+      for(long i = 0; i + 1 < sz_disc; ++i)
+         for(long j = 1; j < ENGINE_CHECK_POINTS; ++j)
+            grid.push_back(date[i] + (date[i + 1] - date[i]) * j / ENGINE_CHECK_POINTS);
+      for(size_t j = 0; j < sizeof(ENGINE_CHECK_TAIL) / sizeof(ENGINE_CHECK_TAIL[0]); ++j)
+         grid.push_back(date[sz_disc - 1] + ENGINE_CHECK_TAIL[j]);
+      std::sort(grid.begin(), grid.end());
+      grid.erase(std::unique(grid.begin(), grid.end()), grid.end());
+
+      const long m = static_cast<long>(grid.size());
+      std::vector<long> dates(date, date + sz_disc);
+      std::vector<double> discs(disc, disc + sz_disc), engine(m), block(m);
+      pdgerr_t res = pdg_interpDisc(sz_disc, &dates[0], &discs[0], m, &grid[0], &engine[0],
+                                    spec.typeInterp, spec.interpOn, spec.comp, spec.dayCount);
+      if(res.code) return false;
+      view.discounts(&grid[0], m, &block[0]);
+      for(long k = 0; k < m; ++k)
+         if(!(fabs(block[k] - engine[k]) <= ENGINE_CHECK_TOLERANCE * std::max(1.0, fabs(engine[k])))) return false;
+      return true;
+   }
+
+   // Publishes the curve also as a fixed layout block, built directly from the caller arrays. A block that
+   // does not draw the curve as the engine is published not evaluable, its readers fall back on the engine.
+   // The ShmLibor curve has already been pushed: a failure here is traced and does not fail the push.
+   void publishCurveBlock(currency_code curID, const char *liborName, const char *backboneName, const long *date,
+                          const double *disc, long type_interp, long interp_on, long comp, long day_count, long sz_disc)
+   {
+      try {
+         shm_curve::BlockSpec spec;
+         spec.currency = curID;
+         spec.typeInterp = type_interp;
+         spec.interpOn = interp_on;
+         spec.comp = comp;
+         spec.dayCount = day_count;
+         spec.name = liborName;
+         spec.backbone = backboneName;
+         spec.evaluable = drawsAsEngine(spec, date, disc, sz_disc);
+         if(!spec.evaluable)
+            MTD(mt_ios::essential) << "[publishCurveBlock]" << liborName << ": the block does not match the engine, left to the engine" << std::endl;
+         shm_curve::ShmCurveStore::Instance().publish(spec, date, disc, sz_disc);
+      }
+      catch(pdg::Error e) {
+         MTD(mt_ios::essential) << "[publishCurveBlock]" << liborName << ": " << e.getInfo().des << std::endl;
+      }
+      catch(...) {
+         MTD(mt_ios::essential) << "[publishCurveBlock]" << liborName << ": unable to publish the curve block" << std::endl;
+      }
+   }
+}
+
 pdgerr_t pdg_pushShmLiborCurve(const char *liborName, long *date, double *disc, long type_interp, long interp_on, long comp,
                                           long day_count, long sz_disc)
 {
@@ -1401,6 +1706,7 @@ pdgerr_t pdg_pushShmLiborCurveName(const char *currency, const char *liborName,
       discVec.assign(&disc[0], &disc[sz_disc]);
 
       libor::pushShmLiborCurve(curID, liborName, "", dateVec, discVec, type_interp, interp_on, comp, day_count);
+      publishCurveBlock(curID, liborName, "", date, disc, type_interp, interp_on, comp, day_count, sz_disc);
    }
    catch(pdg::Error e) {
       return e.getInfo();
@@ -1424,6 +1730,7 @@ pdgerr_t pdg_pushShmLiborCurveNameExt(const char *currency, const char *liborNam
       discVec.assign(&disc[0], &disc[sz_disc]);
 
       libor::pushShmLiborCurveExt(curID, liborName, "", ref, dateVec, discVec, type_interp, interp_on, comp, day_count);
+      publishCurveBlock(curID, liborName, "", date, disc, type_interp, interp_on, comp, day_count, sz_disc);
    }
    catch(pdg::Error e) {
       return e.getInfo();
@@ -1447,6 +1754,7 @@ pdgerr_t pdg_pushShmLiborSpreadCurve(const char *currency, const char *liborName
       discVec.assign(&disc[0], &disc[sz_disc]);
 
       libor::pushShmLiborCurveExt(curID, liborName, backboneName, ref, dateVec, discVec, type_interp, interp_on, comp, day_count);
+      publishCurveBlock(curID, liborName, backboneName, date, disc, type_interp, interp_on, comp, day_count, sz_disc);
    }
    catch(pdg::Error e) {
       return e.getInfo();
@@ -1667,30 +1975,19 @@ pdgerr_t pdg_shmSwapNPV(long h_disc, long h_fwd, long start_date, long maturity,
       currency_code curID_ = fwdCurve.getCurrency();
 		pdg::Assertion(curID==curID_,"#Error in pdg_shmSwapNPV, forwarding and discounting curve have different currencies");
 
-      //get std conventions for given currency and overrides them
-		CustomSwapConvention csc(curID);
-      
-
       pdg::Assertion(fix_day_count < MAX_DAYCOUNT_SIZE,"#Error in pdg_shmSwapNPV, fix_day_count is greater than daycount_type.");
       pdg::Assertion(fix_day_count > -1,"#Error in pdg_shmSwapNPV, fix_day_count is negative.");
-      csc.fixYrf() = static_cast<daycount_type>(fix_day_count);
-      csc.fixFreq() = fix_freq;
       pdg::Assertion(flt_day_count < MAX_DAYCOUNT_SIZE,"#Error in pdg_shmSwapNPV, flt_day_count is greater than daycount_type.");
       pdg::Assertion(flt_day_count > -1,"#Error in pdg_shmSwapNPV, flt_day_count is negative.");
-      csc.floatYrf() = static_cast<daycount_type>(flt_day_count);
-      csc.floatFreq() = flt_freq;
-      adjustment_type adjust = atFwModFollowing;
-      if (!mod_follow) adjust = atForward;
-      if (!flag_adj) adjust = atNoAdjust;
-      csc.adjust() = adjust;
 
-      //start_date is assumed to be an XL date, otherwise conversion in BusinessDay is wrong
-		//WARNING: Swap<> constructor pushes startDate forward according to settlement days currency convention, that is why we pull it back
-      BusinessDay startDate(convManager::Instance()[curID].getCalendarCode(), start_date);
-      startDate -= convManager::Instance()[curID].getSettlementDays();
-      bool fullFloatLegEval = (h_disc!=h_fwd);//if handles are the same, single curve, turn off fullFloatLegEval
-		Swap<> swap(curID, csc, nominal, startDate, startDate, fix_rate, mat_months ? mtMaturityMonth : mtMaturity, mat_months ? mat_months : maturity, first_cpn_fixed, first_cpn, fullFloatLegEval);
-		
+      libor::SwapKey key = swapKey(curID, start_date, maturity, mat_months, fix_freq, fix_day_count, flt_freq, flt_day_count,
+                                   mod_follow, flag_adj, first_cpn_fixed, first_cpn);
+      key.fullFloatLegEval = (h_disc!=h_fwd);//if handles are the same, single curve, turn off fullFloatLegEval
+      key.fixRate = fix_rate;
+      key.nominal = nominal;
+      boost::shared_ptr<const CachedSwap> cached = cachedSwap(key);
+      Swap<> swap(cached->swap);
+
       *npv = swap.npv(Date(), static_cast<Curve *>(&discCurve), static_cast<Curve *>(&fwdCurve));
 
    }
@@ -2096,10 +2393,70 @@ pdgerr_t pdg_doubleCurveCorrection(const char *fwdCurve, const char *discCurve,
    return RES_OK;
 }
 
+namespace {
+   //date whose year fraction from today in day_count is the nearest to yf
+   long nearestDate(long today, long day_count, double yf)
+   {
+      long date = today + static_cast<long>(floor(yf * 365.25 + 0.5));
+      double lo, hi;
+      daycount::yearFractions(day_count, today, 1, &date, &lo);
+      while(lo > yf) {
+         --date;
+         daycount::yearFractions(day_count, today, 1, &date, &lo);
+      }
+      long next = date + 1;
+      daycount::yearFractions(day_count, today, 1, &next, &hi);
+      while(hi <= yf) {
+         date = next++;
+         lo = hi;
+         daycount::yearFractions(day_count, today, 1, &next, &hi);
+      }
+      return yf - lo <= hi - yf ? date : next;
+   }
+
+   //outright curve block, evaluable on year fractions in day_count; read from the store without its lock
+   bool mxInterpBlock(const std::string &liborName, long day_count, long out_sz, const double *out_yf, double *out_disc)
+   {
+      shm_curve::ShmCurveStore::ReadGuard guard(shm_curve::ShmCurveStore::Instance());
+      for(long attempts = 0; ; shm_curve::retryRead(attempts, "pdg_mxInterpDisc")) {
+         shm_curve::ShmCurveBlockView view = shm_curve::ShmCurveStore::Instance().find(liborName.c_str());
+         if(!view.valid()) return false;
+         const boost::uint32_t seq = view.beginRead();
+         const shm_curve::BlockHeader &h = view.header();
+         if(h.flags & shm_curve::bfRetired) continue;
+         //another ACT basis counts the same days, the other bases have no mapping without dates
+         const bool convertible = day_count == h.dayCount ||
+                                  (daycount::basisOf(day_count) != daycount::dbNone && daycount::basisOf(h.dayCount) != daycount::dbNone);
+         if(!(h.flags & shm_curve::bfEvaluable) || (h.flags & shm_curve::bfSpread) || !convertible) {
+            if(view.endRead(seq)) return false;
+            continue;
+         }
+         try {
+            view.discountsAtYearFractions(day_count, out_yf, out_sz, out_disc);
+         }
+         catch(pdg::Error) {
+            if(view.endRead(seq)) throw; // a genuine error, not a torn read
+            continue;
+         }
+         if(view.endRead(seq)) return true;
+      }
+   }
+}
+
 pdgerr_t pdg_mxInterpDisc(long hLibor, long day_count, long out_sz, double *out_yf, double *out_disc)
 {
    try {
+      //the block of the curve is indexed by time: the year fractions are interpolated without going
+      //back to dates, in one walk when they are ascending
+      const std::string liborName = libor_client::Instance().getNameByHandle(hLibor);
+      if(mxInterpBlock(liborName, day_count, out_sz, out_yf, out_disc)) return RES_OK;
 
+      //spread curves and curves without a block: the client on the dates of the year fractions, the
+      //year fractions of cash flows being those of dates
+      libor_client::Instance().getCurveByHandle<ShmLibor<> >(hLibor).updateTermStructure();
+      const long today = libor_client::Instance().getCalcDateByHandle(hLibor).getExcelDate();
+      for(long i = 0; i < out_sz; ++i)
+         out_disc[i] = libor_client::Instance().getValueByHandle(hLibor, Date(nearestDate(today, day_count, out_yf[i])));
    }
    catch(pdg::Error e) {
       return e.getInfo();
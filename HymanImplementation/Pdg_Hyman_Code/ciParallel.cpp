@@ -0,0 +1,49 @@
+//ciParallel.cpp
+#include "ciParallel.h"
+#include "cThreadPool.h"
+#include "cError.h"
+
+PDGLIB_API pdgerr_t pdg_setThreadCount(long n_threads)
+{
+   try {
+      parallel::ThreadPool::setSharedSize(n_threads);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_threadCount(long *n_threads)
+{
+   try {
+      *n_threads = parallel::ThreadPool::shared()->size();
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shutdownThreads()
+{
+   try {
+      parallel::ThreadPool::shutdownShared();
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
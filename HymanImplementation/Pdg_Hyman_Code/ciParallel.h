@@ -0,0 +1,28 @@
+//ciParallel.h
+#ifndef _CIPARALLEL_H__
+#define _CIPARALLEL_H__
+
+#include "pdgapi.h"
+#include "ciError.h"
+
+#ifdef __cplusplus
+extern "C" {     /* Begin C Interface wrapping */
+#endif
+
+// Number of threads the library functions run their tasks on (the batch bootstraps without an
+// explicit n_threads, the portfolio pricers), n_threads <= 0 for the number of hardware threads.
+// The calls already running keep the threads they started with.
+PDGLIB_API pdgerr_t pdg_setThreadCount(long n_threads);
+
+PDGLIB_API pdgerr_t pdg_threadCount(long *n_threads);
+
+// Joins the threads of the library, to be called from the close hook of the add-in (xlAutoClose)
+// so that they do not end in the static destruction of the DLL, under the loader lock. A library
+// function called afterwards starts them again.
+PDGLIB_API pdgerr_t pdg_shutdownThreads();
+
+#ifdef __cplusplus
+}     /* End C Interface wrapping */
+#endif
+
+#endif //_CIPARALLEL_H__
@@ -0,0 +1,445 @@
+//ciShmCurve.cpp
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include "ciShmCurve.h"
+#include "cShmCurveStore.h"
+#include "cCurveRegistry.h"
+#include "cCompiledCalendar.h"
+#include "ratePortfolioPricer.h"
+#include "rateScenarioRevaluation.h"
+#include "rateSwapSurface.h"
+#include "cThreadPool.h"
+#include "cError.h"
+#include "xtos.h"
+
+using namespace shm_curve;
+
+namespace {
+   void registryDiscounts(long handle, const long *dates, long n, double *out)
+   {
+      if(!CurveRegistry::Instance().interpDisc(handle, dates, n, out))
+         throw pdg::Error(2, "#Error in CurveRegistry, no evaluable block for curve " + CurveRegistry::Instance().name(handle));
+   }
+
+   std::vector<libor::SwapTrade> swapTable(const pdg_swap_table_type *trades)
+   {
+      std::vector<libor::SwapTrade> table(trades->n);
+      for(long i = 0; i < trades->n; ++i) {
+         libor::SwapTrade &t = table[i];
+         t.start = trades->start_dates[i];
+         t.maturity = trades->maturities[i];
+         t.fixRate = trades->fix_rates[i];
+         t.fixFreq = trades->fix_freqs[i];
+         t.fixDayCount = trades->fix_day_counts[i];
+         t.fltFreq = trades->flt_freqs[i];
+         t.fltDayCount = trades->flt_day_counts[i];
+         t.notional = trades->notionals[i];
+         t.discCurve = trades->disc_handles[i];
+         t.fwdCurve = trades->fwd_handles[i];
+         if(trades->calendar_ids) t.calendar = trades->calendar_ids[i];
+         t.adjust = trades->adj_rules ? trades->adj_rules[i] : static_cast<long>(t.calendar ? libor::bdModFollowing : libor::bdNone);
+         t.firstCpnFixed = trades->first_cpns != 0;
+         if(trades->first_cpns) t.firstCpn = trades->first_cpns[i];
+      }
+      return table;
+   }
+
+   typedef std::map<long, boost::shared_ptr<ShmCurveBlockAdjoint> > curve_copies;
+
+   //copy of the materialised block of the curve of a handle
+   boost::shared_ptr<ShmCurveBlockAdjoint> curveCopy(long handle)
+   {
+      const std::string name = CurveRegistry::Instance().name(handle);
+      boost::shared_ptr<ShmCurveBlockAdjoint> res(new ShmCurveBlockAdjoint);
+      ShmCurveStore::ReadGuard guard(ShmCurveStore::Instance());
+      for(long attempts = 0; ; retryRead(attempts, "pdg_shmSwapPortfolioNPVAdjoint")) {
+         ShmCurveBlockView view = ShmCurveStore::Instance().composite(name.c_str());
+         if(!view.valid()) throw pdg::Error(2, "#Error in pdg_shmSwapPortfolioNPVAdjoint, curve not published: " + name);
+         if(res->load(view)) return res;
+      }
+   }
+
+   void copyDiscounts(const curve_copies *copies, long handle, const long *dates, long n, double *out)
+   {
+      copies->find(handle)->second->view().discounts(dates, n, out);
+   }
+
+   const long SCENARIO_CHUNK = 64;
+
+   //the P&L rows as they come, scenario after scenario
+   void writePnL(std::ofstream *out, const std::string *path, long trades, long, long n, const double *pnl)
+   {
+      out->write(reinterpret_cast<const char *>(pnl), n * trades * sizeof(double));
+      if(!*out) throw pdg::Error(2, "#Error in pdg_shmSwapPortfolioScenarioPnL, cannot write " + *path);
+   }
+}
+
+PDGLIB_API pdgerr_t pdg_shmCurveBlockInterpDisc(const char *libor_name, long out_sz, long *out_date, double *out_disc)
+{
+   try {
+      if(!ShmCurveStore::Instance().interpDisc(libor_name, out_date, out_sz, out_disc))
+         throw pdg::Error(2, std::string("#Error in pdg_shmCurveBlockInterpDisc, no evaluable block for curve ") + libor_name);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmCurveBlockInfo(const char *libor_name, long *size, long *today, long *type_interp,
+                                          long *interp_on, long *comp, long *day_count, double *version,
+                                          double *publish_time)
+{
+   try {
+      ShmCurveStore::ReadGuard guard(ShmCurveStore::Instance());
+      for(long attempts = 0; ; retryRead(attempts, "pdg_shmCurveBlockInfo")) {
+         ShmCurveBlockView view = ShmCurveStore::Instance().find(libor_name);
+         if(!view.valid()) throw pdg::Error(2, std::string("#Error in pdg_shmCurveBlockInfo, curve not published: ") + libor_name);
+
+         boost::uint32_t seq = view.beginRead();
+         const BlockHeader &h = view.header();
+         *size = h.size;
+         *today = h.today;
+         *type_interp = h.typeInterp;
+         *interp_on = h.interpOn;
+         *comp = h.comp;
+         *day_count = h.dayCount;
+         *version = static_cast<double>(h.version);
+         *publish_time = h.publishTime;
+         if(view.endRead(seq) && !(h.flags & bfRetired)) break;
+      }
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmCurveBlockPillars(const char *libor_name, long sz_disc, long *date, double *disc)
+{
+   try {
+      ShmCurveStore::ReadGuard guard(ShmCurveStore::Instance());
+      for(long attempts = 0; ; retryRead(attempts, "pdg_shmCurveBlockPillars")) {
+         ShmCurveBlockView view = ShmCurveStore::Instance().find(libor_name);
+         if(!view.valid()) throw pdg::Error(2, std::string("#Error in pdg_shmCurveBlockPillars, curve not published: ") + libor_name);
+
+         boost::uint32_t seq = view.beginRead();
+         const long n = std::min(sz_disc, view.size());
+         std::copy(view.dates(), view.dates() + n, date);
+         std::copy(view.discounts(), view.discounts() + n, disc);
+         if(view.endRead(seq) && !(view.header().flags & bfRetired)) break;
+      }
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmCompositeCurvePillars(const char *libor_name, long sz_disc, long *date, double *disc,
+                                                 long *out_sz)
+{
+   try {
+      ShmCurveStore::ReadGuard guard(ShmCurveStore::Instance());
+      for(long attempts = 0; ; retryRead(attempts, "pdg_shmCompositeCurvePillars")) {
+         ShmCurveBlockView view = ShmCurveStore::Instance().composite(libor_name);
+         if(!view.valid()) throw pdg::Error(2, std::string("#Error in pdg_shmCompositeCurvePillars, curve not published: ") + libor_name);
+
+         boost::uint32_t seq = view.beginRead();
+         *out_sz = view.size();
+         const long n = std::min(sz_disc, *out_sz);
+         std::copy(view.dates(), view.dates() + n, date);
+         std::copy(view.discounts(), view.discounts() + n, disc);
+         if(view.endRead(seq) && !(view.header().flags & bfRetired)) break;
+      }
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmResolveCurveHandle(const char *libor_name, long *handle)
+{
+   try {
+      *handle = CurveRegistry::Instance().resolve(libor_name);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmReleaseCurveHandle(long handle)
+{
+   try {
+      CurveRegistry::Instance().release(handle);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmHandleInterpDisc(long handle, long out_sz, long *out_date, double *out_disc)
+{
+   try {
+      if(!CurveRegistry::Instance().interpDisc(handle, out_date, out_sz, out_disc))
+         throw pdg::Error(2, "#Error in pdg_shmHandleInterpDisc, no evaluable block for curve " + CurveRegistry::Instance().name(handle));
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmWaitCurves(long sz_names, const char **libor_names, double *versions,
+                                      long timeout_ms, long batch_ms, long *changed)
+{
+   try {
+      std::vector<boost::uint64_t> known(versions, versions + sz_names);
+      *changed = sz_names > 0 ? ShmCurveStore::Instance().waitForChange(libor_names, sz_names, &known[0], timeout_ms, batch_ms) : 0;
+      std::copy(known.begin(), known.end(), versions);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmSetHistoryDepth(const char *libor_name, long depth)
+{
+   try {
+      ShmCurveStore::Instance().setHistoryDepth(libor_name, depth);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmInterpDiscAtVersion(const char *libor_name, double version, long out_sz,
+                                               long *out_date, double *out_disc)
+{
+   try {
+      if(!ShmCurveStore::Instance().interpDiscAtVersion(libor_name, static_cast<boost::uint64_t>(version), out_date, out_sz, out_disc))
+         throw pdg::Error(2, std::string("#Error in pdg_shmInterpDiscAtVersion, version ") + xtos(version) + " not kept for curve " + libor_name);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmInterpDiscAtTime(const char *libor_name, double xl_time, long out_sz,
+                                            long *out_date, double *out_disc)
+{
+   try {
+      if(!ShmCurveStore::Instance().interpDiscAtTime(libor_name, xl_time, out_date, out_sz, out_disc))
+         throw pdg::Error(2, std::string("#Error in pdg_shmInterpDiscAtTime, no publication kept at that time for curve ") + libor_name);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmCurveVersions(const char *libor_name, long sz, double *versions,
+                                         double *publish_times, long *out_sz)
+{
+   try {
+      std::vector<boost::uint64_t> kept(std::max(sz, 1L));
+      *out_sz = ShmCurveStore::Instance().history(libor_name, sz, &kept[0], publish_times);
+      std::copy(kept.begin(), kept.begin() + *out_sz, versions);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmSwapPortfolioNPV(long today, const pdg_swap_table_type *trades, double *out_npv,
+                                            double *out_total)
+{
+   try {
+      libor::SwapPortfolio portfolio(today, swapTable(trades));
+      std::vector<double> discs;
+      portfolio.evaluate(&registryDiscounts, discs);
+      const double total = portfolio.price(discs, out_npv, *parallel::ThreadPool::shared());
+      if(out_total) *out_total = total;
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmSwapPortfolioNPVAdjoint(long today, const pdg_swap_table_type *trades, long sz_curves,
+                                                   const long *curve_handles, long sz_grad, double *out_npv,
+                                                   double *out_total, double *out_grad, long *out_sz)
+{
+   try {
+      libor::SwapPortfolio portfolio(today, swapTable(trades));
+      const libor::CashflowGrid &grid = portfolio.grid();
+
+      //one copy of each curve, for the discounts and their adjoint
+      curve_copies copies;
+      for(size_t k = 0; k < grid.curves().size(); ++k) copies[grid.curves()[k]] = curveCopy(grid.curves()[k]);
+      for(long c = 0; c < sz_curves; ++c)
+         if(!copies[curve_handles[c]]) copies[curve_handles[c]] = curveCopy(curve_handles[c]);
+
+      std::vector<double> discs, discsBar;
+      portfolio.evaluate(boost::bind(&copyDiscounts, &copies, _1, _2, _3, _4), discs);
+      const double total = portfolio.adjoint(discs, out_npv, discsBar, *parallel::ThreadPool::shared());
+      if(out_total) *out_total = total;
+
+      //adjoint of the interpolation of each requested curve
+      std::fill(out_grad, out_grad + sz_curves * sz_grad, 0.0);
+      for(long c = 0; c < sz_curves; ++c) {
+         const ShmCurveBlockAdjoint &curve = *copies[curve_handles[c]];
+         out_sz[c] = curve.view().size();
+         std::vector<double> grad(out_sz[c], 0.0);
+         for(size_t k = 0; k < grid.curves().size(); ++k) {
+            if(grid.curves()[k] != curve_handles[c] || grid.dates(k).empty()) continue;
+            curve.adjoint(&grid.dates(k)[0], static_cast<long>(grid.dates(k).size()), &discsBar[grid.offset(k)], &grad[0]);
+         }
+         std::copy(grad.begin(), grad.begin() + std::min(sz_grad, out_sz[c]), out_grad + c * sz_grad);
+      }
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmSwapPortfolioScenarioPnL(long today, const pdg_swap_table_type *trades,
+                                                    const char *scenario_file, const char *pnl_file,
+                                                    long chunk_size, double *out_npv, long *out_scenarios)
+{
+   try {
+      libor::SwapPortfolio portfolio(today, swapTable(trades));
+      const libor::CashflowGrid &grid = portfolio.grid();
+      libor::ScenarioReader reader(scenario_file);
+
+      //the curves bootstrapped again need no copy, the zero rate shifts apply to the copied curve
+      std::vector<long> ids;
+      std::vector<bool> solved;
+      for(size_t c = 0; c < reader.curves().size(); ++c) {
+         ids.push_back(CurveRegistry::Instance().resolve(reader.curves()[c].name.c_str()));
+         solved.push_back(reader.curves()[c].type == libor::ssQuote);
+      }
+      curve_copies copies;
+      for(size_t k = 0; k < grid.curves().size(); ++k) {
+         const long handle = grid.curves()[k];
+         const std::vector<long>::const_iterator it = std::find(ids.begin(), ids.end(), handle);
+         if(it == ids.end() || !solved[it - ids.begin()]) copies[handle] = curveCopy(handle);
+      }
+      libor::ScenarioRevaluation revaluation(today, portfolio, reader.curves(), ids,
+                                             boost::bind(&copyDiscounts, &copies, _1, _2, _3, _4));
+      std::copy(revaluation.baseNPV().begin(), revaluation.baseNPV().end(), out_npv);
+
+      const std::string path(pnl_file);
+      std::ofstream out(pnl_file, std::ios::out | std::ios::binary | std::ios::trunc);
+      if(!out) throw pdg::Error(2, "#Error in pdg_shmSwapPortfolioScenarioPnL, cannot open " + path);
+      const long n = revaluation.run(reader, chunk_size > 0 ? chunk_size : SCENARIO_CHUNK,
+                                     boost::bind(&writePnL, &out, &path, portfolio.size(), _1, _2, _3),
+                                     *parallel::ThreadPool::shared());
+      if(out_scenarios) *out_scenarios = n;
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
+
+PDGLIB_API pdgerr_t pdg_shmImplSwapSurface(long disc_handle, long fwd_handle, long n_starts, const long *start_dates,
+                                           long n_tenors, const long *tenor_months, long fix_freq, long fix_day_count,
+                                           long flt_freq, long calendar_id, long adj_rule, double *out_rates,
+                                           double *out_annuities)
+{
+   try {
+      libor::SwapSurfaceTerms terms;
+      terms.fixFreq = fix_freq;
+      terms.fixDayCount = fix_day_count;
+      terms.fltFreq = flt_freq;
+      terms.discCurve = disc_handle;
+      terms.fwdCurve = fwd_handle;
+      terms.calendar = calendar_id;
+      terms.adjust = calendar_id ? adj_rule : static_cast<long>(libor::bdNone);
+      libor::SwapSurface surface(std::vector<long>(start_dates, start_dates + n_starts),
+                                 std::vector<long>(tenor_months, tenor_months + n_tenors), terms);
+      surface.price(&registryDiscounts, out_rates, out_annuities);
+   }
+   catch(pdg::Error e) {
+      return e.getInfo();
+   }
+   catch(...) {
+      return RES_FAIL;
+   }
+
+   return RES_OK;
+}
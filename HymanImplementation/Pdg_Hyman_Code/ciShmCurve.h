@@ -0,0 +1,165 @@
+//ciShmCurve.h
+#ifndef _CISHMCURVE_H__
+#define _CISHMCURVE_H__
+
+#include "pdgapi.h"
+#include "ciError.h"
+
+#ifdef __cplusplus
+extern "C" {     /* Begin C Interface wrapping */
+#endif
+
+// Discounts of a published curve evaluated directly against its shared memory block.
+// For a spread curve they are the product of the backbone and spread discounts.
+PDGLIB_API pdgerr_t pdg_shmCurveBlockInterpDisc(const char *libor_name, long out_sz, long *out_date, double *out_disc);
+
+// Header of the block of a published curve
+PDGLIB_API pdgerr_t pdg_shmCurveBlockInfo(const char *libor_name, long *size, long *today, long *type_interp,
+                                          long *interp_on, long *comp, long *day_count, double *version,
+                                          double *publish_time);
+
+// Pillars of a published curve, at most sz_disc of them are copied
+PDGLIB_API pdgerr_t pdg_shmCurveBlockPillars(const char *libor_name, long sz_disc, long *date, double *disc);
+
+// Pillars of the materialised curve: for a spread curve the composite discounts on the union of the
+// backbone and spread pillars, for an outright curve its own pillars. out_sz is the number of pillars,
+// at most sz_disc of them are copied.
+PDGLIB_API pdgerr_t pdg_shmCompositeCurvePillars(const char *libor_name, long sz_disc, long *date, double *disc,
+                                                 long *out_sz);
+
+// Handle of a curve name, resolved once: the name is canonicalised and interned, later calls
+// with the handle index a table instead of looking the name up. The handle becomes stale when
+// the curve is cleared (pdg_clearShmCurveName) or the handle released.
+PDGLIB_API pdgerr_t pdg_shmResolveCurveHandle(const char *libor_name, long *handle);
+
+PDGLIB_API pdgerr_t pdg_shmReleaseCurveHandle(long handle);
+
+// Same as pdg_shmCurveBlockInterpDisc, for a handle from pdg_shmResolveCurveHandle
+PDGLIB_API pdgerr_t pdg_shmHandleInterpDisc(long handle, long out_sz, long *out_date, double *out_disc);
+
+// Blocks until one of the curves is republished (or cleared), or timeout_ms elapses.
+// versions holds on input the versions already seen (0 if none) and on output the current ones,
+// changed is the number of curves whose version differs. The version of a spread curve also
+// changes when its backbone is republished. Publications arriving within batch_ms
+// of the first one are collected by the same call.
+PDGLIB_API pdgerr_t pdg_shmWaitCurves(long sz_names, const char **libor_names, double *versions,
+                                      long timeout_ms, long batch_ms, long *changed);
+
+// Number of past publications of the curve kept in shared memory (0, the default, keeps none).
+// Changing the depth discards the publications kept so far.
+PDGLIB_API pdgerr_t pdg_shmSetHistoryDepth(const char *libor_name, long depth);
+
+// Discounts of the curve as published with the given version
+PDGLIB_API pdgerr_t pdg_shmInterpDiscAtVersion(const char *libor_name, double version, long out_sz,
+                                               long *out_date, double *out_disc);
+
+// Discounts of the curve as it was at the XL serial date-time xl_time (e.g. today + 10:15)
+PDGLIB_API pdgerr_t pdg_shmInterpDiscAtTime(const char *libor_name, double xl_time, long out_sz,
+                                            long *out_date, double *out_disc);
+
+// Versions and publish times of the publications kept for the curve, newest first
+PDGLIB_API pdgerr_t pdg_shmCurveVersions(const char *libor_name, long sz, double *versions,
+                                         double *publish_times, long *out_sz);
+
+// The schedules of the swaps of pdg_shmSwapNPV, pdg_shmImplSwap2 and pdg_shmImplAnnuity are cached by
+// terms (the fixed rate and the nominal included) and conventions, the most recently used first. An entry
+// generated under another calendar code or settlement lag of the currency is generated again. Lookups that found the swap (hits) or built it (misses),
+// swaps evicted to stay within capacity, swaps cached.
+PDGLIB_API pdgerr_t pdg_shmSwapCacheStats(long *hits, long *misses, long *evictions, long *size, long *capacity);
+
+// Number of swaps kept (1024 by default), 0 disables the cache
+PDGLIB_API pdgerr_t pdg_shmSetSwapCacheCapacity(long capacity);
+
+// Drops the cached swaps and the calendars of pdg_shmImplRatesStrip, to be called when the holidays of a
+// calendar change
+PDGLIB_API pdgerr_t pdg_shmClearSwapCache();
+
+// Columnar table of vanilla swaps, one entry per trade in each array. The frequencies are payments
+// per year (divisors of 12), the notional is positive for a payer swap. The curves are handles from
+// pdg_shmResolveCurveHandle. calendar_ids (compiled with pdg_calendarCompile, 0 for unadjusted
+// dates) may be NULL, as adj_rules (see pdg_calendarAdjust, modified following by default). first_cpns
+// are the rates of the floating periods running at today, NULL when no trade has one.
+typedef struct pdg_swap_table {
+   long n;
+   const long *start_dates;
+   const long *maturities;
+   const double *fix_rates;
+   const long *fix_freqs;
+   const long *fix_day_counts;
+   const long *flt_freqs;
+   const long *flt_day_counts;
+   const double *notionals;
+   const long *disc_handles;
+   const long *fwd_handles;
+   const long *calendar_ids;
+   const long *adj_rules;
+   const double *first_cpns;
+} pdg_swap_table_type;
+
+// NPVs of a portfolio of swaps on the published curves. The schedules are generated once for the
+// portfolio, each curve is evaluated once on the distinct dates of all the trades (a snapshot the
+// pricing reads, whatever is published meanwhile). Periods paid on or before today are not priced.
+// The trades are priced on the threads of the library (see pdg_setThreadCount), out_total (may be
+// NULL) is the sum of the NPVs, the same to the bit whatever the number of threads.
+// The schedules are the pricer's own, not the engine's: rolled back from maturity on calendar_ids,
+// from start_dates as given (no settlement lag), and the floating coupons are forward discount
+// ratios of the forwarding curve. pdg_shmSwapNPV builds the swap of the engine on the conventions
+// of the currency, so the two NPVs differ whenever the calendars, the stubs or the floating
+// accruals of the engine do not coincide with these; they are not interchangeable.
+PDGLIB_API pdgerr_t pdg_shmSwapPortfolioNPV(long today, const pdg_swap_table_type *trades, double *out_npv,
+                                            double *out_total);
+
+// Same NPVs with the derivatives of their total with respect to the pillar discounts of the curves of
+// curve_handles, in one adjoint sweep through the cash flows and the curve interpolation. The NPVs and
+// their derivatives are those of the pricer of pdg_shmSwapPortfolioNPV, a single swap being a table of
+// one trade: they are not the derivatives of pdg_shmSwapNPV, whose engine schedules differ (see above),
+// and there is no adjoint of the engine swap. The curves are copied once, the NPVs and derivatives are those of the copies;
+// spread curves are differentiated with respect to their materialised pillars (see
+// pdg_shmCompositeCurvePillars). Row c of out_grad, row major sz_curves x sz_grad, holds the derivatives
+// for curve_handles[c], out_sz[c] is its number of pillars (at most sz_grad are copied). Multiplied by
+// the jacobian of pdg_liborCurveInstrumentsJacobian they are the deltas to the quotes of the curve.
+// The derivatives are exact for the linear, constant, quadratic and spline interpolations; through the
+// Kruger and Hyman cubics they are finite differences of the interpolation (see ShmCurveBlockAdjoint in
+// cShmCurveBlock.h), accurate to about 1e-8 relative and 1e-5 next to a kink of the monotone filter.
+PDGLIB_API pdgerr_t pdg_shmSwapPortfolioNPVAdjoint(long today, const pdg_swap_table_type *trades, long sz_curves,
+                                                   const long *curve_handles, long sz_grad, double *out_npv,
+                                                   double *out_total, double *out_grad, long *out_sz);
+
+// Revaluation of a table of swaps under the historical scenarios of scenario_file (layout in
+// rateScenarioRevaluation.h). The curves of the file bootstrapped by pdg_liborCurveInstruments are
+// bootstrapped again on their shifted quotes, the others have their zero rates shifted; the curves not
+// in the file are the published ones, copied once. The scenarios are read chunk_size at a time (64 when
+// not positive) and revalued on the threads of the library. The P&L of trade i in scenario s against
+// out_npv, the NPVs of the base curves, is written to pnl_file as the double at s * trades->n + i;
+// out_scenarios (may be NULL) is the number of scenarios.
+PDGLIB_API pdgerr_t pdg_shmSwapPortfolioScenarioPnL(long today, const pdg_swap_table_type *trades,
+                                                    const char *scenario_file, const char *pnl_file,
+                                                    long chunk_size, double *out_npv, long *out_scenarios);
+
+// Forward par rates of the swaps starting on start_dates[i] for tenor_months[j] months, on the published
+// curves (handles from pdg_shmResolveCurveHandle, fwd_handle may be disc_handle), in one pass: the
+// periods are rolled forward from the start (the tenors multiples of both periods), the floating
+// coupons projected as forward discount ratios. Cell i * n_tenors + j of out_rates holds the par
+// rate, of out_annuities (may be NULL) the discounted fixed accruals per unit of notional.
+// calendar_id is a compiled calendar (0 for unadjusted dates), adj_rule as in pdg_calendarAdjust.
+PDGLIB_API pdgerr_t pdg_shmImplSwapSurface(long disc_handle, long fwd_handle, long n_starts, const long *start_dates,
+                                           long n_tenors, const long *tenor_months, long fix_freq, long fix_day_count,
+                                           long flt_freq, long calendar_id, long adj_rule, double *out_rates,
+                                           double *out_annuities);
+
+// Projected fixings of a strip of floating periods on a libor curve, the bulk form of one pdg_shmFwRate
+// per fixing (the output of pdg_shmImplRates is laid out by the engine, see ciLibor.h). Each period starts
+// lagFixing business days after its fixing and ends periodMonths later, modified following (following
+// when modFollowing is 0), on the calendar of the currency of the curve. The discounts of the distinct
+// start and end dates are read once, in ascending order, from the curve as pdg_shmFwRate reads it; rates
+// are the simply compounded forwards over the accruals in dayCount. start_dates, end_dates and accruals
+// may be NULL, each array has one entry per fixing.
+PDGLIB_API pdgerr_t pdg_shmImplRatesStrip(long hLibor, long nDateFixing, long *dateFixing, long periodMonths,
+                                          long lagFixing, long modFollowing, long dayCount, long *start_dates,
+                                          long *end_dates, double *accruals, double *rates);
+
+#ifdef __cplusplus
+}     /* End C Interface wrapping */
+#endif
+
+#endif //_CISHMCURVE_H__
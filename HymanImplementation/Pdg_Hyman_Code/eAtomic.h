@@ -0,0 +1,94 @@
+//eAtomic.h
+#ifndef _EATOMIC_H__
+#define _EATOMIC_H__
+
+#include <boost/cstdint.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <emmintrin.h>
+#elif defined(__linux__)
+#include <climits>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+// Minimal set of lock-free primitives used by the shared memory curve blocks.
+// Kept to 32 bit words so that the same code works on both the 32 and 64 bit
+// Excel builds and across processes mapping the same segment.
+namespace atomic_ops {
+
+inline void fence()
+{
+#if defined(_MSC_VER)
+   _ReadWriteBarrier();
+   _mm_mfence();
+#else
+   __sync_synchronize();
+#endif
+}
+
+inline boost::uint32_t load(const volatile boost::uint32_t &v)
+{
+   boost::uint32_t res = v;
+   fence();
+   return res;
+}
+
+inline void store(volatile boost::uint32_t &v, boost::uint32_t x)
+{
+   fence();
+   v = x;
+   fence();
+}
+
+//returns the incremented value
+inline boost::uint32_t increment(volatile boost::uint32_t &v)
+{
+#if defined(_MSC_VER)
+   return static_cast<boost::uint32_t>(_InterlockedIncrement(reinterpret_cast<volatile long *>(&v)));
+#else
+   return __sync_add_and_fetch(&v, 1u);
+#endif
+}
+
+inline boost::uint32_t decrement(volatile boost::uint32_t &v)
+{
+#if defined(_MSC_VER)
+   return static_cast<boost::uint32_t>(_InterlockedDecrement(reinterpret_cast<volatile long *>(&v)));
+#else
+   return __sync_sub_and_fetch(&v, 1u);
+#endif
+}
+
+//Blocks while v == expected, at most timeoutMs milliseconds. The word may live in memory shared
+//between processes. Returns false when the OS has no such wait, the caller has to poll instead.
+inline bool waitWhileEqual(volatile boost::uint32_t &v, boost::uint32_t expected, long timeoutMs)
+{
+#if defined(__linux__)
+   struct timespec ts;
+   ts.tv_sec = timeoutMs / 1000;
+   ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+   //not FUTEX_PRIVATE: waiters and wakers are in different processes
+   syscall(SYS_futex, const_cast<boost::uint32_t *>(&v), FUTEX_WAIT, expected, &ts, 0, 0);
+   return true;
+#else
+   (void)v; (void)expected; (void)timeoutMs;
+   return false;
+#endif
+}
+
+inline void wakeAll(volatile boost::uint32_t &v)
+{
+#if defined(__linux__)
+   syscall(SYS_futex, const_cast<boost::uint32_t *>(&v), FUTEX_WAKE, INT_MAX, 0, 0, 0);
+#else
+   (void)v;
+#endif
+}
+
+} // namespace atomic_ops
+
+#endif // _EATOMIC_H__
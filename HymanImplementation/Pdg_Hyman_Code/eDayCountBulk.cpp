@@ -0,0 +1,144 @@
+//eDayCountBulk.cpp
+#include <algorithm>
+#include <cmath>
+#include "eDayCountBulk.h"
+#include "ciDates.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace daycount {
+
+namespace {
+   //dates are decomposed by chunks, on the stack
+   const long CHUNK = 256;
+
+   //year fractions of a chunk of at most CHUNK dates, start[i * startStep]
+   void chunkYearFractions(long basis, long n, const long *start, long startStep, const long *end, double *out)
+   {
+      switch(basis) {
+         case dbAct360:
+            for(long i = 0; i < n; ++i) out[i] = (end[i] - start[i * startStep]) / 360.0;
+            return;
+         case dbAct365:
+            for(long i = 0; i < n; ++i) out[i] = (end[i] - start[i * startStep]) / 365.0;
+            return;
+         default:
+            throw pdg::Error(2, "#Error in daycount::yearFractions, unknown basis " + xtos(basis));
+      }
+   }
+
+   void bulkYearFractions(long dayCount, long n, const long *start, long startStep, const long *end, double *out)
+   {
+      const long basis = basisOf(dayCount);
+      if(basis == dbNone) {
+         for(long i = 0; i < n; ++i) {
+            pdgerr_t res = pdg_yrfDayCount(start[i * startStep], end[i], dayCount, out + i);
+            if(res.code) throw pdg::Error(res);
+         }
+         return;
+      }
+      for(long i = 0; i < n; i += CHUNK) {
+         const long m = n - i < CHUNK ? n - i : CHUNK;
+         chunkYearFractions(basis, m, start + i * startStep, startStep, end + i, out + i);
+      }
+   }
+
+   void checkComp(long comp)
+   {
+      if(comp < 1 || comp > 3) throw pdg::Error(2, "#Error in daycount, unknown compounding " + xtos(comp));
+   }
+}
+
+void civilDates(long n, const long *dates, long *y, long *m, long *d)
+{
+   for(long i = 0; i < n; ++i) {
+      //days since 1 March of year 0, date 0 being 30 December 1899
+      const long z = dates[i] + 693899;
+      const long era = z / 146097;
+      const long doe = z - era * 146097;
+      const long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+      const long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+      const long mp = (5 * doy + 2) / 153;
+      d[i] = doy - (153 * mp + 2) / 5 + 1;
+      m[i] = mp < 10 ? mp + 3 : mp - 9;
+      y[i] = yoe + era * 400 + (m[i] <= 2);
+   }
+}
+
+long serialDate(long y, long m, long d)
+{
+   //years starting on 1 March, the leap day last
+   const long yp = m <= 2 ? y - 1 : y;
+   const long era = yp / 400;
+   const long yoe = yp - era * 400;
+   const long doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+   const long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+   return era * 146097 + doe - 693899;
+}
+
+long addMonths(long date, long months)
+{
+   long y, m, d;
+   civilDates(1, &date, &y, &m, &d);
+   const long k = y * 12 + m - 1 + months;
+   const long ny = k / 12, nm = k % 12 + 1;
+   const long monthEnd = (nm == 12 ? serialDate(ny + 1, 1, 1) : serialDate(ny, nm + 1, 1)) - 1;
+   return std::min(serialDate(ny, nm, 1) + d - 1, monthEnd);
+}
+
+long basisOf(long dayCount)
+{
+   //the ACT codes of the engine (see XllLibor.cpp), their year fraction does not depend on the engine
+   //conventions for month ends and leap years
+   switch(dayCount) {
+      case 4: return dbAct360;
+      case 5: return dbAct365;
+      default: return dbNone;
+   }
+}
+
+void yearFractions(long dayCount, long n, const long *start, const long *end, double *out)
+{
+   bulkYearFractions(dayCount, n, start, 1, end, out);
+}
+
+void yearFractions(long dayCount, long start, long n, const long *end, double *out)
+{
+   bulkYearFractions(dayCount, n, &start, 0, end, out);
+}
+
+void discountsToRates(long dayCount, long comp, long n, const long *start, const long *end, const double *disc, double *rate)
+{
+   checkComp(comp);
+   double t[CHUNK];
+   for(long i = 0; i < n; i += CHUNK) {
+      const long m = n - i < CHUNK ? n - i : CHUNK;
+      yearFractions(dayCount, m, start + i, end + i, t);
+      const double *p = disc + i;
+      double *r = rate + i;
+      switch(comp) {
+         case 1:  for(long k = 0; k < m; ++k) r[k] = t[k] == 0.0 ? 0.0 : (1.0 / p[k] - 1.0) / t[k]; break;
+         case 2:  for(long k = 0; k < m; ++k) r[k] = t[k] == 0.0 ? 0.0 : std::pow(p[k], -1.0 / t[k]) - 1.0; break;
+         default: for(long k = 0; k < m; ++k) r[k] = t[k] == 0.0 ? 0.0 : -std::log(p[k]) / t[k]; break;
+      }
+   }
+}
+
+void ratesToDiscounts(long dayCount, long comp, long n, const long *start, const long *end, const double *rate, double *disc)
+{
+   checkComp(comp);
+   double t[CHUNK];
+   for(long i = 0; i < n; i += CHUNK) {
+      const long m = n - i < CHUNK ? n - i : CHUNK;
+      yearFractions(dayCount, m, start + i, end + i, t);
+      const double *r = rate + i;
+      double *p = disc + i;
+      switch(comp) {
+         case 1:  for(long k = 0; k < m; ++k) p[k] = 1.0 / (1.0 + r[k] * t[k]); break;
+         case 2:  for(long k = 0; k < m; ++k) p[k] = std::pow(1.0 + r[k], -t[k]); break;
+         default: for(long k = 0; k < m; ++k) p[k] = std::exp(-r[k] * t[k]); break;
+      }
+   }
+}
+
+} // namespace daycount
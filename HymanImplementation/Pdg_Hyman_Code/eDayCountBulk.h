@@ -0,0 +1,45 @@
+//eDayCountBulk.h
+#ifndef _EDAYCOUNTBULK_H__
+#define _EDAYCOUNTBULK_H__
+
+namespace daycount {
+
+/**
+* @defgroup daycountbulk Year fractions and rate conversions on arrays of dates.
+*
+* The engine codes 4 (ACT/360) and 5 (ACT/365) are computed in bulk, their
+* year fraction being a subtraction over the whole array. The other codes
+* (30/360 and ACT/ACT variants) go through pdg_yrfDayCount one date at a
+* time, so that their month end and leap year rules stay the ones of the
+* engine. The mapping is fixed, read without a lock. Dates are Excel serials
+* after 1 March 1900.
+*/
+
+//@{
+enum day_count_basis { dbNone = 0, dbAct360 = 1, dbAct365 = 2 };
+
+//civil year, month (1 to 12) and day of Excel serial dates
+void civilDates(long n, const long *dates, long *y, long *m, long *d);
+//Excel serial of a civil date
+long serialDate(long y, long m, long d);
+//same day months later (earlier when negative), the end of the month when it is shorter
+long addMonths(long date, long months);
+
+//kernel of a day count code, dbNone when it has none
+long basisOf(long dayCount);
+
+//out[i] = year fraction from start[i] to end[i]
+void yearFractions(long dayCount, long n, const long *start, const long *end, double *out);
+//out[i] = year fraction from start to end[i]
+void yearFractions(long dayCount, long start, long n, const long *end, double *out);
+
+//rate[i] of the discount factor disc[i] from start[i] to end[i] and back, comp being 1 simple,
+//2 annually compounded, 3 continuous (the curve conventions); the rate is 0 over a null period.
+//The arrays may be the same (conversion in place)
+void discountsToRates(long dayCount, long comp, long n, const long *start, const long *end, const double *disc, double *rate);
+void ratesToDiscounts(long dayCount, long comp, long n, const long *start, const long *end, const double *rate, double *disc);
+//@}
+
+} // namespace daycount
+
+#endif // _EDAYCOUNTBULK_H__
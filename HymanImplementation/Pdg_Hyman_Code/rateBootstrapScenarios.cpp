@@ -0,0 +1,274 @@
+//rateBootstrapScenarios.cpp
+#include <cmath>
+#include <memory>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include "rateBootstrapScenarios.h"
+#include "cThreadPool.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace libor {
+
+namespace {
+   const long   SCENARIO_LANES        = 8;       // scenarios solved together
+   const double SOLVER_TOLERANCE      = 1.e-13;  // on the rate of an instrument
+   const long   SOLVER_MAX_ITERATIONS = 50;
+   const long   icConst               = 3;
+}
+
+BootstrapScenarios::BootstrapScenarios(const BootstrapCurve &curve, const std::vector<BootstrapInstrument> &instr,
+                                       const BootstrapCurve *exo)
+: curve_(curve), instruments_(instr), exo_(exo), local_(curve.local())
+{
+   const std::string errMsg("#Error in BootstrapScenarios, ");
+   curve_.setPillars(bootstrapPillars(instruments_, curve_.today()));
+   const long n = size();
+   x_.push_back(0.0);
+   for(long k = 0; k < n; ++k) x_.push_back(curve_.pillarTime(k));
+
+   stencils_.resize(n);
+   for(long k = 0; k < n; ++k) {
+      const BootstrapInstrument &in = instruments_[k];
+      Stencil &s = stencils_[k];
+      if(in.type < biDeposit || in.type > biBasisSwap) throw pdg::Error(2, errMsg + "unknown instrument type " + xtos(in.type));
+      s.type = in.type;
+      //basis swaps are left to the global solver
+      if(s.type == biBasisSwap) {
+         local_ = false;
+         continue;
+      }
+      s.yrf = in.yrf;
+      s.annuity = 0.0;
+      s.start = pointOf(curve_.time(in.start));
+      s.end = pointOf(curve_.time(in.end));
+      if(s.type != biSwap) {
+         if(s.yrf <= 0.0) throw pdg::Error(2, errMsg + "missing accrual of the instrument ending at " + xtos(in.end));
+         continue;
+      }
+      if(in.fixedDates.empty() || in.floatDates.empty() || in.fixedDates.size() != in.fixedYrf.size())
+         throw pdg::Error(2, errMsg + "inconsistent schedule of the swap ending at " + xtos(in.end));
+
+      s.fixedYrf = in.fixedYrf;
+      for(size_t i = 0; i < in.fixedDates.size(); ++i) {
+         s.fixed.push_back(pointOf(curve_.time(in.fixedDates[i])));
+         if(exo) s.annuity += in.fixedYrf[i] * exo->discount(exo->time(in.fixedDates[i]));
+      }
+      s.floating.push_back(s.start);
+      for(size_t j = 0; j < in.floatDates.size(); ++j) {
+         s.floating.push_back(pointOf(curve_.time(in.floatDates[j])));
+         if(exo) s.floatDisc.push_back(exo->discount(exo->time(in.floatDates[j])));
+      }
+   }
+
+   //a date beyond the pillar of its instrument falls on the extrapolation, left to the global solver
+   for(long k = 0; k < n && local_; ++k) {
+      const Stencil &s = stencils_[k];
+      long last = std::max(s.start.node, s.end.node);
+      for(size_t i = 0; i < s.fixed.size(); ++i) last = std::max(last, s.fixed[i].node);
+      for(size_t j = 0; j < s.floating.size(); ++j) last = std::max(last, s.floating[j].node);
+      if(last > k) local_ = false;
+   }
+}
+
+BootstrapScenarios::Point BootstrapScenarios::pointOf(double t) const
+{
+   Point p;
+   p.t = t;
+   p.node = -1;
+   p.wa = 0.0;
+   p.wb = 1.0;
+   if(t <= 0.0) return p;
+
+   const long i = static_cast<long>(std::lower_bound(x_.begin(), x_.end(), t) - x_.begin()) - 1;
+   p.node = i;
+   //beyond the last pillar, only reached through the global solver
+   if(i + 1 >= static_cast<long>(x_.size())) return p;
+   if(curve_.typeInterp() != icConst) {
+      p.wa = (x_[i + 1] - t) / (x_[i + 1] - x_[i]);
+      p.wb = 1.0 - p.wa;
+   }
+   return p;
+}
+
+void BootstrapScenarios::solve(long nScenarios, const double *quotes, double *discounts, parallel::ThreadPool &pool) const
+{
+   const long nBlocks = (nScenarios + SCENARIO_LANES - 1) / SCENARIO_LANES;
+   std::vector<std::string> errors(nBlocks);
+   std::vector<parallel::ThreadPool::task_type> tasks;
+   for(long b = 0; b < nBlocks; ++b) {
+      const long first = b * SCENARIO_LANES;
+      tasks.push_back(boost::bind(&BootstrapScenarios::solveBlock, this, first,
+                                  std::min(SCENARIO_LANES, nScenarios - first), quotes, discounts, &errors[b]));
+   }
+   pool.run(tasks);
+
+   for(long b = 0; b < nBlocks; ++b)
+      if(errors[b].size() > 0) throw pdg::Error(2, errors[b]);
+}
+
+void BootstrapScenarios::solveBlock(long first, long n, const double *quotes, double *discounts, std::string *error) const
+{
+   try {
+      if(local_) solveLocal(first, n, quotes, discounts);
+      else solveGlobal(first, n, quotes, discounts);
+   }
+   catch(pdg::Error e) {
+      *error = e.getInfo().des;
+   }
+   catch(...) {
+      *error = "#Error in BootstrapScenarios, scenarios from " + xtos(first) + " failed";
+   }
+}
+
+void BootstrapScenarios::solveLocal(long first, long lanes, const double *quotes, double *discounts) const
+{
+   const long n = size();
+   //seeds of the nodes and their derivatives by the pillar discounts, lane by lane
+   std::vector<double> y((n + 1) * SCENARIO_LANES, 0.0), dy((n + 1) * SCENARIO_LANES, 0.0);
+   //seed of today: 0 on rate * time, 1 on discount, the rate of the first pillar on rate
+   if(!curve_.rateSeed()) std::fill(y.begin(), y.begin() + SCENARIO_LANES, curve_.seedOf(1.0, 1.0));
+
+   double x[SCENARIO_LANES], market[SCENARIO_LANES], res[SCENARIO_LANES], slope[SCENARIO_LANES];
+   bool done[SCENARIO_LANES];
+   for(long k = 0; k < n; ++k) {
+      const double t = x_[k + 1];
+      double *yk = &y[(k + 1) * SCENARIO_LANES];
+      double *dyk = &dy[(k + 1) * SCENARIO_LANES];
+      for(long l = 0; l < lanes; ++l) {
+         const double quote = quotes[(first + l) * n + k];
+         market[l] = stencils_[k].type == biFuture ? 1.0 - quote : quote;
+         //flat zero rate from the previous pillar
+         x[l] = k ? std::pow(discounts[(first + l) * n + k - 1], t / x_[k]) : std::exp(-market[l] * t);
+         done[l] = false;
+      }
+
+      long iter = 0;
+      for(;;) {
+         for(long l = 0; l < lanes; ++l) {
+            yk[l] = curve_.seedOf(x[l], t);
+            dyk[l] = curve_.seedSlope(x[l], t);
+         }
+         //the rate at today is the one of the first pillar
+         if(!k && curve_.rateSeed()) std::copy(yk, yk + lanes, y.begin());
+
+         residual(k, lanes, &y[0], &dy[0], market, res, slope);
+         bool converged = true;
+         for(long l = 0; l < lanes; ++l) {
+            if(done[l]) continue;
+            if(std::fabs(res[l]) < SOLVER_TOLERANCE) {
+               done[l] = true;
+               continue;
+            }
+            if(iter == SOLVER_MAX_ITERATIONS || slope[l] == 0.0)
+               throw pdg::Error(2, "#Error in BootstrapScenarios, no convergence on the pillar " + xtos(curve_.pillarDate(k)) +
+                                   " in scenario " + xtos(first + l));
+            const double next = x[l] - res[l] / slope[l];
+            x[l] = next > 0.0 ? next : 0.5 * x[l];
+            converged = false;
+         }
+         if(converged) break;
+         ++iter;
+      }
+      for(long l = 0; l < lanes; ++l) discounts[(first + l) * n + k] = x[l];
+   }
+}
+
+void BootstrapScenarios::solveGlobal(long first, long lanes, const double *quotes, double *discounts) const
+{
+   const long n = size();
+   //the curves are not shared between threads
+   std::auto_ptr<BootstrapCurve> exo(exo_ ? new BootstrapCurve(*exo_) : 0);
+   BootstrapCurve curve(curve_);
+   BootstrapSolver solver(curve, instruments_, exo.get());
+   std::vector<double> guesses;
+   for(long l = 0; l < lanes; ++l) {
+      solver.setQuotes(quotes + (first + l) * n);
+      solver.setGuesses(guesses);
+      solver.solveGlobal();
+      guesses.resize(n);
+      for(long k = 0; k < n; ++k) guesses[k] = discounts[(first + l) * n + k] = curve.pillarDiscount(k);
+   }
+}
+
+void BootstrapScenarios::evaluate(const Point &p, long k, long lanes, const double *y, const double *dy,
+                                  double *disc, double *slope) const
+{
+   if(p.node < 0) {
+      std::fill(disc, disc + lanes, 1.0);
+      std::fill(slope, slope + lanes, 0.0);
+      return;
+   }
+   //weight of the pillar in the stencil, today's rate is the one of the first pillar
+   double w = 0.0;
+   if(p.node == k) w += p.wb;
+   if(p.node == k + 1 || (!p.node && !k && curve_.rateSeed())) w += p.wa;
+
+   const double *ya = y + p.node * SCENARIO_LANES;
+   const double *yb = ya + SCENARIO_LANES;
+   const double *dyk = dy + (k + 1) * SCENARIO_LANES;
+   for(long l = 0; l < lanes; ++l) {
+      const double s = p.wa * ya[l] + p.wb * yb[l];
+      disc[l] = curve_.discountOf(s, p.t);
+      slope[l] = w != 0.0 ? curve_.discountSlope(s, p.t) * w * dyk[l] : 0.0;
+   }
+}
+
+void BootstrapScenarios::residual(long k, long lanes, const double *y, const double *dy, const double *market,
+                                  double *res, double *slope) const
+{
+   const Stencil &s = stencils_[k];
+   double ps[SCENARIO_LANES], dps[SCENARIO_LANES], pe[SCENARIO_LANES], dpe[SCENARIO_LANES];
+   if(s.type != biSwap) {
+      evaluate(s.start, k, lanes, y, dy, ps, dps);
+      evaluate(s.end, k, lanes, y, dy, pe, dpe);
+      for(long l = 0; l < lanes; ++l) {
+         res[l] = (ps[l] / pe[l] - 1.0) / s.yrf - market[l];
+         slope[l] = (dps[l] / pe[l] - ps[l] * dpe[l] / (pe[l] * pe[l])) / s.yrf;
+      }
+      return;
+   }
+
+   const size_t nFloat = s.floating.size() - 1;
+   double floating[SCENARIO_LANES], dFloating[SCENARIO_LANES];
+   std::fill(floating, floating + lanes, 0.0);
+   std::fill(dFloating, dFloating + lanes, 0.0);
+   if(s.annuity > 0.0) {
+      evaluate(s.floating[0], k, lanes, y, dy, ps, dps);
+      for(size_t j = 0; j < nFloat; ++j) {
+         evaluate(s.floating[j + 1], k, lanes, y, dy, pe, dpe);
+         for(long l = 0; l < lanes; ++l) {
+            floating[l] += s.floatDisc[j] * (ps[l] / pe[l] - 1.0);
+            dFloating[l] += s.floatDisc[j] * (dps[l] / pe[l] - ps[l] * dpe[l] / (pe[l] * pe[l]));
+            ps[l] = pe[l];
+            dps[l] = dpe[l];
+         }
+      }
+      for(long l = 0; l < lanes; ++l) {
+         res[l] = floating[l] / s.annuity - market[l];
+         slope[l] = dFloating[l] / s.annuity;
+      }
+      return;
+   }
+
+   //discounted on the curve itself the floating leg is worth the start minus the end discount
+   double annuity[SCENARIO_LANES], dAnnuity[SCENARIO_LANES];
+   std::fill(annuity, annuity + lanes, 0.0);
+   std::fill(dAnnuity, dAnnuity + lanes, 0.0);
+   for(size_t i = 0; i < s.fixed.size(); ++i) {
+      evaluate(s.fixed[i], k, lanes, y, dy, pe, dpe);
+      for(long l = 0; l < lanes; ++l) {
+         annuity[l] += s.fixedYrf[i] * pe[l];
+         dAnnuity[l] += s.fixedYrf[i] * dpe[l];
+      }
+   }
+   evaluate(s.floating[0], k, lanes, y, dy, ps, dps);
+   evaluate(s.floating[nFloat], k, lanes, y, dy, pe, dpe);
+   for(long l = 0; l < lanes; ++l) {
+      floating[l] = ps[l] - pe[l];
+      res[l] = floating[l] / annuity[l] - market[l];
+      slope[l] = ((dps[l] - dpe[l]) * annuity[l] - floating[l] * dAnnuity[l]) / (annuity[l] * annuity[l]);
+   }
+}
+
+} // namespace libor
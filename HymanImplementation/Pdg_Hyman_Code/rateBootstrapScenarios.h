@@ -0,0 +1,82 @@
+//rateBootstrapScenarios.h
+#ifndef _RATEBOOTSTRAPSCENARIOS_H__
+#define _RATEBOOTSTRAPSCENARIOS_H__
+
+#include <string>
+#include <vector>
+#include "rateBootstrapSolver.h"
+
+namespace parallel { class ThreadPool; }
+
+namespace libor {
+
+/**
+* @defgroup bootstrapscenarios Bootstrap of one curve under many sets of quotes.
+*
+* Times, accruals and exogenous discounts of the instruments, and where each
+* of their dates falls between the pillars, are computed once for all the
+* scenarios. The scenarios are solved in blocks of SCENARIO_LANES, the blocks
+* in parallel. With linear and constant interpolation the pillars of a block
+* are solved together: the newton steps of a pillar run over the scenarios of
+* the block in the innermost loop, on seeds stored scenario by scenario.
+* With the spline (or when an instrument fixes beyond its pillar) each block
+* builds one BootstrapSolver and solves its scenarios globally, each one
+* starting from the solution of the previous one.
+*/
+
+//@{
+class BootstrapScenarios
+{
+public:
+   //instruments sorted by end date, curve gives the conventions, exo (if any) is the discounting curve of the swaps
+   BootstrapScenarios(const BootstrapCurve &curve, const std::vector<BootstrapInstrument> &instr, const BootstrapCurve *exo = 0);
+
+   //quotes[s * size() + j] is the quote of instrument j in scenario s, the solved discount
+   //of pillar k in scenario s goes to discounts[s * size() + k]
+   void solve(long nScenarios, const double *quotes, double *discounts, parallel::ThreadPool &pool) const;
+
+   long size() const { return static_cast<long>(instruments_.size()); }
+   const BootstrapCurve &curve() const { return curve_; }
+
+private:
+   //date between the nodes node and node + 1 of the curve (today is node 0) with their weights, node < 0 up to today
+   struct Point {
+      long node;
+      double t;
+      double wa;
+      double wb;
+   };
+   //an instrument on the interpolation stencil
+   struct Stencil {
+      long type;
+      double yrf;
+      Point start;
+      Point end;
+      std::vector<Point> fixed;
+      std::vector<double> fixedYrf;
+      std::vector<Point> floating;        // period bounds, the start first
+      std::vector<double> floatDisc;      // exogenous discounts of the floating payments
+      double annuity;                     // exogenous annuity, 0 without exogenous curve
+   };
+
+   Point pointOf(double t) const;
+   void solveBlock(long first, long n, const double *quotes, double *discounts, std::string *error) const;
+   void solveLocal(long first, long n, const double *quotes, double *discounts) const;
+   void solveGlobal(long first, long n, const double *quotes, double *discounts) const;
+   //discounts at p of the lanes and their derivatives by the discount of pillar k
+   void evaluate(const Point &p, long k, long lanes, const double *y, const double *dy, double *disc, double *slope) const;
+   //model minus market rate of instrument k on the lanes and its derivative by the discount of pillar k
+   void residual(long k, long lanes, const double *y, const double *dy, const double *market, double *res, double *slope) const;
+
+   BootstrapCurve curve_;
+   std::vector<BootstrapInstrument> instruments_;
+   const BootstrapCurve *exo_;
+   std::vector<Stencil> stencils_;
+   std::vector<double> x_;                // node times, today first
+   bool local_;
+};
+//@}
+
+} // namespace libor
+
+#endif // _RATEBOOTSTRAPSCENARIOS_H__
@@ -0,0 +1,126 @@
+//rateBootstrapScheduler.cpp
+#include <map>
+#include <cctype>
+#include <boost/bind.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "rateBootstrapScheduler.h"
+#include "cError.h"
+
+namespace libor {
+
+namespace {
+   std::string upper(const std::string &name)
+   {
+      std::string res(name);
+      for(std::string::iterator it = res.begin(); it != res.end(); ++it) *it = static_cast<char>(toupper(*it));
+      return res;
+   }
+}
+
+//completion count of a run, shared by its tasks
+struct BootstrapScheduler::RunState {
+   boost::mutex mutex;
+   boost::condition_variable done;
+   long remaining;
+};
+
+BootstrapScheduler::BootstrapScheduler(const std::vector<std::string> &names, const std::vector<std::vector<std::string> > &deps)
+: dependents_(names.size()), nDeps_(names.size(), 0), status_(names.size(), stWaiting),
+  messages_(names.size()), names_(names)
+{
+   const long n = static_cast<long>(names.size());
+   if(static_cast<long>(deps.size()) != n) throw pdg::Error(2, "#Error in BootstrapScheduler, one dependency list per curve is needed");
+
+   std::map<std::string, long> index;
+   for(long i = 0; i < n; ++i)
+      if(!index.insert(std::make_pair(upper(names[i]), i)).second)
+         throw pdg::Error(2, "#Error in BootstrapScheduler, curve " + names[i] + " appears twice in the batch");
+
+   for(long i = 0; i < n; ++i) {
+      for(size_t k = 0; k < deps[i].size(); ++k) {
+         std::map<std::string, long>::const_iterator it = index.find(upper(deps[i][k]));
+         if(it == index.end() || it->second == i) continue; // already in shared memory
+         dependents_[it->second].push_back(i);
+         ++nDeps_[i];
+      }
+   }
+
+   //topological order, a curve left out belongs to a cycle
+   std::vector<long> left(nDeps_);
+   for(long i = 0; i < n; ++i)
+      if(!left[i]) order_.push_back(i);
+   for(size_t k = 0; k < order_.size(); ++k)
+      for(size_t d = 0; d < dependents_[order_[k]].size(); ++d)
+         if(!--left[dependents_[order_[k]][d]]) order_.push_back(dependents_[order_[k]][d]);
+   if(static_cast<long>(order_.size()) != n) {
+      std::string cycle;
+      for(long i = 0; i < n; ++i)
+         if(left[i]) cycle += (cycle.empty() ? "" : ", ") + names[i];
+      throw pdg::Error(2, "#Error in BootstrapScheduler, circular dependency among curves " + cycle);
+   }
+}
+
+void BootstrapScheduler::execute(BootstrapScheduler *self, parallel::ThreadPool *pool, const task_type *task, RunState *state, long i)
+{
+   std::string msg;
+   bool ok = false;
+   try {
+      ok = (*task)(i, msg);
+   }
+   catch(pdg::Error e) {
+      msg = e.getInfo().des;
+   }
+   catch(...) {
+      msg = "unexpected error";
+   }
+
+   std::vector<long> ready;
+   long completed = 0;
+   {
+      boost::mutex::scoped_lock lock(self->mutex_);
+      std::vector<long> stack(1, i);
+      self->status_[i] = ok ? stDone : stFailed;
+      self->messages_[i] = msg;
+      ++completed;
+      while(!stack.empty()) {
+         const long j = stack.back();
+         stack.pop_back();
+         for(size_t d = 0; d < self->dependents_[j].size(); ++d) {
+            const long dep = self->dependents_[j][d];
+            if(self->status_[dep] != stWaiting) continue;
+            if(ok) {
+               if(!--self->nDeps_[dep]) ready.push_back(dep);
+            }
+            else {
+               self->status_[dep] = stFailed;
+               self->messages_[dep] = "curve " + self->names_[i] + " failed: " + msg;
+               stack.push_back(dep);
+               ++completed;
+            }
+         }
+      }
+   }
+   for(size_t k = 0; k < ready.size(); ++k)
+      pool->submit(boost::bind(&BootstrapScheduler::execute, self, pool, task, state, ready[k]));
+
+   boost::mutex::scoped_lock lock(state->mutex);
+   state->remaining -= completed;
+   if(!state->remaining) state->done.notify_all();
+}
+
+void BootstrapScheduler::run(parallel::ThreadPool &pool, const task_type &task)
+{
+   RunState state;
+   state.remaining = static_cast<long>(names_.size());
+
+   std::vector<long> roots;
+   for(size_t i = 0; i < nDeps_.size(); ++i)
+      if(!nDeps_[i]) roots.push_back(static_cast<long>(i));
+   for(size_t k = 0; k < roots.size(); ++k)
+      pool.submit(boost::bind(&BootstrapScheduler::execute, this, &pool, &task, &state, roots[k]));
+
+   boost::mutex::scoped_lock lock(state.mutex);
+   while(state.remaining) state.done.wait(lock);
+}
+
+} // namespace libor
@@ -0,0 +1,60 @@
+//rateBootstrapScheduler.h
+#ifndef _RATEBOOTSTRAPSCHEDULER_H__
+#define _RATEBOOTSTRAPSCHEDULER_H__
+
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include "cThreadPool.h"
+
+namespace libor {
+
+/**
+* @defgroup bootstrapscheduler Dependency ordered bootstrap of a set of curves.
+*
+* A curve depends on the curves it reads from shared memory: its exogenous
+* discounting curve (DiscCurveName) and, for spread curves, its backbone.
+* Dependencies on curves outside the batch are assumed to be already
+* published. Curves are started as soon as all their dependencies in the
+* batch have completed; when one fails, the curves depending on it are not
+* bootstrapped and report the failure.
+*/
+
+//@{
+class BootstrapScheduler
+{
+public:
+   //task of a curve, returns false (and fills the message) on failure
+   typedef boost::function<bool(long, std::string &)> task_type;
+
+   //names are compared upper case, deps[i] are the names curve i depends on
+   BootstrapScheduler(const std::vector<std::string> &names, const std::vector<std::vector<std::string> > &deps);
+
+   //runs every curve on the pool, blocks until all completed (or were skipped)
+   void run(parallel::ThreadPool &pool, const task_type &task);
+
+   bool succeeded(long i) const { return status_[i] == stDone; }
+   const std::string &message(long i) const { return messages_[i]; }
+   //curves in an order compatible with the dependencies
+   const std::vector<long> &order() const { return order_; }
+
+private:
+   enum status_type { stWaiting, stDone, stFailed };
+   struct RunState;
+
+   static void execute(BootstrapScheduler *self, parallel::ThreadPool *pool, const task_type *task, RunState *state, long i);
+
+   std::vector<std::vector<long> > dependents_;
+   std::vector<long> nDeps_;
+   std::vector<long> order_;
+   std::vector<status_type> status_;
+   std::vector<std::string> messages_;
+   std::vector<std::string> names_;
+   boost::mutex mutex_;
+};
+//@}
+
+} // namespace libor
+
+#endif // _RATEBOOTSTRAPSCHEDULER_H__
@@ -0,0 +1,688 @@
+//rateBootstrapSolver.cpp
+#include <cmath>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "rateBootstrapSolver.h"
+#include "cCashflowGrid.h"
+#include "cShmCurveBlock.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace libor {
+
+namespace {
+   enum seed_type { stRate = 1, stRateTime = 2, stDiscount = 3 };
+
+   enum interp_code { icLinear = 1, icConst = 3, icSpline = 4 };
+
+   const double SOLVER_TOLERANCE      = 1.e-13;  // on the rate of an instrument
+   const long   SOLVER_MAX_ITERATIONS = 50;
+   const double PASS_TOLERANCE        = 1.e-13;  // relative move of a pillar between two passes
+   const long   SOLVER_MAX_PASSES     = 100;
+   const long   GLOBAL_MAX_ITERATIONS = 30;
+
+   //discounts of a curve on ascending dates, for a cash flow grid
+   void curveDiscounts(const BootstrapCurve *curve, long, const long *dates, long n, double *out)
+   {
+      curve->discountsOn(dates, n, out);
+   }
+
+   //discount of exo on date, read in the grid when there is one
+   double exoDiscount(const BootstrapCurve &exo, const CashflowGrid *grid, const std::vector<double> *discs, long date, double t)
+   {
+      if(!grid) return exo.discount(t);
+      const long slot = grid->find(0, date);
+      return slot < 0 ? exo.discount(t) : (*discs)[slot];
+   }
+
+   double secondsSince(const boost::posix_time::ptime &start)
+   {
+      return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1.e-6;
+   }
+
+   double discountToRate(double disc, double t, long comp)
+   {
+      switch(comp) {
+         case 1: return (1.0 / disc - 1.0) / t;
+         case 2: return std::pow(disc, -1.0 / t) - 1.0;
+         default: return -std::log(disc) / t;
+      }
+   }
+
+   double rateToDiscount(double rate, double t, long comp)
+   {
+      switch(comp) {
+         case 1: return 1.0 / (1.0 + rate * t);
+         case 2: return std::pow(1.0 + rate, -t);
+         default: return std::exp(-rate * t);
+      }
+   }
+
+   //in place LU decomposition with partial pivoting of the row major n x n matrix a
+   void luDecompose(std::vector<double> &a, long n, std::vector<long> &piv)
+   {
+      piv.resize(n);
+      for(long j = 0; j < n; ++j) {
+         long p = j;
+         for(long i = j + 1; i < n; ++i)
+            if(std::fabs(a[i * n + j]) > std::fabs(a[p * n + j])) p = i;
+         if(a[p * n + j] == 0.0) throw pdg::Error(2, "#Error in luDecompose, singular jacobian");
+         piv[j] = p;
+         if(p != j) std::swap_ranges(a.begin() + j * n, a.begin() + (j + 1) * n, a.begin() + p * n);
+         const double pivot = a[j * n + j];
+         for(long i = j + 1; i < n; ++i) {
+            const double f = (a[i * n + j] /= pivot);
+            if(f != 0.0)
+               for(long k = j + 1; k < n; ++k) a[i * n + k] -= f * a[j * n + k];
+         }
+      }
+   }
+
+   //solves in place a x = b from the decomposition of a
+   void luSolve(const std::vector<double> &a, long n, const std::vector<long> &piv, double *b)
+   {
+      for(long j = 0; j < n; ++j) {
+         if(piv[j] != j) std::swap(b[j], b[piv[j]]);
+         for(long i = j + 1; i < n; ++i) b[i] -= a[i * n + j] * b[j];
+      }
+      for(long i = n - 1; i >= 0; --i) {
+         for(long k = i + 1; k < n; ++k) b[i] -= a[i * n + k] * b[k];
+         b[i] /= a[i * n + i];
+      }
+   }
+}
+
+BootstrapInstrument::BootstrapInstrument()
+: type(biDeposit), quote(0.), start(0), end(0), yrf(0.), otherLeg(0.)
+{}
+
+bool BootstrapInstrument::sameTerms(const BootstrapInstrument &other) const
+{
+   return type == other.type && start == other.start && end == other.end && yrf == other.yrf &&
+          fixedDates == other.fixedDates && fixedYrf == other.fixedYrf && floatDates == other.floatDates &&
+          floatYrf == other.floatYrf && floatFixings == other.floatFixings && otherLeg == other.otherLeg;
+}
+
+BootstrapCurve::BootstrapCurve(long today, long typeInterp, long interpOn, long comp, long dayCount)
+: today_(today), typeInterp_(typeInterp), interpOn_(interpOn), seed_(interpOn % 20), comp_(comp), dayCount_(dayCount), active_(0),
+  x_(1, 0.0), dirty_(true), momentsActive_(-1)
+{
+   if(typeInterp_ != icLinear && typeInterp_ != icConst && typeInterp_ != icSpline)
+      throw pdg::Error(2, "#Error in BootstrapCurve, interpolation type " + xtos(typeInterp) + " not supported by the bootstrap solver");
+   if(seed_ < stRate || seed_ > stDiscount)
+      throw pdg::Error(2, "#Error in BootstrapCurve, interpolation seed " + xtos(interpOn) + " not supported by the bootstrap solver");
+}
+
+BootstrapCurve::BootstrapCurve(const BootstrapCurve &other, long typeInterp)
+: today_(other.today_), typeInterp_(typeInterp), interpOn_(other.interpOn_), seed_(other.seed_), comp_(other.comp_),
+  dayCount_(other.dayCount_), active_(other.active_), dates_(other.dates_), disc_(other.disc_), x_(other.x_),
+  dirty_(true), momentsActive_(-1)
+{
+   if(typeInterp_ != icLinear && typeInterp_ != icConst && typeInterp_ != icSpline)
+      throw pdg::Error(2, "#Error in BootstrapCurve, interpolation type " + xtos(typeInterp) + " not supported by the bootstrap solver");
+}
+
+void BootstrapCurve::setPillars(const std::vector<long> &dates)
+{
+   dates_ = dates;
+   disc_.assign(dates.size(), 1.0);
+   x_.assign(1, 0.0);
+   for(size_t k = 0; k < dates.size(); ++k) {
+      x_.push_back(time(dates[k]));
+      if(x_[k + 1] <= x_[k]) throw pdg::Error(2, "#Error in BootstrapCurve, pillar dates must be increasing and after today");
+   }
+   active_ = size();
+   dirty_ = true;
+   momentsActive_ = -1;
+}
+
+void BootstrapCurve::setDiscount(long k, double disc)
+{
+   disc_[k] = disc;
+   dirty_ = true;
+}
+
+void BootstrapCurve::setActive(long n)
+{
+   active_ = std::min(std::max(n, 0L), size());
+   dirty_ = true;
+}
+
+bool BootstrapCurve::local() const
+{
+   return typeInterp_ != icSpline;
+}
+
+double BootstrapCurve::time(long date) const
+{
+   return shm_curve::blockYearFraction(dayCount_, today_, date);
+}
+
+double BootstrapCurve::seedOf(double disc, double t) const
+{
+   switch(seed_) {
+      case stRate:     return discountToRate(disc, t, comp_);
+      case stRateTime: return discountToRate(disc, t, comp_) * t;
+      default:         return disc;
+   }
+}
+
+double BootstrapCurve::seedSlope(double disc, double t) const
+{
+   if(seed_ == stDiscount) return 1.0;
+   double slope;
+   switch(comp_) {
+      case 1:  slope = -1.0 / (disc * disc * t); break;
+      case 2:  slope = -std::pow(disc, -1.0 / t - 1.0) / t; break;
+      default: slope = -1.0 / (disc * t);
+   }
+   return seed_ == stRateTime ? slope * t : slope;
+}
+
+double BootstrapCurve::discountOf(double y, double t) const
+{
+   switch(seed_) {
+      case stRate:     return rateToDiscount(y, t, comp_);
+      case stRateTime: return rateToDiscount(y / t, t, comp_);
+      default:         return y;
+   }
+}
+
+double BootstrapCurve::discountSlope(double y, double t) const
+{
+   if(seed_ == stDiscount) return 1.0;
+   const double rate = seed_ == stRateTime ? y / t : y;
+   const double disc = rateToDiscount(rate, t, comp_);
+   double slope;
+   switch(comp_) {
+      case 1:  slope = -t * disc * disc; break;
+      case 2:  slope = -t * disc / (1.0 + rate); break;
+      default: slope = -t * disc;
+   }
+   return seed_ == stRateTime ? slope / t : slope;
+}
+
+void BootstrapCurve::prepare() const
+{
+   if(!dirty_) return;
+   const long nodes = size() + 1;
+   y_.resize(nodes);
+   dy_.assign(nodes, 0.0);
+   for(long k = 1; k < nodes; ++k) {
+      y_[k] = seedOf(disc_[k - 1], x_[k]);
+      dy_[k] = seedSlope(disc_[k - 1], x_[k]);
+   }
+   //the rate at today is not defined, it is taken from the first pillar
+   y_[0] = seed_ == stRate ? (nodes > 1 ? y_[1] : 0.0) : (seed_ == stRateTime ? 0.0 : 1.0);
+
+   if(typeInterp_ == icSpline) {
+      const long n = active_ + 1;
+      if(momentsActive_ != active_) {
+         //the second derivatives are linear in the seeds: one Thomas solve per seed
+         s_.assign(n * n, 0.0);
+         std::vector<double> sup(n, 0.0), den(n, 1.0), col(n);
+         for(long i = 1; i < n - 1; ++i) {
+            const double h0 = x_[i] - x_[i - 1], h1 = x_[i + 1] - x_[i];
+            den[i] = 2.0 * (h0 + h1) - h0 * sup[i - 1];
+            sup[i] = h1 / den[i];
+         }
+         for(long k = 0; k < n && n > 2; ++k) {
+            col.assign(n, 0.0);
+            for(long i = 1; i < n - 1; ++i) {
+               const double h0 = x_[i] - x_[i - 1], h1 = x_[i + 1] - x_[i];
+               double rhs = 0.0;
+               if(k == i - 1) rhs = 6.0 / h0;
+               else if(k == i) rhs = -6.0 * (1.0 / h0 + 1.0 / h1);
+               else if(k == i + 1) rhs = 6.0 / h1;
+               col[i] = (rhs - h0 * col[i - 1]) / den[i];
+            }
+            for(long i = n - 2; i > 0; --i) col[i] -= sup[i] * col[i + 1];
+            for(long i = 0; i < n; ++i) s_[i * n + k] = col[i];
+         }
+         momentsActive_ = active_;
+      }
+      m_.assign(n, 0.0);
+      for(long i = 1; i < n - 1; ++i)
+         for(long k = 0; k < n; ++k) m_[i] += s_[i * n + k] * y_[k];
+   }
+   dirty_ = false;
+}
+
+double BootstrapCurve::discount(double t, double *grad, double scale) const
+{
+   if(t <= 0.0 || !active_) return 1.0;
+   prepare();
+
+   const long n = active_ + 1;
+   const double tn = x_[n - 1];
+   if(t > tn) {
+      //flat zero rate beyond the last pillar
+      const double last = disc_[active_ - 1];
+      const double e = t / tn;
+      const double disc = std::pow(last, e);
+      if(grad) grad[active_ - 1] += scale * e * disc / last;
+      return disc;
+   }
+
+   const long i = static_cast<long>(std::lower_bound(x_.begin(), x_.begin() + n, t) - x_.begin()) - 1;
+   return interpolate(i, t, grad, scale);
+}
+
+void BootstrapCurve::discounts(const double *t, long n, double *out) const
+{
+   if(!active_) {
+      std::fill(out, out + n, 1.0);
+      return;
+   }
+   prepare();
+
+   const double tn = x_[active_];
+   long i = 0;
+   for(long k = 0; k < n; ++k) {
+      if(t[k] <= 0.0 || t[k] > tn) {
+         out[k] = discount(t[k]);
+         continue;
+      }
+      if(k && t[k] < t[k - 1]) i = 0; // not ordered: restart the walk
+      while(x_[i + 1] < t[k]) ++i;
+      out[k] = interpolate(i, t[k], 0, 1.0);
+   }
+}
+
+void BootstrapCurve::discountsOn(const long *dates, long n, double *out) const
+{
+   if(n <= 0) return;
+   std::vector<double> t(n);
+   for(long i = 0; i < n; ++i) t[i] = time(dates[i]);
+   discounts(&t[0], n, out);
+}
+
+double BootstrapCurve::interpolate(long i, double t, double *grad, double scale) const
+{
+   const long n = active_ + 1;
+   const double h = x_[i + 1] - x_[i];
+   const double a = (x_[i + 1] - t) / h;
+   const double b = 1.0 - a;
+   double wa = 0.0, wb = 1.0, ca = 0.0, cb = 0.0;
+   if(typeInterp_ != icConst) {
+      wa = a;
+      wb = b;
+   }
+   double y = wa * y_[i] + wb * y_[i + 1];
+   if(typeInterp_ == icSpline) {
+      ca = (a * a * a - a) * h * h / 6.0;
+      cb = (b * b * b - b) * h * h / 6.0;
+      y += ca * m_[i] + cb * m_[i + 1];
+   }
+   const double disc = discountOf(y, t);
+
+   if(grad) {
+      const double g = scale * discountSlope(y, t);
+      //weight of node k goes to its pillar, today's rate is the one of the first pillar
+      #define ADD_NODE(k, w) { const long node_ = (k); const double w_ = (w); \
+         if(node_ > 0) grad[node_ - 1] += g * w_ * dy_[node_]; \
+         else if(seed_ == stRate) grad[0] += g * w_ * dy_[1]; }
+      ADD_NODE(i, wa);
+      ADD_NODE(i + 1, wb);
+      if(typeInterp_ == icSpline)
+         for(long k = 0; k < n; ++k) ADD_NODE(k, ca * s_[i * n + k] + cb * s_[(i + 1) * n + k]);
+      #undef ADD_NODE
+   }
+   return disc;
+}
+
+BootstrapResidual::BootstrapResidual(const BootstrapInstrument &instr, const BootstrapCurve &curve, const BootstrapCurve *exo,
+                                     const CashflowGrid *exoGrid, const std::vector<double> *exoDiscs)
+: type_(instr.type), market_(instr.marketRate()), tStart_(curve.time(instr.start)), tEnd_(curve.time(instr.end)),
+  yrf_(instr.yrf), exogenous_(exo != 0), otherLeg_(instr.otherLeg)
+{
+   const std::string errMsg("#Error in BootstrapResidual, ");
+   if(type_ < biDeposit || type_ > biBasisSwap) throw pdg::Error(2, errMsg + "unknown instrument type " + xtos(type_));
+   if(type_ == biBasisSwap) {
+      if(instr.floatDates.empty() || instr.floatDates.size() != instr.floatYrf.size() ||
+         instr.floatDates.size() != instr.floatFixings.size())
+         throw pdg::Error(2, errMsg + "inconsistent schedule of the basis swap ending at " + xtos(instr.end));
+      exogenous_ = false;
+      floatYrf_ = instr.floatYrf;
+      fixings_ = instr.floatFixings;
+      floatT_.push_back(tStart_);
+      for(size_t j = 0; j < instr.floatDates.size(); ++j) floatT_.push_back(curve.time(instr.floatDates[j]));
+      return;
+   }
+   if(type_ != biSwap) {
+      if(yrf_ <= 0.0) throw pdg::Error(2, errMsg + "missing accrual of the instrument ending at " + xtos(instr.end));
+      return;
+   }
+   if(instr.fixedDates.empty() || instr.floatDates.empty() || instr.fixedDates.size() != instr.fixedYrf.size())
+      throw pdg::Error(2, errMsg + "inconsistent schedule of the swap ending at " + xtos(instr.end));
+
+   fixedYrf_ = instr.fixedYrf;
+   for(size_t i = 0; i < instr.fixedDates.size(); ++i) fixedT_.push_back(curve.time(instr.fixedDates[i]));
+   floatT_.push_back(tStart_);
+   for(size_t j = 0; j < instr.floatDates.size(); ++j) floatT_.push_back(curve.time(instr.floatDates[j]));
+   if(exo) {
+      for(size_t i = 0; i < fixedT_.size(); ++i) {
+         fixedExoT_.push_back(exo->time(instr.fixedDates[i]));
+         fixedDisc_.push_back(exoDiscount(*exo, exoGrid, exoDiscs, instr.fixedDates[i], fixedExoT_[i]));
+      }
+      for(size_t j = 0; j < instr.floatDates.size(); ++j) {
+         floatExoT_.push_back(exo->time(instr.floatDates[j]));
+         floatDisc_.push_back(exoDiscount(*exo, exoGrid, exoDiscs, instr.floatDates[j], floatExoT_[j]));
+      }
+   }
+}
+
+double BootstrapResidual::operator()(const BootstrapCurve &curve, double *grad) const
+{
+   if(type_ == biBasisSwap) {
+      //spread that makes the leg, notionals exchanged, worth the other one
+      const size_t nFloat = floatYrf_.size();
+      double annuity = 0.0, value = otherLeg_ + curve.discount(floatT_[0]) - curve.discount(floatT_[nFloat]);
+      for(size_t j = 0; j < nFloat; ++j) {
+         const double disc = curve.discount(floatT_[j + 1]);
+         annuity += floatYrf_[j] * disc;
+         value -= fixings_[j] * disc;
+      }
+      const double spread = value / annuity;
+      if(grad) {
+         curve.discount(floatT_[0], grad, 1.0 / annuity);
+         curve.discount(floatT_[nFloat], grad, -1.0 / annuity);
+         for(size_t j = 0; j < nFloat; ++j)
+            curve.discount(floatT_[j + 1], grad, -(fixings_[j] + spread * floatYrf_[j]) / annuity);
+      }
+      return spread - market_;
+   }
+   if(type_ != biSwap) {
+      const double ps = curve.discount(tStart_);
+      const double pe = curve.discount(tEnd_);
+      if(grad) {
+         curve.discount(tStart_, grad, 1.0 / (pe * yrf_));
+         curve.discount(tEnd_, grad, -ps / (pe * pe * yrf_));
+      }
+      return (ps / pe - 1.0) / yrf_ - market_;
+   }
+
+   const size_t nFixed = fixedT_.size();
+   const size_t nFloat = floatT_.size() - 1;
+   double annuity = 0.0, floating = 0.0;
+   if(exogenous_) {
+      for(size_t i = 0; i < nFixed; ++i) annuity += fixedYrf_[i] * fixedDisc_[i];
+      double ps = curve.discount(floatT_[0]);
+      for(size_t j = 0; j < nFloat; ++j) {
+         const double pe = curve.discount(floatT_[j + 1]);
+         floating += floatDisc_[j] * (ps / pe - 1.0);
+         if(grad) {
+            curve.discount(floatT_[j], grad, floatDisc_[j] / (pe * annuity));
+            curve.discount(floatT_[j + 1], grad, -floatDisc_[j] * ps / (pe * pe * annuity));
+         }
+         ps = pe;
+      }
+      return floating / annuity - market_;
+   }
+
+   //discounted on the curve itself the floating leg is worth the start minus the end discount
+   for(size_t i = 0; i < nFixed; ++i) annuity += fixedYrf_[i] * curve.discount(fixedT_[i]);
+   floating = curve.discount(floatT_[0]) - curve.discount(floatT_[nFloat]);
+   if(grad) {
+      curve.discount(floatT_[0], grad, 1.0 / annuity);
+      curve.discount(floatT_[nFloat], grad, -1.0 / annuity);
+      const double dA = -floating / (annuity * annuity);
+      for(size_t i = 0; i < nFixed; ++i) curve.discount(fixedT_[i], grad, dA * fixedYrf_[i]);
+   }
+   return floating / annuity - market_;
+}
+
+void BootstrapResidual::exoGradient(const BootstrapCurve &curve, const BootstrapCurve &exo, double *grad) const
+{
+   if(type_ != biSwap || !exogenous_) return;
+
+   double annuity = 0.0, floating = 0.0;
+   for(size_t i = 0; i < fixedDisc_.size(); ++i) annuity += fixedYrf_[i] * fixedDisc_[i];
+   for(size_t j = 0; j < floatDisc_.size(); ++j) {
+      const double fwd = curve.discount(floatT_[j]) / curve.discount(floatT_[j + 1]) - 1.0;
+      floating += floatDisc_[j] * fwd;
+      exo.discount(floatExoT_[j], grad, fwd / annuity);
+   }
+   const double dA = -floating / (annuity * annuity);
+   for(size_t i = 0; i < fixedDisc_.size(); ++i) exo.discount(fixedExoT_[i], grad, dA * fixedYrf_[i]);
+}
+
+BootstrapStats::BootstrapStats()
+: firstSolved(0), passes(0), iterations(0), globalIterations(0), warmStarted(0), maxResidual(0.), globalSeconds(0.)
+{}
+
+std::vector<long> bootstrapPillars(const std::vector<BootstrapInstrument> &instr, long today)
+{
+   std::vector<long> pillars;
+   for(size_t i = 0; i < instr.size(); ++i) {
+      if(instr[i].end <= today) throw pdg::Error(2, "#Error in bootstrapPillars, instrument ending at " + xtos(instr[i].end) + " is expired");
+      if(!pillars.empty() && instr[i].end <= pillars.back())
+         throw pdg::Error(2, "#Error in bootstrapPillars, two instruments end at " + xtos(instr[i].end) + " or are not sorted");
+      pillars.push_back(instr[i].end);
+   }
+   return pillars;
+}
+
+BootstrapSolver::BootstrapSolver(BootstrapCurve &curve, const std::vector<BootstrapInstrument> &instr, const BootstrapCurve *exo)
+: curve_(curve), exo_(exo), timed_(false)
+{
+   curve_.setPillars(bootstrapPillars(instr, curve_.today()));
+   //the swaps share most of their payment dates: the exogenous curve is evaluated once on the distinct ones
+   CashflowGrid grid;
+   std::vector<double> exoDiscs;
+   if(exo) {
+      for(size_t i = 0; i < instr.size(); ++i) {
+         if(instr[i].type != biSwap) continue;
+         for(size_t j = 0; j < instr[i].fixedDates.size(); ++j) grid.add(0, instr[i].fixedDates[j]);
+         for(size_t j = 0; j < instr[i].floatDates.size(); ++j) grid.add(0, instr[i].floatDates[j]);
+      }
+      grid.compile();
+      grid.evaluate(boost::bind(&curveDiscounts, exo, _1, _2, _3, _4), exoDiscs);
+   }
+   for(size_t i = 0; i < instr.size(); ++i)
+      residuals_.push_back(BootstrapResidual(instr[i], curve_, exo, exo ? &grid : 0, &exoDiscs));
+   grad_.resize(instr.size());
+}
+
+void BootstrapSolver::setQuotes(const double *quotes)
+{
+   for(long i = 0; i < size(); ++i) residuals_[i].setQuote(quotes[i]);
+}
+
+double BootstrapSolver::initialGuess(const BootstrapCurve &curve, long k) const
+{
+   if(warm(k)) return guesses_[k];
+   const double t = curve.pillarTime(k);
+   if(!k) return std::exp(-residuals_[k].marketRate() * t);
+   //flat zero rate from the previous pillar
+   return std::pow(curve.pillarDiscount(k - 1), t / curve.pillarTime(k - 1));
+}
+
+long BootstrapSolver::timedPillar(BootstrapCurve &curve, long k, double guess, double &residual)
+{
+   if(!timed_) return solvePillar(curve, k, guess, residual);
+   const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+   const long iter = solvePillar(curve, k, guess, residual);
+   stats_.pillarSeconds[k] += secondsSince(start);
+   return iter;
+}
+
+long BootstrapSolver::solvePillar(BootstrapCurve &curve, long k, double guess, double &residual)
+{
+   long iter = 0;
+   double x = guess;
+   curve.setDiscount(k, x);
+   for(;;) {
+      std::fill(grad_.begin(), grad_.end(), 0.0);
+      residual = residuals_[k](curve, &grad_[0]);
+      if(std::fabs(residual) < SOLVER_TOLERANCE) return iter;
+      if(iter == SOLVER_MAX_ITERATIONS || grad_[k] == 0.0)
+         throw pdg::Error(2, "#Error in BootstrapSolver, no convergence on the pillar " + xtos(curve.pillarDate(k)));
+      double next = x - residual / grad_[k];
+      if(next <= 0.0) next = 0.5 * x;
+      x = next;
+      curve.setDiscount(k, x);
+      ++iter;
+   }
+}
+
+double BootstrapSolver::residuals(std::vector<double> &res, std::vector<double> *jac)
+{
+   const long n = size();
+   double maxResidual = 0.0;
+   res.resize(n);
+   if(jac) jac->assign(n * n, 0.0);
+   for(long i = 0; i < n; ++i) {
+      res[i] = residuals_[i](curve_, jac ? &(*jac)[i * n] : 0);
+      maxResidual = std::max(maxResidual, std::fabs(res[i]));
+   }
+   return maxResidual;
+}
+
+void BootstrapSolver::solve(long first)
+{
+   const long n = size();
+   stats_ = BootstrapStats();
+   stats_.firstSolved = first;
+   stats_.pillarIterations.assign(n, 0);
+   stats_.pillarResiduals.assign(n, 0.0);
+   if(timed_) stats_.pillarSeconds.assign(n, 0.0);
+
+   double residual;
+   for(long k = first; k < n; ++k) {
+      curve_.setActive(k + 1);
+      if(warm(k)) ++stats_.warmStarted;
+      stats_.pillarIterations[k] += timedPillar(curve_, k, initialGuess(curve_, k), residual);
+   }
+   curve_.setActive(n);
+   stats_.passes = 1;
+
+   //with a non local interpolation the later pillars have moved the earlier ones
+   if(!curve_.local()) {
+      double move = 1.0;
+      while(move > PASS_TOLERANCE) {
+         if(stats_.passes == SOLVER_MAX_PASSES) throw pdg::Error(2, "#Error in BootstrapSolver, the sequential passes do not converge");
+         move = 0.0;
+         for(long k = first; k < n; ++k) {
+            const double old = curve_.pillarDiscount(k);
+            stats_.pillarIterations[k] += timedPillar(curve_, k, old, residual);
+            move = std::max(move, std::fabs(curve_.pillarDiscount(k) / old - 1.0));
+         }
+         ++stats_.passes;
+      }
+   }
+
+   for(long k = 0; k < n; ++k) {
+      stats_.iterations += stats_.pillarIterations[k];
+      stats_.pillarResiduals[k] = residuals_[k](curve_);
+      stats_.maxResidual = std::max(stats_.maxResidual, std::fabs(stats_.pillarResiduals[k]));
+   }
+}
+
+void BootstrapSolver::solveGlobal()
+{
+   const long n = size();
+   stats_ = BootstrapStats();
+   stats_.pillarIterations.assign(n, 0);
+   if(timed_) stats_.pillarSeconds.assign(n, 0.0);
+
+   for(long k = 0; k < n; ++k)
+      if(warm(k)) ++stats_.warmStarted;
+   curve_.setActive(n);
+   if(stats_.warmStarted == n) {
+      for(long k = 0; k < n; ++k) curve_.setDiscount(k, guesses_[k]);
+   }
+   else {
+      //starting point: sequential bootstrap with linear interpolation of the same seed
+      BootstrapCurve linear(curve_, icLinear);
+      double residual;
+      for(long k = 0; k < n; ++k) {
+         linear.setActive(k + 1);
+         stats_.pillarIterations[k] += timedPillar(linear, k, initialGuess(linear, k), residual);
+         stats_.iterations += stats_.pillarIterations[k];
+      }
+      for(long k = 0; k < n; ++k) curve_.setDiscount(k, linear.pillarDiscount(k));
+      stats_.passes = 1;
+   }
+
+   std::vector<double> res, jac, step(n);
+   std::vector<long> piv;
+   const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+   while((stats_.maxResidual = residuals(res, &jac)) >= SOLVER_TOLERANCE) {
+      if(stats_.globalIterations == GLOBAL_MAX_ITERATIONS) throw pdg::Error(2, "#Error in BootstrapSolver, the global solver does not converge");
+      luDecompose(jac, n, piv);
+      for(long k = 0; k < n; ++k) step[k] = -res[k];
+      luSolve(jac, n, piv, &step[0]);
+
+      //the step is halved as long as it would make a discount negative
+      double lambda = 1.0;
+      for(long k = 0; k < n; ++k)
+         while(curve_.pillarDiscount(k) + lambda * step[k] <= 0.0) lambda *= 0.5;
+      for(long k = 0; k < n; ++k) curve_.setDiscount(k, curve_.pillarDiscount(k) + lambda * step[k]);
+      ++stats_.globalIterations;
+   }
+   stats_.pillarResiduals = res;
+   if(timed_) stats_.globalSeconds = secondsSince(start);
+}
+
+void BootstrapSolver::jacobian(std::vector<double> &dQuote, std::vector<double> *dExo)
+{
+   const long n = size();
+   std::vector<double> res, jac;
+   std::vector<long> piv;
+   residuals(res, &jac);
+   luDecompose(jac, n, piv);
+
+   //a quote only enters the residual of its instrument
+   std::vector<double> col(n);
+   dQuote.assign(n * n, 0.0);
+   for(long j = 0; j < n; ++j) {
+      std::fill(col.begin(), col.end(), 0.0);
+      col[j] = -residuals_[j].quoteSlope();
+      luSolve(jac, n, piv, &col[0]);
+      for(long k = 0; k < n; ++k) dQuote[k * n + j] = col[k];
+   }
+
+   if(!dExo) return;
+   const long m = exo_ ? exo_->size() : 0;
+   dExo->assign(n * m, 0.0);
+   if(!m) return;
+   std::vector<double> exoGrad(n * m, 0.0);
+   for(long i = 0; i < n; ++i) residuals_[i].exoGradient(curve_, *exo_, &exoGrad[i * m]);
+   for(long j = 0; j < m; ++j) {
+      for(long i = 0; i < n; ++i) col[i] = -exoGrad[i * m + j];
+      luSolve(jac, n, piv, &col[0]);
+      for(long k = 0; k < n; ++k) (*dExo)[k * m + j] = col[k];
+   }
+}
+
+void BootstrapSolver::jacobianTransposed(const double *g, std::vector<double> &dQuote, std::vector<double> *dExo)
+{
+   const long n = size();
+   std::vector<double> res, jac;
+   std::vector<long> piv;
+   residuals(res, &jac);
+   for(long i = 0; i < n; ++i)
+      for(long k = i + 1; k < n; ++k) std::swap(jac[i * n + k], jac[k * n + i]);
+   luDecompose(jac, n, piv);
+
+   //adjoint of the residuals: y = jac^-T g
+   std::vector<double> y(g, g + n);
+   luSolve(jac, n, piv, &y[0]);
+   dQuote.resize(n);
+   for(long j = 0; j < n; ++j) dQuote[j] = -y[j] * residuals_[j].quoteSlope();
+
+   if(!dExo) return;
+   const long m = exo_ ? exo_->size() : 0;
+   dExo->assign(m, 0.0);
+   std::vector<double> exoGrad(m);
+   for(long i = 0; i < n && m; ++i) {
+      if(y[i] == 0.0) continue;
+      std::fill(exoGrad.begin(), exoGrad.end(), 0.0);
+      residuals_[i].exoGradient(curve_, *exo_, &exoGrad[0]);
+      for(long j = 0; j < m; ++j) (*dExo)[j] -= y[i] * exoGrad[j];
+   }
+}
+
+} // namespace libor
@@ -0,0 +1,231 @@
+//rateBootstrapSolver.h
+#ifndef _RATEBOOTSTRAPSOLVER_H__
+#define _RATEBOOTSTRAPSOLVER_H__
+
+#include <vector>
+
+namespace libor {
+
+class CashflowGrid;
+
+/**
+* @defgroup bootstrapsolver Bootstrap of a discount curve on explicit instruments.
+*
+* The instruments come with their schedules already generated (dates and year
+* fractions), so the solver only deals with the curve: one pillar per
+* instrument, at its end date. Rates are quoted in natural units, futures as
+* 1 - rate. Swaps are valued against the exogenous discounting curve when one
+* is given, against the curve being built otherwise (its discounts are
+* evaluated once per distinct payment date of all the swaps). A cross currency basis
+* swap comes with the value of its other leg and the projected fixings of
+* its floating leg, both taken from curves known beforehand, and is valued
+* against the curve being built: its spread is linear in the discounts.
+* The curve interpolates (linear, constant or natural cubic spline) the seed of
+* BlockSpec::interpOn (rate, rate * time or discount) of its pillars and today,
+* beyond the last pillar the zero rate is flat. With linear and constant
+* interpolation a pillar only shapes the curve up to the next one, so the
+* pillars are solved one at a time in maturity order; with the spline every
+* pillar moves the whole curve and the sequential solve is repeated until
+* the pillars stop moving. The global solver instead prices all the
+* instruments at once: Newton-Raphson on the vector of pillar discounts, with
+* the analytic jacobian of the residuals (the spline weights are linear in
+* the pillar seeds), starting from the bootstrap with linear interpolation.
+* The sensitivities of the solved discounts to the quotes and to the
+* exogenous curve follow from the implicit function theorem at the solution:
+* with R(D, q) = 0, dD/dq = -(dR/dD)^-1 dR/dq. The jacobian dR/dD is the
+* one of the global solver, so their cost is one factorisation and a solve
+* per input, whatever the number of iterations the bootstrap took.
+*/
+
+//@{
+enum bootstrap_instrument_type { biDeposit = 1, biFra = 2, biFuture = 3, biSwap = 4, biBasisSwap = 5 };
+
+struct BootstrapInstrument {
+   BootstrapInstrument();
+
+   long   type;
+   double quote;                      // rate, price for futures
+   long   start;
+   long   end;                        // pillar of the instrument
+   double yrf;                        // accrual of a deposit, fra or future
+   std::vector<long>   fixedDates;    // swap fixed leg payment dates ...
+   std::vector<double> fixedYrf;      // ... and accruals
+   std::vector<long>   floatDates;    // ends of the floating periods, the first one starts at start
+   std::vector<double> floatYrf;      // basis swap: accruals of the floating periods ...
+   std::vector<double> floatFixings;  // ... their projected return, fixing times accrual
+   double otherLeg;                   // basis swap: value of the other leg per unit of notional
+
+   //market rate matched by the instrument
+   double marketRate() const { return type == biFuture ? 1.0 - quote : quote; }
+   //same instrument, schedule included, whatever the quote
+   bool sameTerms(const BootstrapInstrument &other) const;
+};
+
+class BootstrapCurve
+{
+public:
+   BootstrapCurve(long today, long typeInterp, long interpOn, long comp, long dayCount);
+   //same conventions and pillars, another interpolation
+   BootstrapCurve(const BootstrapCurve &other, long typeInterp);
+
+   //pillar dates, strictly increasing and after today; the discounts are reset to 1
+   void setPillars(const std::vector<long> &dates);
+   void setDiscount(long k, double disc);
+   //only the first n pillars shape the curve (sequential bootstrap), all of them by default
+   void setActive(long n);
+
+   long size() const { return static_cast<long>(dates_.size()); }
+   long active() const { return active_; }
+   long today() const { return today_; }
+   long typeInterp() const { return typeInterp_; }
+   long interpOn() const { return interpOn_; }
+   long pillarDate(long k) const { return dates_[k]; }
+   double pillarTime(long k) const { return x_[k + 1]; }
+   double pillarDiscount(long k) const { return disc_[k]; }
+   //a pillar shapes the curve only up to the next one
+   bool local() const;
+
+   //year fraction from today with the day count of the curve
+   double time(long date) const;
+
+   //conversions between discounts and the interpolated seeds, with their derivatives
+   double seedOf(double disc, double t) const;
+   double seedSlope(double disc, double t) const;
+   double discountOf(double y, double t) const;
+   double discountSlope(double y, double t) const;
+   //today's rate is the one of the first pillar
+   bool rateSeed() const { return seed_ == 1; }
+   //discount at time t; with grad, scale * d(discount) / d(discount of pillar k) is added to grad[k]
+   double discount(double t, double *grad = 0, double scale = 1.0) const;
+   //discounts at n times, in one walk along the nodes when the times are ascending
+   void discounts(const double *t, long n, double *out) const;
+   //same on dates
+   void discountsOn(const long *dates, long n, double *out) const;
+
+private:
+   void prepare() const;
+   //discount at t in (x_[i], x_[i + 1]]
+   double interpolate(long i, double t, double *grad, double scale) const;
+
+   long today_;
+   long typeInterp_;
+   long interpOn_;
+   long seed_;
+   long comp_;
+   long dayCount_;
+   long active_;
+   std::vector<long> dates_;
+   std::vector<double> disc_;
+   std::vector<double> x_;               // node times, today first
+
+   mutable bool dirty_;
+   mutable long momentsActive_;          // number of pillars of the moment sensitivities
+   mutable std::vector<double> y_;       // node seeds
+   mutable std::vector<double> dy_;      // d(seed) / d(discount) of the nodes
+   mutable std::vector<double> m_;       // spline second derivatives
+   mutable std::vector<double> s_;       // d(m_[i]) / d(y_[k]) at s_[i * nodes + k]
+};
+
+//residual of an instrument against a curve, precomputed times and exogenous discounts
+class BootstrapResidual
+{
+public:
+   //exoDiscs (if any) are the discounts of exo on the dates of the grid, curve 0
+   BootstrapResidual(const BootstrapInstrument &instr, const BootstrapCurve &curve, const BootstrapCurve *exo,
+                     const CashflowGrid *exoGrid = 0, const std::vector<double> *exoDiscs = 0);
+
+   //model rate minus market rate, with grad d(residual) / d(discount of pillar k) is added to grad[k]
+   double operator()(const BootstrapCurve &curve, double *grad = 0) const;
+   //d(residual) / d(discount of pillar k of the exogenous curve) is added to grad[k]
+   void exoGradient(const BootstrapCurve &curve, const BootstrapCurve &exo, double *grad) const;
+   //d(residual) / d(quote)
+   double quoteSlope() const { return type_ == biFuture ? 1.0 : -1.0; }
+   double marketRate() const { return market_; }
+   void setQuote(double quote) { market_ = type_ == biFuture ? 1.0 - quote : quote; }
+
+private:
+   long type_;
+   double market_;
+   double tStart_;
+   double tEnd_;
+   double yrf_;
+   bool exogenous_;
+   std::vector<double> fixedT_;
+   std::vector<double> fixedYrf_;
+   std::vector<double> fixedDisc_;     // exogenous discounts of the fixed payments
+   std::vector<double> floatT_;        // period bounds, the start first
+   std::vector<double> floatDisc_;     // exogenous discounts of the floating payments
+   std::vector<double> fixedExoT_;     // payment times on the exogenous curve
+   std::vector<double> floatExoT_;
+   std::vector<double> floatYrf_;
+   std::vector<double> fixings_;
+   double otherLeg_;
+};
+
+struct BootstrapStats {
+   BootstrapStats();
+
+   long firstSolved;                   // first pillar solved, the ones before were kept
+   long passes;                        // sequential passes over the pillars
+   long iterations;                    // newton steps over all the pillars
+   long globalIterations;              // newton steps of the global solver
+   long warmStarted;                   // pillars started from a given discount
+   double maxResidual;
+   std::vector<long> pillarIterations;
+   std::vector<double> pillarResiduals;   // final residual of each instrument
+   std::vector<double> pillarSeconds;     // time spent on each pillar, only when timed
+   double globalSeconds;                  // time of the global newton steps, only when timed
+};
+
+class BootstrapSolver
+{
+public:
+   //instruments must be sorted by end date, exo (if any) is the discounting curve of the swaps
+   BootstrapSolver(BootstrapCurve &curve, const std::vector<BootstrapInstrument> &instr, const BootstrapCurve *exo = 0);
+
+   //solves the pillars from first on, the discounts of the ones before are kept as they are
+   void solve(long first = 0);
+   //new quotes of the instruments, in their order, for another solve on the same schedules
+   void setQuotes(const double *quotes);
+   //starting discount of each pillar (warm start), 0 for the default guess
+   void setGuesses(const std::vector<double> &guesses) { guesses_ = guesses; }
+   //times the pillar solves in the statistics, off by default
+   void setTimed(bool timed) { timed_ = timed; }
+   //solves all the pillars at once, from the guesses when all pillars have one
+   void solveGlobal();
+   //sensitivities of the solved discounts, dQuote[k * size() + j] to the quote of instrument j and
+   //dExo[k * exo size + j] to the discount of pillar j of the exogenous curve
+   void jacobian(std::vector<double> &dQuote, std::vector<double> *dExo);
+   //transposed jacobian applied to the derivatives g of a value with respect to the solved discounts:
+   //dQuote[j] with respect to the quote of instrument j, dExo[j] to the discount of exogenous pillar j.
+   //One solve with the transposed jacobian of the residuals, instead of one per quote.
+   void jacobianTransposed(const double *g, std::vector<double> &dQuote, std::vector<double> *dExo);
+
+   const BootstrapStats &stats() const { return stats_; }
+   long size() const { return static_cast<long>(residuals_.size()); }
+
+private:
+   long solvePillar(BootstrapCurve &curve, long k, double guess, double &residual);
+   //solvePillar, timed in the statistics when asked
+   long timedPillar(BootstrapCurve &curve, long k, double guess, double &residual);
+   double initialGuess(const BootstrapCurve &curve, long k) const;
+   bool warm(long k) const { return k < static_cast<long>(guesses_.size()) && guesses_[k] > 0.0; }
+   //max absolute residual, with jac the row major jacobian of the residuals
+   double residuals(std::vector<double> &res, std::vector<double> *jac);
+
+   BootstrapCurve &curve_;
+   const BootstrapCurve *exo_;
+   std::vector<BootstrapResidual> residuals_;
+   std::vector<double> grad_;
+   std::vector<double> guesses_;
+   BootstrapStats stats_;
+   bool timed_;
+};
+
+//pillars of the sorted instruments, throws when two instruments share a pillar
+std::vector<long> bootstrapPillars(const std::vector<BootstrapInstrument> &instr, long today);
+//@}
+
+} // namespace libor
+
+#endif // _RATEBOOTSTRAPSOLVER_H__
@@ -0,0 +1,65 @@
+//rateBootstrapState.cpp
+#include <algorithm>
+#include "rateBootstrapState.h"
+
+namespace libor {
+
+BootstrapTimings::BootstrapTimings()
+: parse(0.), prepare(0.), solve(0.), publish(0.)
+{}
+
+BootstrapState::BootstrapState()
+: today(0), typeInterp(0), interpOn(0), comp(0), dayCount(0), exoTypeInterp(0), exoInterpOn(0), exoComp(0),
+  exoDayCount(0)
+{}
+
+long firstAffectedPillar(const BootstrapState &prev, const BootstrapState &next, bool local)
+{
+   const long n = static_cast<long>(next.instruments.size());
+   if(prev.today != next.today || prev.typeInterp != next.typeInterp || prev.interpOn != next.interpOn ||
+      prev.comp != next.comp || prev.dayCount != next.dayCount ||
+      prev.exoTypeInterp != next.exoTypeInterp || prev.exoInterpOn != next.exoInterpOn ||
+      prev.exoComp != next.exoComp || prev.exoDayCount != next.exoDayCount ||
+      prev.exoDates != next.exoDates || prev.exoDiscounts != next.exoDiscounts ||
+      prev.discounts.size() != prev.instruments.size())
+      return 0;
+
+   const long common = std::min(n, static_cast<long>(prev.instruments.size()));
+   long first = 0;
+   while(first < common && prev.instruments[first].sameTerms(next.instruments[first]) &&
+         prev.instruments[first].quote == next.instruments[first].quote)
+      ++first;
+
+   //nothing changed
+   if(first == n && n == static_cast<long>(prev.instruments.size())) return n;
+   return local ? first : 0;
+}
+
+BootstrapStateCache &BootstrapStateCache::Instance()
+{
+   static BootstrapStateCache cache;
+   return cache;
+}
+
+bool BootstrapStateCache::find(const std::string &name, BootstrapState &state) const
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   std::map<std::string, BootstrapState>::const_iterator it = states_.find(name);
+   if(it == states_.end()) return false;
+   state = it->second;
+   return true;
+}
+
+void BootstrapStateCache::store(const std::string &name, const BootstrapState &state)
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   states_[name] = state;
+}
+
+void BootstrapStateCache::clear(const std::string &name)
+{
+   boost::mutex::scoped_lock lock(mutex_);
+   states_.erase(name);
+}
+
+} // namespace libor
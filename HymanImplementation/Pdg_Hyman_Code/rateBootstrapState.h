@@ -0,0 +1,82 @@
+//rateBootstrapState.h
+#ifndef _RATEBOOTSTRAPSTATE_H__
+#define _RATEBOOTSTRAPSTATE_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include "rateBootstrapSolver.h"
+
+namespace libor {
+
+/**
+* @defgroup bootstrapstate Solved state of the last bootstrap of a curve.
+*
+* An incremental bootstrap compares its inputs with the ones of the previous
+* bootstrap of the same curve: when the conventions and the exogenous curve
+* are the same, the pillars before the first instrument that changed (quote
+* or terms) are taken as they were and only the following ones are solved
+* again. This holds for the local interpolations, whose stencil does not
+* reach back beyond the pillar; with the spline the whole curve is solved.
+* The state of every bootstrap is kept, with its solver statistics and, when
+* asked, the timings of the phases of the call.
+*/
+
+//@{
+//seconds spent in the phases of a bootstrap
+struct BootstrapTimings {
+   BootstrapTimings();
+
+   double parse;                                   // instruments and options
+   double prepare;                                 // exogenous curve, instrument times, previous state
+   double solve;
+   double publish;                                 // output and push in shared memory
+};
+
+struct BootstrapState {
+   BootstrapState();
+
+   long today;
+   long typeInterp;
+   long interpOn;
+   long comp;
+   long dayCount;
+   std::string exoName;                            // DiscCurveName, empty if none, and its conventions
+   long exoTypeInterp;
+   long exoInterpOn;
+   long exoComp;
+   long exoDayCount;
+   std::vector<long> exoDates;
+   std::vector<double> exoDiscounts;
+   std::vector<BootstrapInstrument> instruments;   // sorted by end date
+   std::vector<double> discounts;                  // solved pillars
+   BootstrapStats stats;
+   BootstrapTimings timings;
+};
+
+//first pillar of next that can differ from prev, the number of instruments of next if none
+long firstAffectedPillar(const BootstrapState &prev, const BootstrapState &next, bool local);
+
+class BootstrapStateCache
+{
+public:
+   static BootstrapStateCache &Instance();
+
+   bool find(const std::string &name, BootstrapState &state) const;
+   void store(const std::string &name, const BootstrapState &state);
+   void clear(const std::string &name);
+
+private:
+   BootstrapStateCache() {}
+   BootstrapStateCache(const BootstrapStateCache &);
+   BootstrapStateCache &operator=(const BootstrapStateCache &);
+
+   mutable boost::mutex mutex_;
+   std::map<std::string, BootstrapState> states_;
+};
+//@}
+
+} // namespace libor
+
+#endif // _RATEBOOTSTRAPSTATE_H__
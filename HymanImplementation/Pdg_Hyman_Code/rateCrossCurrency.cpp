@@ -0,0 +1,174 @@
+//rateCrossCurrency.cpp
+#include <string>
+#include <boost/bind.hpp>
+#include "rateCrossCurrency.h"
+#include "cCashflowGrid.h"
+#include "cThreadPool.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace libor {
+
+namespace {
+   typedef std::vector<CrossCurrencyInstrument> input_type;
+   typedef std::vector<BootstrapInstrument> output_type;
+
+   //discounts of curves[k] on ascending dates, for a cash flow grid
+   void gridDiscounts(const BootstrapCurve *const *curves, long k, const long *dates, long n, double *out)
+   {
+      curves[k]->discountsOn(dates, n, out);
+   }
+
+   //fx swaps at their implied foreign rate and domestic legs of the basis swaps
+   void prepareDomestic(const input_type *instr, const CrossCurrencyMarket *market, output_type *res, std::string *error)
+   {
+      try {
+         //the discounts of all the instruments on the distinct dates of each curve: 0 discounting, 1 forwarding
+         const BootstrapCurve *curves[2] = { market->domDisc, market->domFwd ? market->domFwd : market->domDisc };
+         const long fwd = market->domFwd ? 1 : 0;
+         CashflowGrid grid;
+         for(size_t i = 0; i < instr->size(); ++i) {
+            const CrossCurrencyInstrument &in = (*instr)[i];
+            if(in.type == ciDeposit) continue;
+            grid.add(0, in.start);
+            grid.add(0, in.end);
+            if(in.type != ciBasisSwap) continue;
+            grid.add(fwd, in.start);
+            for(size_t k = 0; k < in.domDates.size(); ++k) {
+               grid.add(fwd, in.domDates[k]);
+               grid.add(0, in.domDates[k]);
+            }
+         }
+         grid.compile();
+         std::vector<double> values;
+         grid.evaluate(boost::bind(&gridDiscounts, curves, _1, _2, _3, _4), values);
+         std::vector<double> disc(grid.requests());
+         if(!disc.empty()) grid.scatter(values, &disc[0]);
+
+         //the requests in the same order
+         const double *p = disc.empty() ? 0 : &disc[0];
+         for(size_t i = 0; i < instr->size(); ++i) {
+            const CrossCurrencyInstrument &in = (*instr)[i];
+            if(in.type == ciDeposit) continue;
+            const double start = *p++, end = *p++;
+            if(in.type == ciFxSwap) {
+               //covered interest parity: forward / spot = domestic discount ratio / foreign discount ratio
+               const double forward = market->spot + in.quote * market->pointsScale;
+               (*res)[i].quote = (forward / market->spot * start / end - 1.0) / in.yrf;
+               continue;
+            }
+            //floating leg, notionals exchanged, per unit of notional
+            double value = end - start;
+            double fwdStart = *p++;
+            for(size_t k = 0; k < in.domDates.size(); ++k) {
+               const double fwdEnd = *p++;
+               value += (fwdStart / fwdEnd - 1.0) * *p++;
+               fwdStart = fwdEnd;
+            }
+            (*res)[i].otherLeg = value;
+         }
+      }
+      catch(pdg::Error e) {
+         *error = e.getInfo().des;
+      }
+      catch(...) {
+         *error = "#Error in crossCurrencyInstruments, domestic side failed";
+      }
+   }
+
+   //projected fixings of the foreign legs of the basis swaps
+   void prepareForeign(const input_type *instr, const CrossCurrencyMarket *market, output_type *res, std::string *error)
+   {
+      try {
+         const BootstrapCurve *curves[1] = { market->forFwd };
+         CashflowGrid grid;
+         for(size_t i = 0; i < instr->size(); ++i) {
+            const CrossCurrencyInstrument &in = (*instr)[i];
+            if(in.type != ciBasisSwap) continue;
+            grid.add(0, in.start);
+            for(size_t k = 0; k < in.forDates.size(); ++k) grid.add(0, in.forDates[k]);
+         }
+         grid.compile();
+         std::vector<double> values;
+         grid.evaluate(boost::bind(&gridDiscounts, curves, _1, _2, _3, _4), values);
+
+         long r = 0;
+         for(size_t i = 0; i < instr->size(); ++i) {
+            const CrossCurrencyInstrument &in = (*instr)[i];
+            if(in.type != ciBasisSwap) continue;
+            std::vector<double> &fixings = (*res)[i].floatFixings;
+            fixings.resize(in.forDates.size());
+            double fwdStart = values[grid.slot(r++)];
+            for(size_t k = 0; k < in.forDates.size(); ++k) {
+               const double fwdEnd = values[grid.slot(r++)];
+               fixings[k] = fwdStart / fwdEnd - 1.0;
+               fwdStart = fwdEnd;
+            }
+         }
+      }
+      catch(pdg::Error e) {
+         *error = e.getInfo().des;
+      }
+      catch(...) {
+         *error = "#Error in crossCurrencyInstruments, foreign side failed";
+      }
+   }
+}
+
+CrossCurrencyInstrument::CrossCurrencyInstrument()
+: type(ciDeposit), quote(0.), start(0), end(0), yrf(0.)
+{}
+
+CrossCurrencyMarket::CrossCurrencyMarket()
+: spot(0.), pointsScale(1.e-4), domDisc(0), domFwd(0), forFwd(0)
+{}
+
+std::vector<BootstrapInstrument> crossCurrencyInstruments(const std::vector<CrossCurrencyInstrument> &instr,
+                                                          const CrossCurrencyMarket &market, parallel::ThreadPool &pool)
+{
+   const std::string errMsg("#Error in crossCurrencyInstruments, ");
+   if(!market.domDisc) throw pdg::Error(2, errMsg + "missing domestic discounting curve");
+   if(market.spot <= 0.0) throw pdg::Error(2, errMsg + "spot fx " + xtos(market.spot) + " not positive");
+
+   //the terms first, each side then fills its own fields
+   output_type res(instr.size());
+   bool foreign = false;
+   for(size_t i = 0; i < instr.size(); ++i) {
+      const CrossCurrencyInstrument &in = instr[i];
+      BootstrapInstrument &out = res[i];
+      out.start = in.start;
+      out.end = in.end;
+      out.yrf = in.yrf;
+      out.quote = in.quote;
+      switch(in.type) {
+         case ciDeposit:
+         case ciFxSwap:
+            out.type = biDeposit;
+            if(in.yrf <= 0.0) throw pdg::Error(2, errMsg + "missing accrual of the instrument ending at " + xtos(in.end));
+            break;
+         case ciBasisSwap:
+            out.type = biBasisSwap;
+            if(in.forDates.empty() || in.domDates.empty() || in.forDates.size() != in.forYrf.size())
+               throw pdg::Error(2, errMsg + "inconsistent schedule of the basis swap ending at " + xtos(in.end));
+            out.floatDates = in.forDates;
+            out.floatYrf = in.forYrf;
+            foreign = true;
+            break;
+         default:
+            throw pdg::Error(2, errMsg + "unknown instrument type " + xtos(in.type));
+      }
+   }
+   if(foreign && !market.forFwd) throw pdg::Error(2, errMsg + "missing foreign forwarding curve");
+
+   std::string domError, forError;
+   std::vector<parallel::ThreadPool::task_type> tasks;
+   tasks.push_back(boost::bind(&prepareDomestic, &instr, &market, &res, &domError));
+   if(foreign) tasks.push_back(boost::bind(&prepareForeign, &instr, &market, &res, &forError));
+   pool.run(tasks);
+   if(domError.size() > 0) throw pdg::Error(2, domError);
+   if(forError.size() > 0) throw pdg::Error(2, forError);
+
+   return res;
+}
+
+} // namespace libor
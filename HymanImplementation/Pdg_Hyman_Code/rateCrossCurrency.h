@@ -0,0 +1,62 @@
+//rateCrossCurrency.h
+#ifndef _RATECROSSCURRENCY_H__
+#define _RATECROSSCURRENCY_H__
+
+#include <vector>
+#include "rateBootstrapSolver.h"
+
+namespace parallel { class ThreadPool; }
+
+namespace libor {
+
+/**
+* @defgroup crosscurrency Instruments of a cross currency basis curve.
+*
+* The basis curve discounts the foreign cash flows of trades collateralised
+* in the domestic currency. It is bootstrapped on foreign deposits, fx swaps
+* and cross currency basis swaps (floating against floating, notionals
+* exchanged, the spread on the foreign leg) against three curves built
+* beforehand: the domestic discounting and forwarding curves and the foreign
+* forwarding curve. What does not depend on the basis curve is computed
+* before the bootstrap: the fx swaps become foreign deposits at the rate of
+* covered interest parity, all of them in one pass, and the basis swaps get
+* the value of their domestic leg and the projected fixings of their foreign
+* leg. The domestic side (fx swaps and domestic legs) and the foreign side
+* only read their own curves and are prepared concurrently.
+*/
+
+//@{
+enum crosscurrency_instrument_type { ciDeposit = 1, ciFxSwap = 2, ciBasisSwap = 3 };
+
+struct CrossCurrencyInstrument {
+   CrossCurrencyInstrument();
+
+   long   type;
+   double quote;                      // deposit rate, fx swap points, basis swap spread on the foreign leg
+   long   start;
+   long   end;                        // pillar of the instrument
+   double yrf;                        // accrual of a deposit or an fx swap on the basis curve
+   std::vector<long>   forDates;      // basis swap foreign leg: ends of the floating periods ...
+   std::vector<double> forYrf;        // ... and their accruals
+   std::vector<long>   domDates;      // basis swap domestic leg: ends of the floating periods
+};
+
+struct CrossCurrencyMarket {
+   CrossCurrencyMarket();
+
+   double spot;                       // foreign units for one domestic unit, at the start of the fx swaps
+   double pointsScale;                // fx forward = spot + points * pointsScale
+   const BootstrapCurve *domDisc;
+   const BootstrapCurve *domFwd;      // domDisc when null
+   const BootstrapCurve *forFwd;      // needed by the basis swaps
+};
+
+//bootstrap instruments of the basis curve, in the order of instr; the domestic curves and the
+//foreign one are read by two tasks of the pool, so they must be distinct objects
+std::vector<BootstrapInstrument> crossCurrencyInstruments(const std::vector<CrossCurrencyInstrument> &instr,
+                                                          const CrossCurrencyMarket &market, parallel::ThreadPool &pool);
+//@}
+
+} // namespace libor
+
+#endif // _RATECROSSCURRENCY_H__
@@ -0,0 +1,125 @@
+//rateDeltaLadder.cpp
+#include <algorithm>
+#include <memory>
+#include "rateDeltaLadder.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace libor {
+
+DeltaLadder::Entry &DeltaLadder::entry(const std::string &curve)
+{
+   std::map<std::string, Entry>::iterator it = curves_.find(curve);
+   if(it != curves_.end()) return it->second;
+   Entry &e = curves_[curve];
+   e.bootstrapped = BootstrapStateCache::Instance().find(curve, e.state);
+   if(e.bootstrapped) e.grad.assign(e.state.discounts.size() + 1, 0.0);
+   return e;
+}
+
+const DeltaLadder::Entry &DeltaLadder::find(const std::string &curve) const
+{
+   std::map<std::string, Entry>::const_iterator it = curves_.find(curve);
+   if(it == curves_.end()) throw pdg::Error(2, "#Error in DeltaLadder, no derivative reached curve " + curve);
+   return it->second;
+}
+
+void DeltaLadder::add(const std::string &curve, const double *grad, long n)
+{
+   Entry &e = entry(curve);
+   if(e.grad.empty()) e.grad.assign(n, 0.0);
+   if(n != static_cast<long>(e.grad.size()))
+      throw pdg::Error(2, "#Error in DeltaLadder, " + xtos(n) + " derivatives for curve " + curve + " of " +
+                          xtos(static_cast<long>(e.grad.size())) + " points");
+   for(long k = 0; k < n; ++k) e.grad[k] += grad[k];
+}
+
+long DeltaLadder::level(const std::string &curve, long depth)
+{
+   Entry &e = entry(curve);
+   if(e.level >= 0) return e.level;
+   if(depth > static_cast<long>(curves_.size()))
+      throw pdg::Error(2, "#Error in DeltaLadder, the discounting curves of " + curve + " loop");
+   e.level = (e.bootstrapped && !e.state.exoName.empty()) ? level(e.state.exoName, depth + 1) + 1 : 0;
+   return e.level;
+}
+
+void DeltaLadder::carry(const std::string &curve, Entry &e)
+{
+   const BootstrapState &s = e.state;
+   const long n = static_cast<long>(s.instruments.size());
+
+   //the exogenous curve as it was read by the bootstrap, the points up to today are not pillars
+   std::auto_ptr<BootstrapCurve> exo;
+   long skipped = 0;
+   if(!s.exoName.empty()) {
+      exo.reset(new BootstrapCurve(s.today, s.exoTypeInterp, s.exoInterpOn, s.exoComp, s.exoDayCount));
+      std::vector<long> dates;
+      for(size_t i = 0; i < s.exoDates.size(); ++i) {
+         if(s.exoDates[i] <= s.today) ++skipped;
+         else dates.push_back(s.exoDates[i]);
+      }
+      exo->setPillars(dates);
+      for(size_t k = 0; k < dates.size(); ++k) exo->setDiscount(static_cast<long>(k), s.exoDiscounts[skipped + k]);
+   }
+
+   BootstrapCurve solved(s.today, s.typeInterp, s.interpOn, s.comp, s.dayCount);
+   BootstrapSolver solver(solved, s.instruments, exo.get());
+   for(long k = 0; k < n; ++k) solved.setDiscount(k, s.discounts[k]);
+
+   //the discount at today does not move
+   std::vector<double> dExo;
+   solver.jacobianTransposed(&e.grad[1], e.deltas, exo.get() ? &dExo : 0);
+   if(!exo.get()) return;
+
+   //the derivatives with respect to the exogenous discounts go down to that curve, as it still is
+   Entry &down = entry(s.exoName);
+   if(down.bootstrapped) {
+      const BootstrapState &d = down.state;
+      bool same = d.today == s.exoDates.front() && d.discounts.size() + 1 == s.exoDates.size();
+      for(size_t k = 0; same && k < d.discounts.size(); ++k)
+         same = d.instruments[k].end == s.exoDates[k + 1] && d.discounts[k] == s.exoDiscounts[k + 1];
+      if(!same)
+         throw pdg::Error(2, "#Error in DeltaLadder, curve " + s.exoName + " was bootstrapped again since curve " +
+                             curve + " was discounted on it");
+   }
+   if(down.grad.empty()) down.grad.assign(s.exoDates.size(), 0.0);
+   if(down.grad.size() != s.exoDates.size())
+      throw pdg::Error(2, "#Error in DeltaLadder, curve " + s.exoName + " has not the points curve " + curve + " was discounted on");
+   for(size_t j = 0; j < dExo.size(); ++j) down.grad[skipped + j] += dExo[j];
+}
+
+void DeltaLadder::solve()
+{
+   //the curves discounted on others first: the derivatives only go down
+   std::vector<std::pair<long, std::string> > order;
+   std::vector<std::string> names = curves();
+   for(size_t i = 0; i < names.size(); ++i) level(names[i], 0);
+   for(std::map<std::string, Entry>::const_iterator it = curves_.begin(); it != curves_.end(); ++it)
+      order.push_back(std::make_pair(-it->second.level, it->first));
+   std::sort(order.begin(), order.end());
+
+   for(size_t i = 0; i < order.size(); ++i) {
+      Entry &e = curves_[order[i].second];
+      if(e.bootstrapped) carry(order[i].second, e);
+   }
+}
+
+std::vector<std::string> DeltaLadder::curves() const
+{
+   std::vector<std::string> res;
+   for(std::map<std::string, Entry>::const_iterator it = curves_.begin(); it != curves_.end(); ++it) res.push_back(it->first);
+   return res;
+}
+
+const std::vector<double> &DeltaLadder::quoteDeltas(const std::string &curve) const
+{
+   return find(curve).deltas;
+}
+
+const std::vector<double> &DeltaLadder::discountGradient(const std::string &curve) const
+{
+   return find(curve).grad;
+}
+
+} // namespace libor
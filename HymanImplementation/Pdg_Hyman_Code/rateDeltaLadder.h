@@ -0,0 +1,67 @@
+//rateDeltaLadder.h
+#ifndef _RATEDELTALADDER_H__
+#define _RATEDELTALADDER_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include "rateBootstrapState.h"
+
+namespace libor {
+
+/**
+* @defgroup deltaladder Par quote deltas of a portfolio.
+*
+* The derivatives of the value of a portfolio with respect to the discounts
+* of its curves (at today and the pillars, see the adjoint mode of the
+* portfolio pricer) are added per curve over all the trades, then each curve
+* is carried to the quotes of its instruments by its bootstrap: one solve
+* with the transposed jacobian of the residuals, at the state of the last
+* bootstrap of the curve. A curve bootstrapped on an exogenous discounting
+* curve (DiscCurveName) also passes the derivatives with respect to the
+* discounts of that curve down to it, so the curves are carried from the
+* ones discounted on others to the ones they are discounted on. The ladder
+* of a whole book costs one solve per curve instead of one repricing per
+* bumped quote.
+*/
+
+//@{
+class DeltaLadder
+{
+public:
+   //adds the derivatives with respect to the discounts of the curve at today and its pillars, the
+   //points published by its last bootstrap
+   void add(const std::string &curve, const double *grad, long n);
+   //carries the derivatives to the quotes, down the exogenous curves
+   void solve();
+
+   //curves added and the ones they are discounted on
+   std::vector<std::string> curves() const;
+   //deltas to the quotes of the instruments of the curve, in the order of its pillars, empty when
+   //the curve has no bootstrap state
+   const std::vector<double> &quoteDeltas(const std::string &curve) const;
+   //derivatives with respect to the discounts of the curve, its own and the ones passed down to it
+   const std::vector<double> &discountGradient(const std::string &curve) const;
+
+private:
+   struct Entry {
+      Entry() : bootstrapped(false), level(-1) {}
+      bool bootstrapped;
+      BootstrapState state;
+      std::vector<double> grad;
+      std::vector<double> deltas;
+      long level;                      // length of the chain of exogenous curves below
+   };
+
+   Entry &entry(const std::string &curve);
+   const Entry &find(const std::string &curve) const;
+   long level(const std::string &curve, long depth);
+   void carry(const std::string &curve, Entry &e);
+
+   std::map<std::string, Entry> curves_;
+};
+//@}
+
+} // namespace libor
+
+#endif // _RATEDELTALADDER_H__
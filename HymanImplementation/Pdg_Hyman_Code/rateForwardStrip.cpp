@@ -0,0 +1,54 @@
+//rateForwardStrip.cpp
+#include "rateForwardStrip.h"
+#include "cCompiledCalendar.h"
+#include "eDayCountBulk.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace libor {
+
+FixingConventions::FixingConventions()
+: periodMonths(3), lag(2), adjust(bdModFollowing), dayCount(0)
+{}
+
+ForwardStrip::ForwardStrip(const std::vector<long> &fixings, const FixingConventions &conv, const CompiledCalendar *calendar)
+{
+   if(conv.periodMonths <= 0)
+      throw pdg::Error(2, "#Error in ForwardStrip, period of " + xtos(conv.periodMonths) + " months");
+   const long n = static_cast<long>(fixings.size());
+   start_.resize(n);
+   end_.resize(n);
+   for(long i = 0; i < n; ++i) {
+      if(calendar) {
+         start_[i] = calendar->addBusinessDays(fixings[i], conv.lag);
+         end_[i] = calendar->adjust(daycount::addMonths(start_[i], conv.periodMonths), conv.adjust);
+      }
+      else {
+         start_[i] = fixings[i] + conv.lag;
+         end_[i] = daycount::addMonths(start_[i], conv.periodMonths);
+      }
+   }
+   accrual_.resize(n);
+   if(n > 0) daycount::yearFractions(conv.dayCount, n, &start_[0], &end_[0], &accrual_[0]);
+
+   startSlot_.resize(n);
+   endSlot_.resize(n);
+   for(long i = 0; i < n; ++i) {
+      startSlot_[i] = grid_.add(0, start_[i]);
+      endSlot_[i] = grid_.add(0, end_[i]);
+   }
+   grid_.compile();
+   for(long i = 0; i < n; ++i) {
+      startSlot_[i] = grid_.slot(startSlot_[i]);
+      endSlot_[i] = grid_.slot(endSlot_[i]);
+   }
+}
+
+void ForwardStrip::price(const discount_function &discounts, double *rates) const
+{
+   std::vector<double> discs;
+   grid_.evaluate(discounts, discs);
+   for(long i = 0; i < size(); ++i) rates[i] = (discs[startSlot_[i]] / discs[endSlot_[i]] - 1.0) / accrual_[i];
+}
+
+} // namespace libor
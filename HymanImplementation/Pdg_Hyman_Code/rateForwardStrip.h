@@ -0,0 +1,61 @@
+//rateForwardStrip.h
+#ifndef _RATEFORWARDSTRIP_H__
+#define _RATEFORWARDSTRIP_H__
+
+#include <vector>
+#include "cCashflowGrid.h"
+
+namespace libor {
+
+class CompiledCalendar;
+
+/**
+* @defgroup forwardstrip Projected fixings of a strip of floating periods.
+*
+* Each fixing date starts a period lag business days later, which ends
+* periodMonths later, adjusted by the roll rule, both on a compiled
+* calendar (the caller compiles it, see pdg_shmImplRatesStrip). The accruals of all the periods are computed in bulk and their
+* start and end dates go in one cash flow grid: the curve is evaluated once,
+* on the distinct dates in ascending order, and each forward is the simply
+* compounded rate of the discount ratio over its accrual.
+*/
+
+//@{
+struct FixingConventions {
+   FixingConventions();
+
+   long periodMonths;
+   long lag;                       // business days from the fixing to the start of the period
+   long adjust;                    // business_day_rule of the end of the period
+   long dayCount;
+};
+
+class ForwardStrip
+{
+public:
+   //calendar NULL for unadjusted dates and a lag in calendar days, else covering all the periods
+   ForwardStrip(const std::vector<long> &fixings, const FixingConventions &conv, const CompiledCalendar *calendar);
+
+   long size() const { return static_cast<long>(start_.size()); }
+   long start(long i) const { return start_[i]; }
+   long end(long i) const { return end_[i]; }
+   double accrual(long i) const { return accrual_[i]; }
+   //curve 0
+   const CashflowGrid &grid() const { return grid_; }
+
+   //forward rate of each period on the curve
+   void price(const discount_function &discounts, double *rates) const;
+
+private:
+   std::vector<long> start_;
+   std::vector<long> end_;
+   std::vector<double> accrual_;
+   CashflowGrid grid_;
+   std::vector<long> startSlot_;
+   std::vector<long> endSlot_;
+};
+//@}
+
+} // namespace libor
+
+#endif // _RATEFORWARDSTRIP_H__
@@ -0,0 +1,223 @@
+//ratePortfolioPricer.cpp
+#include <algorithm>
+#include <map>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include "ratePortfolioPricer.h"
+#include "cParallelReduce.h"
+#include "cCompiledCalendar.h"
+#include "eDayCountBulk.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace libor {
+
+namespace {
+   //start and the adjusted ends of the periods, rolled back from maturity
+   void schedule(const SwapTrade &t, long freq, const CompiledCalendar *calendar, std::vector<long> &res)
+   {
+      if(freq <= 0 || 12 % freq != 0)
+         throw pdg::Error(2, "#Error in SwapPortfolio, frequency " + xtos(freq) + " not a divisor of 12");
+      const long step = 12 / freq;
+      res.clear();
+      for(long k = 0, d = t.maturity; d > t.start; d = daycount::addMonths(t.maturity, -step * ++k)) res.push_back(d);
+      res.push_back(t.start);
+      std::reverse(res.begin(), res.end());
+      if(calendar && t.adjust != bdNone)
+         for(size_t k = 1; k < res.size(); ++k) res[k] = calendar->adjust(res[k], t.adjust);
+   }
+
+   //trades per chunk of the parallel pricing
+   const long PRICE_GRAIN = 512;
+}
+
+SwapTrade::SwapTrade()
+: start(0), maturity(0), fixRate(0.), fixFreq(1), fixDayCount(0), fltFreq(4), fltDayCount(0), notional(1.),
+  discCurve(0), fwdCurve(0), calendar(0), adjust(bdNone), firstCpnFixed(false), firstCpn(0.)
+{}
+
+SwapPortfolio::SwapPortfolio(long today, const std::vector<SwapTrade> &trades)
+{
+   const long n = static_cast<long>(trades.size());
+   fixBegin_.reserve(n + 1);
+   fltBegin_.reserve(n + 1);
+   notional_.reserve(n);
+
+   //fixed periods by day count, their accruals are computed in bulk below
+   std::map<long, std::vector<long> > byDayCount;
+   std::vector<long> fixStart, fixEnd;
+   std::map<long, boost::shared_ptr<const CompiledCalendar> > calendars;
+   std::vector<long> dates;
+
+   //the cash flows point in the grid of the curve requests first
+   for(long i = 0; i < n; ++i) {
+      const SwapTrade &t = trades[i];
+      if(t.maturity <= t.start)
+         throw pdg::Error(2, "#Error in SwapPortfolio, trade " + xtos(i) + " matures on " + xtos(t.maturity) +
+                             " before its start " + xtos(t.start));
+      const CompiledCalendar *calendar = 0;
+      if(t.calendar != 0) {
+         boost::shared_ptr<const CompiledCalendar> &c = calendars[t.calendar];
+         if(!c) c = CompiledCalendars::Instance().find(t.calendar);
+         calendar = c.get();
+      }
+      notional_.push_back(t.notional);
+
+      fixBegin_.push_back(static_cast<long>(fixPay_.size()));
+      schedule(t, t.fixFreq, calendar, dates);
+      std::vector<long> &sameDayCount = byDayCount[t.fixDayCount];
+      for(size_t k = 1; k < dates.size(); ++k) {
+         if(dates[k] <= today) continue;
+         sameDayCount.push_back(static_cast<long>(fixPay_.size()));
+         fixStart.push_back(dates[k - 1]);
+         fixEnd.push_back(dates[k]);
+         fixPay_.push_back(grid_.add(t.discCurve, dates[k]));
+         fixAmount_.push_back(t.fixRate);
+      }
+
+      fltBegin_.push_back(static_cast<long>(fltPay_.size()));
+      schedule(t, t.fltFreq, calendar, dates);
+      for(size_t k = 1; k < dates.size(); ++k) {
+         if(dates[k] <= today) continue;
+         fltPay_.push_back(grid_.add(t.discCurve, dates[k]));
+         if(dates[k - 1] < today) {
+            if(!t.firstCpnFixed)
+               throw pdg::Error(2, "#Error in SwapPortfolio, trade " + xtos(i) + " has a floating period running at " +
+                                   xtos(today) + " and no fixed first coupon");
+            double yrf;
+            daycount::yearFractions(t.fltDayCount, 1, &dates[k - 1], &dates[k], &yrf);
+            fltStart_.push_back(-1);
+            fltEnd_.push_back(-1);
+            fltAmount_.push_back(t.firstCpn * yrf);
+         }
+         else {
+            fltStart_.push_back(grid_.add(t.fwdCurve, dates[k - 1]));
+            fltEnd_.push_back(grid_.add(t.fwdCurve, dates[k]));
+            fltAmount_.push_back(0.);
+         }
+      }
+   }
+   fixBegin_.push_back(static_cast<long>(fixPay_.size()));
+   fltBegin_.push_back(static_cast<long>(fltPay_.size()));
+
+   //fixed amounts: rate times the accrual
+   std::vector<long> start, end;
+   std::vector<double> yrf;
+   for(std::map<long, std::vector<long> >::const_iterator it = byDayCount.begin(); it != byDayCount.end(); ++it) {
+      const std::vector<long> &flows = it->second;
+      const long m = static_cast<long>(flows.size());
+      if(m == 0) continue;
+      start.resize(m);
+      end.resize(m);
+      yrf.resize(m);
+      for(long j = 0; j < m; ++j) {
+         start[j] = fixStart[flows[j]];
+         end[j] = fixEnd[flows[j]];
+      }
+      daycount::yearFractions(it->first, m, &start[0], &end[0], &yrf[0]);
+      for(long j = 0; j < m; ++j) fixAmount_[flows[j]] *= yrf[j];
+   }
+
+   //each request reads its discount at its slot in the values of the grid
+   grid_.compile();
+   for(size_t j = 0; j < fixPay_.size(); ++j) fixPay_[j] = grid_.slot(fixPay_[j]);
+   for(size_t j = 0; j < fltPay_.size(); ++j) {
+      fltPay_[j] = grid_.slot(fltPay_[j]);
+      if(fltStart_[j] < 0) continue;
+      fltStart_[j] = grid_.slot(fltStart_[j]);
+      fltEnd_[j] = grid_.slot(fltEnd_[j]);
+   }
+}
+
+void SwapPortfolio::evaluate(const discount_function &discounts, std::vector<double> &discs) const
+{
+   grid_.evaluate(discounts, discs);
+}
+
+void SwapPortfolio::price(const discount_function &discounts, double *npv) const
+{
+   std::vector<double> discs;
+   evaluate(discounts, discs);
+   price(discs, npv);
+}
+
+void SwapPortfolio::price(const std::vector<double> &discs, double *npv) const
+{
+   double total = 0.0;
+   priceRange(&discs, npv, 0, size(), parallel::ScratchArena::local(), &total);
+}
+
+double SwapPortfolio::price(const std::vector<double> &discs, double *npv, parallel::ThreadPool &pool) const
+{
+   double total = 0.0;
+   parallel::parallelSum(pool, size(), PRICE_GRAIN, 1, boost::bind(&SwapPortfolio::priceRange, this, &discs, npv, _1, _2, _3, _4),
+                         &total);
+   return total;
+}
+
+void SwapPortfolio::priceRange(const std::vector<double> *discs, double *npv, long begin, long end,
+                               parallel::ScratchArena &, double *total) const
+{
+   const double *disc = discs->empty() ? 0 : &(*discs)[0];
+   for(long i = begin; i < end; ++i) {
+      double fixed = 0.0, floating = 0.0;
+      for(long j = fixBegin_[i]; j < fixBegin_[i + 1]; ++j) fixed += fixAmount_[j] * disc[fixPay_[j]];
+      for(long j = fltBegin_[i]; j < fltBegin_[i + 1]; ++j) {
+         const double cpn = fltStart_[j] < 0 ? fltAmount_[j] : disc[fltStart_[j]] / disc[fltEnd_[j]] - 1.0;
+         floating += cpn * disc[fltPay_[j]];
+      }
+      npv[i] = notional_[i] * (floating - fixed);
+      *total += npv[i];
+   }
+}
+
+double SwapPortfolio::adjoint(const std::vector<double> &discs, double *npv, std::vector<double> &discsBar) const
+{
+   std::vector<double> partial(1 + discs.size(), 0.0);
+   adjointRange(&discs, npv, 0, size(), parallel::ScratchArena::local(), &partial[0]);
+   discsBar.assign(partial.begin() + 1, partial.end());
+   return partial[0];
+}
+
+double SwapPortfolio::adjoint(const std::vector<double> &discs, double *npv, std::vector<double> &discsBar,
+                              parallel::ThreadPool &pool) const
+{
+   //the adjoints are reduced as the total, in the order of the chunks
+   std::vector<double> partial(1 + discs.size());
+   parallel::parallelSum(pool, size(), PRICE_GRAIN, static_cast<long>(partial.size()),
+                         boost::bind(&SwapPortfolio::adjointRange, this, &discs, npv, _1, _2, _3, _4), &partial[0]);
+   discsBar.assign(partial.begin() + 1, partial.end());
+   return partial[0];
+}
+
+void SwapPortfolio::adjointRange(const std::vector<double> *discs, double *npv, long begin, long end,
+                                 parallel::ScratchArena &, double *partial) const
+{
+   const double *disc = discs->empty() ? 0 : &(*discs)[0];
+   double *bar = partial + 1;
+   for(long i = begin; i < end; ++i) {
+      const double notional = notional_[i];
+      double fixed = 0.0, floating = 0.0;
+      for(long j = fixBegin_[i]; j < fixBegin_[i + 1]; ++j) {
+         fixed += fixAmount_[j] * disc[fixPay_[j]];
+         bar[fixPay_[j]] -= notional * fixAmount_[j];
+      }
+      for(long j = fltBegin_[i]; j < fltBegin_[i + 1]; ++j) {
+         const double pay = disc[fltPay_[j]];
+         if(fltStart_[j] < 0) {
+            floating += fltAmount_[j] * pay;
+            bar[fltPay_[j]] += notional * fltAmount_[j];
+            continue;
+         }
+         const double ratio = disc[fltStart_[j]] / disc[fltEnd_[j]];
+         floating += (ratio - 1.0) * pay;
+         bar[fltPay_[j]] += notional * (ratio - 1.0);
+         bar[fltStart_[j]] += notional * pay / disc[fltEnd_[j]];
+         bar[fltEnd_[j]] -= notional * pay * ratio / disc[fltEnd_[j]];
+      }
+      npv[i] = notional * (floating - fixed);
+      partial[0] += npv[i];
+   }
+}
+
+} // namespace libor
@@ -0,0 +1,113 @@
+//ratePortfolioPricer.h
+#ifndef _RATEPORTFOLIOPRICER_H__
+#define _RATEPORTFOLIOPRICER_H__
+
+#include <vector>
+#include "cCashflowGrid.h"
+
+namespace parallel { class ThreadPool; class ScratchArena; }
+
+namespace libor {
+
+/**
+* @defgroup portfoliopricer Batch pricing of vanilla swaps.
+*
+* A portfolio of fixed against floating swaps is compiled once into columnar
+* cash flows: the schedules are generated and adjusted on the compiled
+* calendars, the accruals of the fixed legs computed in bulk per day count
+* and every date a curve is needed on goes in the cash flow grid of the
+* portfolio. Pricing then evaluates each curve once on its distinct dates
+* and reduces the cash flows of each trade against these discounts, with no
+* per trade lookup or allocation. The floating coupons are projected as forward
+* discount ratios on the forwarding curve, so they do not depend on the
+* floating day count, and paid on the discounting curve.
+* These conventions are the pricer's own: the engine swaps of pdg_shmSwapNPV
+* are generated on the calendar and settlement lag of the currency and their
+* floating legs accrued in the floating day count, so their NPVs differ from
+* the pricer's wherever the schedules or the accruals differ.
+* On a pool the trades are priced by chunks against discounts evaluated
+* beforehand, which the tasks share read only, and the total of the
+* portfolio is reduced in the order of the chunks: it is the same to the bit
+* whatever the number of threads.
+* The adjoint mode returns with the NPVs the derivatives of their total with
+* respect to the discounts of the grid, in one backward sweep over the cash
+* flows, instead of repricing the portfolio per bumped pillar. Through the
+* adjoint of the curve interpolation (ShmCurveBlockAdjoint) they become the
+* derivatives with respect to the pillar discounts of each curve, and through
+* the jacobian of the bootstrap (pdg_liborCurveInstrumentsJacobian) with
+* respect to the quotes of the instruments.
+*/
+
+//@{
+struct SwapTrade {
+   SwapTrade();
+
+   long   start;
+   long   maturity;                // the schedules are rolled back from maturity, a short stub first
+   double fixRate;
+   long   fixFreq;                 // payments per year, a divisor of 12
+   long   fixDayCount;
+   long   fltFreq;
+   long   fltDayCount;             // accrual of a fixed first coupon
+   double notional;                // positive for a payer swap (receives the floating leg)
+   long   discCurve;               // curve ids, passed back to the discount function
+   long   fwdCurve;
+   long   calendar;                // compiled calendar of the schedules, 0 for unadjusted dates
+   long   adjust;                  // business_day_rule of the period ends
+   bool   firstCpnFixed;           // the floating period running at today is fixed ...
+   double firstCpn;                // ... at this rate
+};
+
+class SwapPortfolio
+{
+public:
+   //periods paid on or before today are dropped
+   SwapPortfolio(long today, const std::vector<SwapTrade> &trades);
+
+   long size() const { return static_cast<long>(notional_.size()); }
+   //distinct curve ids and the distinct dates each of them is evaluated on
+   const CashflowGrid &grid() const { return grid_; }
+
+   //discounts of the grid, each curve evaluated once
+   void evaluate(const discount_function &discounts, std::vector<double> &discs) const;
+
+   void price(const discount_function &discounts, double *npv) const;
+   void price(const std::vector<double> &discs, double *npv) const;
+   //NPVs priced on the pool, returns their total
+   double price(const std::vector<double> &discs, double *npv, parallel::ThreadPool &pool) const;
+
+   //NPVs and discsBar[p] = d total / d discs[p], returns the total
+   double adjoint(const std::vector<double> &discs, double *npv, std::vector<double> &discsBar) const;
+   double adjoint(const std::vector<double> &discs, double *npv, std::vector<double> &discsBar,
+                  parallel::ThreadPool &pool) const;
+
+private:
+   void priceRange(const std::vector<double> *discs, double *npv, long begin, long end,
+                   parallel::ScratchArena &scratch, double *total) const;
+   //partial[0] the total, partial[1 + p] the adjoint of discs[p]
+   void adjointRange(const std::vector<double> *discs, double *npv, long begin, long end,
+                     parallel::ScratchArena &scratch, double *partial) const;
+
+   CashflowGrid grid_;
+
+   //trades: cash flows of trade i in [begin[i], begin[i + 1])
+   std::vector<long> fixBegin_;
+   std::vector<long> fltBegin_;
+   std::vector<double> notional_;
+
+   //fixed cash flows: amount per unit of notional, payment date (slot of the discount in the grid)
+   std::vector<double> fixAmount_;
+   std::vector<long> fixPay_;
+
+   //floating cash flows: start and end of the projection (slots in the grid, -1 for a fixed coupon of
+   //amount fltAmount_), payment date
+   std::vector<long> fltStart_;
+   std::vector<long> fltEnd_;
+   std::vector<double> fltAmount_;
+   std::vector<long> fltPay_;
+};
+//@}
+
+} // namespace libor
+
+#endif // _RATEPORTFOLIOPRICER_H__
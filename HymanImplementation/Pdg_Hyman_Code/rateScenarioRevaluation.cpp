@@ -0,0 +1,310 @@
+//rateScenarioRevaluation.cpp
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <utility>
+#include <boost/bind.hpp>
+#include "rateScenarioRevaluation.h"
+#include "cParallelReduce.h"
+#include "cThreadPool.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace libor {
+
+namespace {
+   template <class T>
+   void readValue(std::ifstream &in, T &value, const std::string &path)
+   {
+      in.read(reinterpret_cast<char *>(&value), sizeof(T));
+      if(!in) throw pdg::Error(2, "#Error in ScenarioReader, " + path + " is truncated");
+   }
+
+   //zero rate shift at date: linear between the dates of the curve, flat outside
+   double zeroShift(const ScenarioCurve &curve, const double *shifts, long date)
+   {
+      const std::vector<long> &d = curve.dates;
+      if(date <= d.front()) return shifts[0];
+      if(date >= d.back()) return shifts[d.size() - 1];
+      const long k = static_cast<long>(std::upper_bound(d.begin(), d.end(), date) - d.begin());
+      const double w = double(date - d[k - 1]) / double(d[k] - d[k - 1]);
+      return shifts[k - 1] + w * (shifts[k] - shifts[k - 1]);
+   }
+
+   //discount factor of the shift, the zero rates continuously compounded on ACT/365
+   double zeroFactor(const ScenarioCurve &curve, const double *shifts, long today, long date)
+   {
+      return std::exp(-zeroShift(curve, shifts, date) * double(date - today) / 365.0);
+   }
+
+   //the exogenous curve as it was read by the bootstrap, the points up to today are not pillars
+   boost::shared_ptr<BootstrapCurve> stateExo(const BootstrapState &s)
+   {
+      boost::shared_ptr<BootstrapCurve> exo(new BootstrapCurve(s.today, s.exoTypeInterp, s.exoInterpOn, s.exoComp, s.exoDayCount));
+      std::vector<long> dates;
+      long skipped = 0;
+      for(size_t i = 0; i < s.exoDates.size(); ++i) {
+         if(s.exoDates[i] <= s.today) ++skipped;
+         else dates.push_back(s.exoDates[i]);
+      }
+      exo->setPillars(dates);
+      for(size_t k = 0; k < dates.size(); ++k) exo->setDiscount(static_cast<long>(k), s.exoDiscounts[skipped + k]);
+      return exo;
+   }
+}
+
+ScenarioCurve::ScenarioCurve()
+: type(ssQuote), shifts(0)
+{}
+
+ScenarioReader::ScenarioReader(const std::string &path)
+: in_(path.c_str(), std::ios::in | std::ios::binary), path_(path), scenarios_(0), width_(0), next_(0)
+{
+   const std::string errMsg("#Error in ScenarioReader, ");
+   if(!in_) throw pdg::Error(2, errMsg + "cannot open " + path);
+
+   boost::uint32_t magic = 0, version = 0;
+   boost::int32_t nCurves = 0, nScenarios = 0;
+   readValue(in_, magic, path);
+   if(magic != SCENARIO_MAGIC) throw pdg::Error(2, errMsg + path + " is not a scenario file");
+   readValue(in_, version, path);
+   if(version != SCENARIO_LAYOUT_VERSION) throw pdg::Error(2, errMsg + path + " has the unknown layout version " + xtos(long(version)));
+   readValue(in_, nCurves, path);
+   readValue(in_, nScenarios, path);
+   if(nCurves <= 0 || nScenarios < 0)
+      throw pdg::Error(2, errMsg + path + " has " + xtos(long(nCurves)) + " curves and " + xtos(long(nScenarios)) + " scenarios");
+
+   curves_.resize(nCurves);
+   for(long c = 0; c < nCurves; ++c) {
+      ScenarioCurve &curve = curves_[c];
+      char name[SCENARIO_NAME_SIZE];
+      in_.read(name, SCENARIO_NAME_SIZE);
+      if(!in_) throw pdg::Error(2, errMsg + path + " is truncated");
+      curve.name.assign(name, std::find(name, name + SCENARIO_NAME_SIZE, '\0'));
+      std::transform(curve.name.begin(), curve.name.end(), curve.name.begin(), ::toupper);
+
+      boost::int32_t type = 0, shifts = 0;
+      readValue(in_, type, path);
+      readValue(in_, shifts, path);
+      if(type != ssQuote && type != ssZeroRate)
+         throw pdg::Error(2, errMsg + "unknown shift type " + xtos(long(type)) + " of curve " + curve.name);
+      if(shifts <= 0) throw pdg::Error(2, errMsg + "no shift for curve " + curve.name);
+      curve.type = type;
+      curve.shifts = shifts;
+      if(type == ssZeroRate) {
+         curve.dates.resize(shifts);
+         for(long k = 0; k < shifts; ++k) {
+            boost::int32_t date = 0;
+            readValue(in_, date, path);
+            curve.dates[k] = date;
+            if(k > 0 && curve.dates[k] <= curve.dates[k - 1])
+               throw pdg::Error(2, errMsg + "the shift dates of curve " + curve.name + " are not increasing");
+         }
+      }
+      width_ += shifts;
+   }
+   scenarios_ = nScenarios;
+}
+
+long ScenarioReader::read(long n, std::vector<double> &shifts)
+{
+   const long m = std::min(n, scenarios_ - next_);
+   if(m <= 0) return 0;
+   buffer_.resize(m * width_);
+   in_.read(reinterpret_cast<char *>(&buffer_[0]), m * width_ * sizeof(float));
+   if(!in_) throw pdg::Error(2, "#Error in ScenarioReader, " + path_ + " is truncated at scenario " + xtos(next_));
+   shifts.assign(buffer_.begin(), buffer_.end());
+   next_ += m;
+   return m;
+}
+
+ScenarioRevaluation::ScenarioRevaluation(long today, const SwapPortfolio &portfolio, const std::vector<ScenarioCurve> &curves,
+                                         const std::vector<long> &ids, const discount_function &base)
+: today_(today), portfolio_(portfolio), width_(0)
+{
+   const std::string errMsg("#Error in ScenarioRevaluation, ");
+   if(ids.size() != curves.size()) throw pdg::Error(2, errMsg + "one curve id per scenario curve expected");
+
+   curves_.resize(curves.size());
+   for(size_t c = 0; c < curves.size(); ++c) {
+      Curve &cv = curves_[c];
+      cv.spec = curves[c];
+      cv.offset = width_;
+      cv.exo = -1;
+      width_ += cv.spec.shifts;
+      if(cv.spec.type == ssZeroRate) {
+         if(static_cast<long>(cv.spec.dates.size()) != cv.spec.shifts)
+            throw pdg::Error(2, errMsg + "one date per zero rate shift of curve " + cv.spec.name + " expected");
+         continue;
+      }
+
+      BootstrapState &s = cv.state;
+      if(!BootstrapStateCache::Instance().find(cv.spec.name, s))
+         throw pdg::Error(2, errMsg + "curve " + cv.spec.name + " was not bootstrapped");
+      if(s.today != today)
+         throw pdg::Error(2, errMsg + "curve " + cv.spec.name + " was bootstrapped at " + xtos(s.today) + ", not at " + xtos(today));
+      if(static_cast<long>(s.instruments.size()) != cv.spec.shifts)
+         throw pdg::Error(2, errMsg + xtos(cv.spec.shifts) + " quote shifts for the " +
+                             xtos(static_cast<long>(s.instruments.size())) + " instruments of curve " + cv.spec.name);
+      cv.proto.reset(new BootstrapCurve(today, s.typeInterp, s.interpOn, s.comp, s.dayCount));
+      cv.proto->setPillars(bootstrapPillars(s.instruments, today));
+      for(long k = 0; k < cv.proto->size(); ++k) cv.proto->setDiscount(k, s.discounts[k]);
+      if(s.exoName.empty()) continue;
+      cv.exoCurve = stateExo(s);
+      for(size_t e = 0; e < curves.size(); ++e)
+         if(curves[e].name == s.exoName) cv.exo = static_cast<long>(e);
+   }
+
+   //a moving discounting curve is solved on the pillars the bootstrap of the curve read
+   for(size_t c = 0; c < curves_.size(); ++c) {
+      const Curve &cv = curves_[c];
+      if(cv.exo < 0 || curves_[cv.exo].spec.type != ssQuote) continue;
+      const BootstrapCurve &down = *curves_[cv.exo].proto, &read = *cv.exoCurve;
+      bool same = down.size() == read.size();
+      for(long k = 0; same && k < down.size(); ++k)
+         same = down.pillarDate(k) == read.pillarDate(k) && down.pillarDiscount(k) == read.pillarDiscount(k);
+      if(!same)
+         throw pdg::Error(2, errMsg + "curve " + cv.state.exoName + " was bootstrapped again since curve " +
+                             cv.spec.name + " was discounted on it");
+   }
+
+   //the discounting curves are solved first, the others are solved in batch once for all the scenarios
+   std::vector<long> levels(curves_.size(), -1);
+   std::vector<std::pair<long, long> > order;
+   for(size_t c = 0; c < curves_.size(); ++c) {
+      Curve &cv = curves_[c];
+      if(cv.spec.type != ssQuote) continue;
+      order.push_back(std::make_pair(level(static_cast<long>(c), 0, levels), static_cast<long>(c)));
+      if(cv.exo < 0) cv.batch.reset(new BootstrapScenarios(*cv.proto, cv.state.instruments, cv.exoCurve.get()));
+   }
+   std::sort(order.begin(), order.end());
+   for(size_t i = 0; i < order.size(); ++i) order_.push_back(order[i].second);
+
+   //base discounts of the grid, the bootstrapped curves on their pillars
+   const CashflowGrid &grid = portfolio.grid();
+   gridCurve_.assign(grid.curves().size(), -1);
+   base_.resize(grid.points());
+   for(size_t k = 0; k < grid.curves().size(); ++k) {
+      for(size_t c = 0; c < curves_.size(); ++c)
+         if(ids[c] == grid.curves()[k]) gridCurve_[k] = static_cast<long>(c);
+      const std::vector<long> &dates = grid.dates(static_cast<long>(k));
+      if(dates.empty()) continue;
+      const long c = gridCurve_[k];
+      double *out = &base_[grid.offset(static_cast<long>(k))];
+      if(c >= 0 && curves_[c].spec.type == ssQuote)
+         curves_[c].proto->discountsOn(&dates[0], static_cast<long>(dates.size()), out);
+      else
+         base(grid.curves()[k], &dates[0], static_cast<long>(dates.size()), out);
+   }
+   npv_.resize(portfolio.size());
+   if(!npv_.empty()) portfolio.price(base_, &npv_[0]);
+}
+
+long ScenarioRevaluation::level(long c, long depth, std::vector<long> &levels) const
+{
+   if(levels[c] >= 0) return levels[c];
+   if(depth > static_cast<long>(curves_.size()))
+      throw pdg::Error(2, "#Error in ScenarioRevaluation, the discounting curves of " + curves_[c].spec.name + " loop");
+   const long exo = curves_[c].exo;
+   levels[c] = (exo >= 0 && curves_[exo].spec.type == ssQuote) ? level(exo, depth + 1, levels) + 1 : 0;
+   return levels[c];
+}
+
+BootstrapCurve ScenarioRevaluation::exoCurve(long c, long s, const std::vector<double> &shifts,
+                                             const std::vector<std::vector<double> > &discs) const
+{
+   const Curve &cv = curves_[c], &down = curves_[cv.exo];
+   BootstrapCurve res(*cv.exoCurve);
+   if(down.spec.type == ssQuote) {
+      const long n = down.proto->size();
+      for(long k = 0; k < n; ++k) res.setDiscount(k, discs[cv.exo][s * n + k]);
+   }
+   else {
+      const double *shift = &shifts[s * width_ + down.offset];
+      for(long k = 0; k < res.size(); ++k)
+         res.setDiscount(k, res.pillarDiscount(k) * zeroFactor(down.spec, shift, today_, res.pillarDate(k)));
+   }
+   return res;
+}
+
+void ScenarioRevaluation::solve(long c, long n, const std::vector<double> &shifts, std::vector<std::vector<double> > &discs,
+                                parallel::ThreadPool &pool) const
+{
+   const Curve &cv = curves_[c];
+   const long m = cv.proto->size();
+   std::vector<double> quotes(n * m);
+   for(long s = 0; s < n; ++s)
+      for(long j = 0; j < m; ++j) quotes[s * m + j] = cv.state.instruments[j].quote + shifts[s * width_ + cv.offset + j];
+   discs[c].resize(n * m);
+   if(cv.batch) cv.batch->solve(n, &quotes[0], &discs[c][0], pool);
+   else parallel::parallelFor(pool, n, 1, boost::bind(&ScenarioRevaluation::solveRange, this, c, &quotes, &shifts, &discs, _1, _2, _3));
+}
+
+void ScenarioRevaluation::solveRange(long c, const std::vector<double> *quotes, const std::vector<double> *shifts,
+                                     std::vector<std::vector<double> > *discs, long begin, long end,
+                                     parallel::ScratchArena &) const
+{
+   const Curve &cv = curves_[c];
+   const long m = cv.proto->size();
+   for(long s = begin; s < end; ++s) {
+      const BootstrapCurve exo = exoCurve(c, s, *shifts, *discs);
+      BootstrapCurve curve(*cv.proto);
+      BootstrapSolver solver(curve, cv.state.instruments, &exo);
+      solver.setQuotes(&(*quotes)[s * m]);
+      solver.setGuesses(cv.state.discounts);
+      if(curve.local()) solver.solve();
+      else solver.solveGlobal();
+      for(long k = 0; k < m; ++k) (*discs)[c][s * m + k] = curve.pillarDiscount(k);
+   }
+}
+
+void ScenarioRevaluation::priceRange(const std::vector<double> *shifts, const std::vector<std::vector<double> > *discs,
+                                     double *pnl, long begin, long end, parallel::ScratchArena &) const
+{
+   const CashflowGrid &grid = portfolio_.grid();
+   const long trades = portfolio_.size();
+   std::vector<double> values(base_);
+   for(long s = begin; s < end; ++s) {
+      for(size_t k = 0; k < grid.curves().size(); ++k) {
+         const long c = gridCurve_[k];
+         const std::vector<long> &dates = grid.dates(static_cast<long>(k));
+         if(c < 0 || dates.empty()) continue;
+         const Curve &cv = curves_[c];
+         const long off = grid.offset(static_cast<long>(k)), n = static_cast<long>(dates.size());
+         if(cv.spec.type == ssZeroRate) {
+            const double *shift = &(*shifts)[s * width_ + cv.offset];
+            for(long p = 0; p < n; ++p) values[off + p] = base_[off + p] * zeroFactor(cv.spec, shift, today_, dates[p]);
+            continue;
+         }
+         BootstrapCurve curve(*cv.proto);
+         const long m = curve.size();
+         for(long j = 0; j < m; ++j) curve.setDiscount(j, (*discs)[c][s * m + j]);
+         curve.discountsOn(&dates[0], n, &values[off]);
+      }
+      double *row = pnl + s * trades;
+      portfolio_.price(values, row);
+      for(long i = 0; i < trades; ++i) row[i] -= npv_[i];
+   }
+}
+
+long ScenarioRevaluation::run(ScenarioReader &reader, long chunk, const pnl_sink &sink, parallel::ThreadPool &pool) const
+{
+   if(reader.width() != width_)
+      throw pdg::Error(2, "#Error in ScenarioRevaluation, " + xtos(reader.width()) + " shifts per scenario for " + xtos(width_) + " expected");
+   if(chunk <= 0) throw pdg::Error(2, "#Error in ScenarioRevaluation, chunks of " + xtos(chunk) + " scenarios");
+
+   std::vector<double> shifts, pnl;
+   std::vector<std::vector<double> > discs(curves_.size());
+   long done = 0;
+   for(long n = reader.read(chunk, shifts); n > 0; n = reader.read(chunk, shifts)) {
+      for(size_t i = 0; i < order_.size(); ++i) solve(order_[i], n, shifts, discs, pool);
+      pnl.resize(n * portfolio_.size());
+      if(!pnl.empty())
+         parallel::parallelFor(pool, n, 1, boost::bind(&ScenarioRevaluation::priceRange, this, &shifts, &discs, &pnl[0], _1, _2, _3));
+      sink(done, n, pnl.empty() ? 0 : &pnl[0]);
+      done += n;
+   }
+   return done;
+}
+
+} // namespace libor
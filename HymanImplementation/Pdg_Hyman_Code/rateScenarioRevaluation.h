@@ -0,0 +1,139 @@
+//rateScenarioRevaluation.h
+#ifndef _RATESCENARIOREVALUATION_H__
+#define _RATESCENARIOREVALUATION_H__
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include "rateBootstrapScenarios.h"
+#include "rateBootstrapState.h"
+#include "ratePortfolioPricer.h"
+
+namespace parallel { class ThreadPool; class ScratchArena; }
+
+namespace libor {
+
+/**
+* @defgroup scenariorevaluation Revaluation of a swap portfolio under historical scenarios.
+*
+* The scenarios are read from a binary file: a header naming the curves that
+* move and how, then one record of shifts per scenario. A curve bootstrapped
+* by pdg_liborCurveInstruments moves by shifts added to the quotes of its
+* instruments and is bootstrapped again from the state of its last bootstrap;
+* any other curve moves by shifts of its zero rates on given dates, linear in
+* between and flat outside. The file is streamed a chunk of scenarios at a
+* time, so the memory does not depend on the number of scenarios. For a chunk
+* the curves are solved in the order of their discounting: a curve whose
+* discounting curve does not move is solved in batch (BootstrapScenarios, set
+* up once for the whole file), one discounted on a moving curve builds a
+* solver per scenario, warm started from the base pillars. The scenarios of
+* the chunk then evaluate the cash flow grid of the portfolio and price it in
+* parallel; the P&L against the base NPVs, priced through the same path, goes
+* to the sink chunk by chunk, in the order of the scenarios. For a given
+* chunk size it is the same to the bit whatever the number of threads (the
+* spline solves of a block start from the previous scenario of the block).
+*/
+
+//@{
+enum scenario_shift_type { ssQuote = 0, ssZeroRate = 1 };
+
+//file layout, little endian:
+//   uint32 SCENARIO_MAGIC, uint32 SCENARIO_LAYOUT_VERSION, int32 curves, int32 scenarios
+//   per curve: char name[SCENARIO_NAME_SIZE] (zero padded), int32 scenario_shift_type, int32 shifts,
+//              ssZeroRate: int32 dates[shifts], strictly increasing
+//   per scenario: float32 shifts of each curve, in the order of the curves
+const boost::uint32_t SCENARIO_MAGIC = 0x53474450;       // "PDGS"
+const boost::uint32_t SCENARIO_LAYOUT_VERSION = 1;
+const long SCENARIO_NAME_SIZE = 48;
+
+struct ScenarioCurve {
+   ScenarioCurve();
+
+   std::string name;                  // upper case
+   long type;                         // scenario_shift_type
+   long shifts;                       // ssQuote: one per instrument, in the order of the pillars
+   std::vector<long> dates;           // ssZeroRate: the dates of the shifts
+};
+
+class ScenarioReader
+{
+public:
+   explicit ScenarioReader(const std::string &path);
+
+   const std::vector<ScenarioCurve> &curves() const { return curves_; }
+   long scenarios() const { return scenarios_; }
+   //shifts of one scenario, all the curves
+   long width() const { return width_; }
+
+   //the next scenarios, at most n, one row of width() in shifts per scenario; returns how many were read
+   long read(long n, std::vector<double> &shifts);
+
+private:
+   ScenarioReader(const ScenarioReader &);
+   ScenarioReader &operator=(const ScenarioReader &);
+
+   std::ifstream in_;
+   std::string path_;
+   std::vector<ScenarioCurve> curves_;
+   long scenarios_;
+   long width_;
+   long next_;                        // scenarios read so far
+   std::vector<float> buffer_;
+};
+
+//P&L of the trades in scenarios [first, first + n): pnl[s * trades + i] for scenario first + s
+typedef boost::function<void (long first, long n, const double *pnl)> pnl_sink;
+
+class ScenarioRevaluation
+{
+public:
+   //ids[c] is the curve id of curves[c] in the trades, base gives the discounts of the curves that do not move
+   //and the base of the zero rate shifts; the bootstrapped curves are taken from BootstrapStateCache
+   ScenarioRevaluation(long today, const SwapPortfolio &portfolio, const std::vector<ScenarioCurve> &curves,
+                       const std::vector<long> &ids, const discount_function &base);
+
+   const std::vector<double> &baseNPV() const { return npv_; }
+
+   //revalues the scenarios of the reader, chunk at a time; returns the number of scenarios.
+   //Not to be called from a task of the pool.
+   long run(ScenarioReader &reader, long chunk, const pnl_sink &sink, parallel::ThreadPool &pool) const;
+
+private:
+   struct Curve {
+      ScenarioCurve spec;
+      long offset;                                 // of its shifts in a scenario
+      long exo;                                    // moving discounting curve, -1 if none
+      BootstrapState state;                        // ssQuote
+      boost::shared_ptr<BootstrapCurve> proto;     // conventions and pillars at the base discounts
+      boost::shared_ptr<BootstrapCurve> exoCurve;  // discounting curve as the bootstrap read it
+      boost::shared_ptr<BootstrapScenarios> batch; // when the discounting curve does not move
+   };
+
+   long level(long c, long depth, std::vector<long> &levels) const;
+   //pillars of curve c in the scenarios of the chunk, discs[c][s * pillars + k]
+   void solve(long c, long n, const std::vector<double> &shifts, std::vector<std::vector<double> > &discs,
+              parallel::ThreadPool &pool) const;
+   void solveRange(long c, const std::vector<double> *quotes, const std::vector<double> *shifts,
+                   std::vector<std::vector<double> > *discs, long begin, long end, parallel::ScratchArena &scratch) const;
+   //discounting curve of c in scenario s
+   BootstrapCurve exoCurve(long c, long s, const std::vector<double> &shifts, const std::vector<std::vector<double> > &discs) const;
+   void priceRange(const std::vector<double> *shifts, const std::vector<std::vector<double> > *discs, double *pnl,
+                   long begin, long end, parallel::ScratchArena &scratch) const;
+
+   long today_;
+   const SwapPortfolio &portfolio_;
+   std::vector<Curve> curves_;
+   std::vector<long> order_;               // of the solves, discounting curves first
+   std::vector<long> gridCurve_;           // curve of each curve of the grid, -1 if it does not move
+   long width_;
+   std::vector<double> base_;              // base discounts of the grid
+   std::vector<double> npv_;
+};
+//@}
+
+} // namespace libor
+
+#endif // _RATESCENARIOREVALUATION_H__
@@ -0,0 +1,119 @@
+//rateSwapSurface.cpp
+#include <algorithm>
+#include <boost/shared_ptr.hpp>
+#include "rateSwapSurface.h"
+#include "cCompiledCalendar.h"
+#include "eDayCountBulk.h"
+#include "cError.h"
+#include "xtos.h"
+
+namespace libor {
+
+namespace {
+   long periodMonths(long freq)
+   {
+      if(freq <= 0 || 12 % freq != 0)
+         throw pdg::Error(2, "#Error in SwapSurface, frequency " + xtos(freq) + " not a divisor of 12");
+      return 12 / freq;
+   }
+
+   //start and the adjusted ends of n periods of step months, rolled forward from start
+   void schedule(long start, long step, long n, const CompiledCalendar *calendar, long adjust, std::vector<long> &res)
+   {
+      res.resize(n + 1);
+      res[0] = start;
+      for(long k = 1; k <= n; ++k) res[k] = daycount::addMonths(start, step * k);
+      if(calendar && adjust != bdNone)
+         for(long k = 1; k <= n; ++k) res[k] = calendar->adjust(res[k], adjust);
+   }
+}
+
+SwapSurfaceTerms::SwapSurfaceTerms()
+: fixFreq(1), fixDayCount(0), fltFreq(2), discCurve(0), fwdCurve(0), calendar(0), adjust(bdNone)
+{}
+
+SwapSurface::SwapSurface(const std::vector<long> &starts, const std::vector<long> &tenors, const SwapSurfaceTerms &terms)
+{
+   const long fixStep = periodMonths(terms.fixFreq), fltStep = periodMonths(terms.fltFreq);
+   long longest = 0;
+   for(size_t j = 0; j < tenors.size(); ++j) {
+      if(tenors[j] <= 0 || tenors[j] % fixStep != 0 || tenors[j] % fltStep != 0)
+         throw pdg::Error(2, "#Error in SwapSurface, tenor of " + xtos(tenors[j]) + " months not a multiple of " +
+                             xtos(fixStep) + " and " + xtos(fltStep) + " months");
+      fixPeriods_.push_back(tenors[j] / fixStep);
+      fltPeriods_.push_back(tenors[j] / fltStep);
+      longest = std::max(longest, tenors[j]);
+   }
+   boost::shared_ptr<const CompiledCalendar> calendar;
+   if(terms.calendar != 0) calendar = CompiledCalendars::Instance().find(terms.calendar);
+
+   //the longest swap of each start, the accruals of the fixed periods in bulk below
+   std::vector<long> dates, accStart, accEnd;
+   for(size_t i = 0; i < starts.size(); ++i) {
+      fixBegin_.push_back(static_cast<long>(fixPay_.size()));
+      schedule(starts[i], fixStep, longest / fixStep, calendar.get(), terms.adjust, dates);
+      for(size_t k = 1; k < dates.size(); ++k) {
+         accStart.push_back(dates[k - 1]);
+         accEnd.push_back(dates[k]);
+         fixPay_.push_back(grid_.add(terms.discCurve, dates[k]));
+      }
+
+      fltBegin_.push_back(static_cast<long>(fltPay_.size()));
+      schedule(starts[i], fltStep, longest / fltStep, calendar.get(), terms.adjust, dates);
+      for(size_t k = 1; k < dates.size(); ++k) {
+         fltStart_.push_back(grid_.add(terms.fwdCurve, dates[k - 1]));
+         fltEnd_.push_back(grid_.add(terms.fwdCurve, dates[k]));
+         fltPay_.push_back(grid_.add(terms.discCurve, dates[k]));
+      }
+   }
+   fixBegin_.push_back(static_cast<long>(fixPay_.size()));
+   fltBegin_.push_back(static_cast<long>(fltPay_.size()));
+
+   fixYrf_.resize(accStart.size());
+   if(!accStart.empty())
+      daycount::yearFractions(terms.fixDayCount, static_cast<long>(accStart.size()), &accStart[0], &accEnd[0], &fixYrf_[0]);
+
+   grid_.compile();
+   for(size_t k = 0; k < fixPay_.size(); ++k) fixPay_[k] = grid_.slot(fixPay_[k]);
+   for(size_t k = 0; k < fltPay_.size(); ++k) {
+      fltStart_[k] = grid_.slot(fltStart_[k]);
+      fltEnd_[k] = grid_.slot(fltEnd_[k]);
+      fltPay_[k] = grid_.slot(fltPay_[k]);
+   }
+}
+
+void SwapSurface::price(const discount_function &discounts, double *rates, double *annuities) const
+{
+   std::vector<double> discs;
+   grid_.evaluate(discounts, discs);
+   price(discs, rates, annuities);
+}
+
+void SwapSurface::price(const std::vector<double> &discs, double *rates, double *annuities) const
+{
+   const double *disc = discs.empty() ? 0 : &discs[0];
+   const long m = tenors();
+   //running sums along the longest swap of the start
+   std::vector<double> annuity, floating;
+   for(long i = 0; i < starts(); ++i) {
+      annuity.resize(fixBegin_[i + 1] - fixBegin_[i]);
+      double sum = 0.0;
+      for(long j = fixBegin_[i], k = 0; j < fixBegin_[i + 1]; ++j, ++k) {
+         sum += fixYrf_[j] * disc[fixPay_[j]];
+         annuity[k] = sum;
+      }
+      floating.resize(fltBegin_[i + 1] - fltBegin_[i]);
+      sum = 0.0;
+      for(long j = fltBegin_[i], k = 0; j < fltBegin_[i + 1]; ++j, ++k) {
+         sum += (disc[fltStart_[j]] / disc[fltEnd_[j]] - 1.0) * disc[fltPay_[j]];
+         floating[k] = sum;
+      }
+      for(long j = 0; j < m; ++j) {
+         const double a = annuity[fixPeriods_[j] - 1];
+         rates[i * m + j] = floating[fltPeriods_[j] - 1] / a;
+         if(annuities) annuities[i * m + j] = a;
+      }
+   }
+}
+
+} // namespace libor
@@ -0,0 +1,68 @@
+//rateSwapSurface.h
+#ifndef _RATESWAPSURFACE_H__
+#define _RATESWAPSURFACE_H__
+
+#include <vector>
+#include "cCashflowGrid.h"
+
+namespace libor {
+
+/**
+* @defgroup swapsurface Forward par rates of a grid of starts and tenors.
+*
+* The swaps of a start share their schedules: the periods are rolled forward
+* from the start, so the swap of a tenor is the first periods of the longest
+* one, and only the longest schedule of each start is generated, adjusted and
+* accrued. Pricing walks it once, accumulating the discounted accruals of the
+* fixed leg (the annuity) and the discounted forward coupons of the floating
+* leg, and reads the par rate of each tenor where its schedule ends: a row of
+* the surface costs the longest swap of the row. The dates of all the rows go
+* in one cash flow grid, each curve is evaluated once.
+*/
+
+//@{
+struct SwapSurfaceTerms {
+   SwapSurfaceTerms();
+
+   long fixFreq;                   // payments per year, divisors of 12
+   long fixDayCount;
+   long fltFreq;
+   long discCurve;                 // curve ids, passed back to the discount function
+   long fwdCurve;
+   long calendar;                  // compiled calendar of the period ends, 0 for unadjusted dates
+   long adjust;                    // business_day_rule
+};
+
+class SwapSurface
+{
+public:
+   //swaps starting on starts[i] for tenors[j] months, the tenors multiples of both periods
+   SwapSurface(const std::vector<long> &starts, const std::vector<long> &tenors, const SwapSurfaceTerms &terms);
+
+   long starts() const { return static_cast<long>(fixBegin_.size()) - 1; }
+   long tenors() const { return static_cast<long>(fixPeriods_.size()); }
+   const CashflowGrid &grid() const { return grid_; }
+
+   //par rate and annuity (per unit of notional) of the swap of starts[i] and tenors[j] at i * tenors() + j
+   void price(const discount_function &discounts, double *rates, double *annuities) const;
+   void price(const std::vector<double> &discs, double *rates, double *annuities) const;
+
+private:
+   CashflowGrid grid_;
+   std::vector<long> fixPeriods_;        // periods of each tenor
+   std::vector<long> fltPeriods_;
+
+   //periods of the longest swap of start i in [begin[i], begin[i + 1]), slots of their discounts in the grid
+   std::vector<long> fixBegin_;
+   std::vector<double> fixYrf_;
+   std::vector<long> fixPay_;
+   std::vector<long> fltBegin_;
+   std::vector<long> fltStart_;          // forwarding curve
+   std::vector<long> fltEnd_;
+   std::vector<long> fltPay_;            // discounting curve
+};
+//@}
+
+} // namespace libor
+
+#endif // _RATESWAPSURFACE_H__